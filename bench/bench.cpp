@@ -0,0 +1,653 @@
+// Host benchmark for the GPS parser and the log formatting (env:native).
+//
+//   pio run -e native && .pio/build/native/program [corpus.nmea ...]
+//
+// Without arguments it runs over bench/corpus/*.nmea as listed below. Each
+// corpus is parsed as-is and with injected line noise, reporting sentences/s,
+// ns/byte, heap allocations per sentence and peak memory, and once with the
+// String based parser that the fixed sentence buffer replaced, for comparison.
+// The corpus and a 10 Hz synthetic capture are then fed in the chunks a 115200
+// baud UART delivers per GPS task poll, once a byte at a time and once as
+// blocks; both must publish the same fixes. The synthetic receiver then feeds the whole
+// pipeline at 1-50 Hz. Exits nonzero if the two input paths disagree.
+
+#include <Arduino.h>
+#include <new>
+#include <vector>
+#include <sys/resource.h>
+#include "GPSParser.h"
+#include "NMEANumeric.h"
+#include "LogFormat.h"
+#include "GPSSource.h"
+
+static const char* defaultCorpora[] = {
+    "bench/corpus/gn_multi_1hz.nmea"
+};
+
+#define BENCH_MIN_SECONDS 0.5
+#define BENCH_BLOCK_SIZE 256  // Bytes per processGPSData() call, as in the firmware loop
+#define BENCH_UART_CHUNK 23   // Bytes per 2 ms GPS task poll at 115200 baud
+#define BENCH_CAPTURE_EPOCHS 600
+
+static int failures = 0;
+
+// Heap accounting: every allocation carries its size in front of it
+static size_t allocationCount = 0;
+static size_t heapLive = 0;
+static size_t heapPeak = 0;
+static size_t heapBaseline = 0;
+
+void* operator new(size_t size) {
+    size_t* block = (size_t*)malloc(size + sizeof(size_t));
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    block[0] = size;
+    allocationCount++;
+    heapLive += size;
+    heapPeak = max(heapPeak, heapLive);
+    return &block[1];
+}
+
+__attribute__((noinline)) void operator delete(void* pointer) noexcept {
+    if (pointer != nullptr) {
+        size_t* block = (size_t*)pointer - 1;
+        heapLive -= block[0];
+        free(block);
+    }
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    operator delete(pointer);
+}
+
+// Start counting allocations and the peak heap use above what is live now
+static void resetHeapCounters() {
+    allocationCount = 0;
+    heapBaseline = heapLive;
+    heapPeak = heapLive;
+}
+
+static double seconds() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static bool loadFile(const char* path, std::vector<uint8_t>& data) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    uint8_t buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + count);
+    }
+    fclose(file);
+    return true;
+}
+
+// Replace roughly one byte in every `interval` with noise, deterministically
+static void addNoise(std::vector<uint8_t>& data, uint32_t interval) {
+    uint32_t state = 12345;
+    for (size_t i = 0; i < data.size(); i++) {
+        state = state * 1103515245 + 12345;
+        if ((state >> 16) % interval == 0) {
+            data[i] = (uint8_t)(state >> 8);
+        }
+    }
+}
+
+// Everything but the arrival times
+static bool sameFix(const GPSParser::Fix& a, const GPSParser::Fix& b) {
+    return a.sequence == b.sequence && a.timeOfDay == b.timeOfDay && a.date == b.date && a.utcMillis == b.utcMillis &&
+           a.latitudeE7 == b.latitudeE7 && a.longitudeE7 == b.longitudeE7 && a.speed == b.speed &&
+           a.course == b.course && a.altitude == b.altitude && a.geoidSeparation == b.geoidSeparation &&
+           a.satellites == b.satellites && a.hdop == b.hdop && a.pdop == b.pdop && a.vdop == b.vdop &&
+           a.fixMode == b.fixMode && memcmp(a.usedSatellites, b.usedSatellites, sizeof(a.usedSatellites)) == 0 &&
+           a.validPosition == b.validPosition && a.validAltitude == b.validAltitude && a.validHDOP == b.validHDOP &&
+           a.validTime == b.validTime && a.validDate == b.validDate && a.fields == b.fields;
+}
+
+// Feed the data in UART sized chunks through either input path, looking for a
+// new fix after every chunk as the GPS task does. Collects the fixes if asked.
+static void feedChunks(GPSParser& parser, const std::vector<uint8_t>& data, bool perByte,
+                       std::vector<GPSParser::Fix>* fixes) {
+    uint32_t lastSequence = parser.getFixSequence();
+    for (size_t offset = 0; offset < data.size(); offset += BENCH_UART_CHUNK) {
+        size_t length = min((size_t)BENCH_UART_CHUNK, data.size() - offset);
+        if (perByte) {
+            for (size_t i = 0; i < length; i++) {
+                parser.processGPSData((char)data[offset + i]);
+            }
+        }
+        else {
+            parser.processGPSData(&data[offset], length);
+        }
+        uint32_t sequence = parser.getFixSequence();
+        if (sequence != lastSequence) {
+            lastSequence = sequence;
+            if (fixes != nullptr) {
+                GPSParser::Fix fix;
+                parser.getFix(fix);
+                fixes->push_back(fix);
+            }
+        }
+    }
+}
+
+// ns/byte of one input path over repeated passes
+static double timeInputPath(const std::vector<uint8_t>& data, bool perByte) {
+    GPSParser parser;
+    size_t bytes = 0;
+    double start = seconds();
+    double elapsed;
+    do {
+        feedChunks(parser, data, perByte, nullptr);
+        bytes += data.size();
+        elapsed = seconds() - start;
+    } while (elapsed < BENCH_MIN_SECONDS);
+    return elapsed * 1e9 / bytes;
+}
+
+// processGPSData(char) against processGPSData(const uint8_t*, size_t) on the same input
+static void benchInputPaths(const char* name, const std::vector<uint8_t>& data) {
+    std::vector<GPSParser::Fix> byteFixes;
+    std::vector<GPSParser::Fix> blockFixes;
+    GPSParser* parser = new GPSParser();
+    feedChunks(*parser, data, true, &byteFixes);
+    delete parser;
+    parser = new GPSParser();
+    feedChunks(*parser, data, false, &blockFixes);
+    delete parser;
+    
+    size_t same = 0;
+    while (same < byteFixes.size() && same < blockFixes.size() && sameFix(byteFixes[same], blockFixes[same])) {
+        same++;
+    }
+    
+    double perByte = timeInputPath(data, true);
+    double perBlock = timeInputPath(data, false);
+    printf("%-28s %7.2f ns/byte per byte %7.2f ns/byte per block  (%zu fixes, %zu B chunks)\n", name, perByte,
+           perBlock, blockFixes.size(), (size_t)BENCH_UART_CHUNK);
+    if (byteFixes.empty() || same != byteFixes.size() || same != blockFixes.size()) {
+        printf("  FAILED: %zu fixes byte by byte, %zu as blocks, the first %zu the same\n", byteFixes.size(),
+               blockFixes.size(), same);
+        failures++;
+    }
+}
+
+// A capture of the synthetic receiver at 10 Hz: RMC and GGA every epoch, GSA and GSV once a second
+static void synthesizeCapture(std::vector<uint8_t>& data) {
+    SyntheticGPSSource::Settings settings = SyntheticGPSSource::defaultSettings();
+    settings.rateHz = 10;
+    SyntheticGPSSource source(settings);
+    source.setSpeed(GPS_SOURCE_SPEED_FAST);
+    uint8_t block[BENCH_BLOCK_SIZE];
+    while (source.getEpochs() < BENCH_CAPTURE_EPOCHS) {
+        size_t length = source.read(block, sizeof(block));
+        data.insert(data.end(), block, block + length);
+    }
+}
+
+// Drive the parser, the screen formatting and the log record formatting from the
+// synthetic receiver as fast as possible, for an hour of receiver time per rate
+static void benchPipeline() {
+    static const SyntheticGPSSource::Waypoint route[] = {
+        { 520907392, 50728783 }, { 520950000, 50728783 }, { 520950000, 50800000 }, { 520907392, 50800000 }
+    };
+    static const uint8_t rates[] = { 1, 10, 25, 50 };
+    const uint32_t receiverSeconds = 3600;
+    
+    for (size_t r = 0; r < sizeof(rates); r++) {
+        SyntheticGPSSource::Settings settings = SyntheticGPSSource::defaultSettings();
+        settings.route = route;
+        settings.waypoints = 4;
+        settings.speed = 15;
+        settings.rateHz = rates[r];
+        SyntheticGPSSource source(settings);
+        source.setSpeed(GPS_SOURCE_SPEED_FAST);
+        
+        GPSParser parser;
+        uint8_t block[BENCH_BLOCK_SIZE];
+        char text[GPS_POSITION_TEXT_SIZE];
+        char record[LOG_RECORD_MAX_LENGTH];
+        uint32_t fixes = 0;
+        size_t bytes = 0;
+        uint32_t epochs = receiverSeconds * rates[r];
+        
+        double start = seconds();
+        while (source.getEpochs() < epochs) {
+            size_t length = source.read(block, sizeof(block));
+            parser.processGPSData(block, length);
+            bytes += length;
+            if (parser.isNewDataAvailable()) {
+                parser.clearNewDataFlag();
+                GPSParser::Fix fix;
+                parser.getFix(fix);
+                parser.formatPosition(fix, text, sizeof(text));
+                formatLogRecord(record, sizeof(record), "GPS-ESP32", fix.sequence, "INFO", text);
+                fixes++;
+            }
+        }
+        double elapsed = seconds() - start;
+        
+        char name[32];
+        snprintf(name, sizeof(name), "synthetic %u Hz", rates[r]);
+        printf("%-28s %10.0f fixes/s %7.2f ns/byte %8.0fx real time  (%u fixes, %zu bytes)\n", name, fixes / elapsed,
+               elapsed * 1e9 / bytes, receiverSeconds / elapsed, fixes, bytes);
+    }
+}
+
+// The parser as it was before the fixed sentence buffer: sentences accumulated
+// in a String and split with indexOf()/substring(). The same code without its
+// comments and the getters the benchmark does not call, kept as the baseline
+// for bytes/s and allocations per sentence.
+class StringGPSParser {
+private:
+    float latitude = 0.0;
+    float longitude = 0.0;
+    char latDir = 'N';
+    char lonDir = 'E';
+    float speed = 0.0;
+    float course = 0.0;
+    float altitude = 0.0;
+    String time = "000000.000";
+    String date = "010100";
+    int satellites = 0;
+    float hdop = 99.99;
+    bool newData = false;
+    bool validPosition = false;
+    bool validAltitude = false;
+    bool validHDOP = false;
+    String currentSentence = "";
+    
+    void parseGGA(String sentence) {
+        int commaIndex = 0;
+        int nextCommaIndex = 0;
+        commaIndex = sentence.indexOf(',');
+        nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
+        if (nextCommaIndex > commaIndex + 1) {
+            time = sentence.substring(commaIndex + 1, nextCommaIndex);
+            newData = true;
+        }
+        commaIndex = nextCommaIndex;
+        nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
+        String latStr = sentence.substring(commaIndex + 1, nextCommaIndex);
+        commaIndex = nextCommaIndex;
+        nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
+        latDir = sentence.charAt(commaIndex + 1);
+        commaIndex = nextCommaIndex;
+        nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
+        String lonStr = sentence.substring(commaIndex + 1, nextCommaIndex);
+        commaIndex = nextCommaIndex;
+        nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
+        lonDir = sentence.charAt(commaIndex + 1);
+        commaIndex = nextCommaIndex;
+        nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
+        int fixQuality = sentence.substring(commaIndex + 1, nextCommaIndex).toInt();
+        validPosition = (fixQuality > 0);
+        commaIndex = nextCommaIndex;
+        nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
+        satellites = sentence.substring(commaIndex + 1, nextCommaIndex).toInt();
+        commaIndex = nextCommaIndex;
+        nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
+        String hdopStr = sentence.substring(commaIndex + 1, nextCommaIndex);
+        if (hdopStr.length() > 0) {
+            hdop = hdopStr.toFloat();
+            validHDOP = true;
+        }
+        commaIndex = nextCommaIndex;
+        nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
+        String altStr = sentence.substring(commaIndex + 1, nextCommaIndex);
+        if (altStr.length() > 0) {
+            altitude = altStr.toFloat();
+            validAltitude = true;
+        }
+        if (latStr.length() > 0 && lonStr.length() > 0) {
+            latitude = convertToDecimalDegrees(latStr, latDir);
+            longitude = convertToDecimalDegrees(lonStr, lonDir);
+        }
+    }
+    
+    void parseRMC(String sentence) {
+        int commaIndex = 0;
+        int nextCommaIndex = 0;
+        commaIndex = sentence.indexOf(',');
+        nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
+        if (nextCommaIndex > commaIndex + 1) {
+            time = sentence.substring(commaIndex + 1, nextCommaIndex);
+            newData = true;
+        }
+        commaIndex = nextCommaIndex;
+        nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
+        char status = sentence.charAt(commaIndex + 1);
+        validPosition = (status == 'A');
+        commaIndex = nextCommaIndex;
+        nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
+        String latStr = sentence.substring(commaIndex + 1, nextCommaIndex);
+        commaIndex = nextCommaIndex;
+        nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
+        latDir = sentence.charAt(commaIndex + 1);
+        commaIndex = nextCommaIndex;
+        nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
+        String lonStr = sentence.substring(commaIndex + 1, nextCommaIndex);
+        commaIndex = nextCommaIndex;
+        nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
+        lonDir = sentence.charAt(commaIndex + 1);
+        commaIndex = nextCommaIndex;
+        nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
+        String speedStr = sentence.substring(commaIndex + 1, nextCommaIndex);
+        if (speedStr.length() > 0) {
+            speed = speedStr.toFloat();
+        }
+        commaIndex = nextCommaIndex;
+        nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
+        String courseStr = sentence.substring(commaIndex + 1, nextCommaIndex);
+        if (courseStr.length() > 0) {
+            course = courseStr.toFloat();
+        }
+        commaIndex = nextCommaIndex;
+        nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
+        if (nextCommaIndex > commaIndex + 1) {
+            date = sentence.substring(commaIndex + 1, nextCommaIndex);
+        }
+        if (latStr.length() > 0 && lonStr.length() > 0) {
+            latitude = convertToDecimalDegrees(latStr, latDir);
+            longitude = convertToDecimalDegrees(lonStr, lonDir);
+        }
+    }
+    
+    void parseGSA(String sentence) {
+        int commaIndex = 0;
+        int nextCommaIndex = 0;
+        for (int i = 0; i < 15; i++) {
+            commaIndex = sentence.indexOf(',', commaIndex + 1);
+            if (commaIndex == -1) return;
+        }
+        nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
+        if (nextCommaIndex == -1) {
+            nextCommaIndex = sentence.indexOf('*', commaIndex + 1);
+        }
+        if (nextCommaIndex > commaIndex + 1) {
+            String hdopStr = sentence.substring(commaIndex + 1, nextCommaIndex);
+            if (hdopStr.length() > 0) {
+                hdop = hdopStr.toFloat();
+                validHDOP = true;
+            }
+        }
+    }
+    
+    float convertToDecimalDegrees(String pos, char dir) {
+        float value = 0.0;
+        int decimalPoint = pos.indexOf('.');
+        if (decimalPoint == -1) return 0.0;
+        int degrees = pos.substring(0, decimalPoint - 2).toInt();
+        float minutes = pos.substring(decimalPoint - 2).toFloat();
+        value = degrees + (minutes / 60.0);
+        if (dir == 'S' || dir == 'W') {
+            value = -value;
+        }
+        return value;
+    }
+
+public:
+    void processGPSData(char c) {
+        if (c == '\n') {
+            if (currentSentence.startsWith("$")) {
+                if (currentSentence.startsWith("$GPGGA") || currentSentence.startsWith("$GNGGA")) {
+                    parseGGA(currentSentence);
+                }
+                else if (currentSentence.startsWith("$GPRMC") || currentSentence.startsWith("$GNRMC")) {
+                    parseRMC(currentSentence);
+                }
+                else if (currentSentence.startsWith("$GPGSA") || currentSentence.startsWith("$GNGSA")) {
+                    parseGSA(currentSentence);
+                }
+            }
+            currentSentence = "";
+        }
+        else if (c != '\r') {
+            currentSentence += c;
+        }
+    }
+    
+    bool isNewDataAvailable() { return newData; }
+    void clearNewDataFlag() { newData = false; }
+    
+    String getPositionString() {
+        if (!validPosition) {
+            return "No Fix";
+        }
+        char buffer[48];
+        char latDir = (latitude >= 0) ? 'N' : 'S';
+        char lonDir = (longitude >= 0) ? 'E' : 'W';
+        float absLat = fabsf(latitude);
+        float absLon = fabsf(longitude);
+        snprintf(buffer, sizeof(buffer), "%02d\xc2\xb0%05.2f'%c %03d\xc2\xb0%05.2f'%c",
+                 (int)absLat, (absLat - (int)absLat) * 60, latDir,
+                 (int)absLon, (absLon - (int)absLon) * 60, lonDir);
+        return String(buffer);
+    }
+    
+    String getTimeString() {
+        if (time.length() < 6) {
+            return "00:00:00";
+        }
+        int hour = time.substring(0, 2).toInt();
+        int minute = time.substring(2, 4).toInt();
+        int second = time.substring(4, 6).toInt();
+        char buffer[9];
+        snprintf(buffer, sizeof(buffer), "%02d:%02d:%02d", hour, minute, second);
+        return String(buffer);
+    }
+};
+
+// Sentences in the data, one per line end
+static size_t countSentences(const std::vector<uint8_t>& data) {
+    size_t sentences = 0;
+    for (size_t i = 0; i < data.size(); i++) {
+        sentences += (data[i] == '\n');
+    }
+    return sentences;
+}
+
+// The String parser over the same corpus, as benchParser() below, a byte at a
+// time as it only took single characters. The host String keeps up to 15
+// characters without allocating, the ESP32 one 11, so on the device the
+// fields cost a few more allocations.
+static void benchStringParser(const char* name, const std::vector<uint8_t>& corpus) {
+    uint32_t fixes = 0;
+    size_t bytes = 0;
+    uint32_t passes = 0;
+    
+    resetHeapCounters();
+    StringGPSParser* parser = new StringGPSParser();
+    size_t parserAllocations = allocationCount;
+    volatile size_t sink = 0;
+    double start = seconds();
+    double elapsed;
+    do {
+        for (size_t i = 0; i < corpus.size(); i++) {
+            parser->processGPSData((char)corpus[i]);
+            if (parser->isNewDataAvailable()) {
+                parser->clearNewDataFlag();
+                sink = sink + parser->getPositionString().length() + parser->getTimeString().length();
+                fixes++;
+            }
+        }
+        bytes += corpus.size();
+        passes++;
+        elapsed = seconds() - start;
+    } while (elapsed < BENCH_MIN_SECONDS);
+    size_t allocations = allocationCount - parserAllocations;
+    
+    size_t sentences = countSentences(corpus) * passes;
+    printf("%-28s %10.0f sentences/s %7.2f ns/byte %6.3f allocs/sentence %8zu B heap peak  (%u passes, %u fixes)\n",
+           name, sentences / elapsed, elapsed * 1e9 / bytes, (double)allocations / sentences,
+           heapPeak - heapBaseline, passes, fixes);
+    delete parser;
+}
+
+// Parse the corpus repeatedly for at least BENCH_MIN_SECONDS, formatting every
+// published fix the way the screens do. fields is what the consumer subscribes to.
+static void benchParser(const char* name, const std::vector<uint8_t>& corpus,
+                        uint16_t fields = GPSParser::FIELD_ALL) {
+    char text[GPS_POSITION_TEXT_SIZE];
+    uint32_t fixes = 0;
+    size_t bytes = 0;
+    uint32_t passes = 0;
+    
+    // The parser counts towards the peak, the corpus does not
+    resetHeapCounters();
+    GPSParser* parser = new GPSParser();
+    parser->subscribe(fields);
+    size_t parserAllocations = allocationCount;
+    double start = seconds();
+    double elapsed;
+    do {
+        for (size_t offset = 0; offset < corpus.size(); offset += BENCH_BLOCK_SIZE) {
+            size_t length = min((size_t)BENCH_BLOCK_SIZE, corpus.size() - offset);
+            parser->processGPSData(&corpus[offset], length);
+            if (parser->isNewDataAvailable()) {
+                parser->clearNewDataFlag();
+                GPSParser::Fix fix;
+                parser->getFix(fix);
+                if (fields & GPSParser::FIELD_POSITION) {
+                    parser->formatPosition(fix, text, sizeof(text));
+                }
+                parser->formatTime(fix, text, sizeof(text));
+                fixes++;
+            }
+        }
+        bytes += corpus.size();
+        passes++;
+        elapsed = seconds() - start;
+    } while (elapsed < BENCH_MIN_SECONDS);
+    size_t allocations = allocationCount - parserAllocations;
+    
+    GPSParser::Stats stats = parser->getStats();
+    uint32_t sentences = stats.accepted + stats.rejected + stats.truncated + stats.overflowed;
+    printf("%-28s %10.0f sentences/s %7.2f ns/byte %6.3f allocs/sentence %8zu B heap peak  (%u passes, %u fixes, %.1f%% rejected)\n",
+           name, sentences / elapsed, elapsed * 1e9 / bytes, sentences > 0 ? (double)allocations / sentences : 0.0,
+           heapPeak - heapBaseline, passes, fixes, sentences > 0 ? 100.0 * (sentences - stats.accepted) / sentences : 0.0);
+    delete parser;
+}
+
+// Field parsers against the C library conversion they replace
+static void benchFieldParsers() {
+    static const char* decimals[] = { "0.92", "545.4", "12.345", "-3.2", "84.40", "1.61", "0.013", "359.99" };
+    static const char* coordinates[] = { "5205.44435", "00507.28783", "4807.038", "01131.000" };
+    const uint32_t rounds = 2000000;
+    volatile int32_t sinkFixed = 0;
+    volatile double sinkDouble = 0;
+    
+    double start = seconds();
+    for (uint32_t i = 0; i < rounds; i++) {
+        int32_t value;
+        nmeaParseFixed(decimals[i & 7], 2, value);
+        sinkFixed = sinkFixed + value;
+    }
+    double fixedTime = seconds() - start;
+    
+    start = seconds();
+    for (uint32_t i = 0; i < rounds; i++) {
+        sinkDouble = sinkDouble + strtod(decimals[i & 7], nullptr);
+    }
+    double strtodTime = seconds() - start;
+    
+    start = seconds();
+    for (uint32_t i = 0; i < rounds; i++) {
+        int32_t value;
+        nmeaParseCoordinate(coordinates[i & 3], (i & 1) ? 'E' : 'N', value);
+        sinkFixed = sinkFixed + value;
+    }
+    double coordinateTime = seconds() - start;
+    
+    start = seconds();
+    for (uint32_t i = 0; i < rounds; i++) {
+        uint32_t value;
+        nmeaParseTime("101512.25", value);
+        sinkFixed = sinkFixed + value;
+    }
+    double timeTime = seconds() - start;
+    
+    printf("%-28s %7.2f ns/field (strtod %.2f ns/field)\n", "nmeaParseFixed", fixedTime * 1e9 / rounds,
+           strtodTime * 1e9 / rounds);
+    printf("%-28s %7.2f ns/field\n", "nmeaParseCoordinate", coordinateTime * 1e9 / rounds);
+    printf("%-28s %7.2f ns/field\n", "nmeaParseTime", timeTime * 1e9 / rounds);
+}
+
+static void benchLogFormat() {
+    const uint32_t rounds = 1000000;
+    char record[LOG_RECORD_MAX_LENGTH];
+    volatile size_t sink = 0;
+    
+    resetHeapCounters();
+    double start = seconds();
+    for (uint32_t i = 0; i < rounds; i++) {
+        sink = sink + formatLogRecord(record, sizeof(record), "GPS-ESP32", i, "INFO",
+                                      "GPS Update: Pos=52\xc2\xb0" "05.44'N 005\xc2\xb0" "07.29'E, Speed=12.30, Sats=12");
+    }
+    double elapsed = seconds() - start;
+    printf("%-28s %7.2f ns/record %6.3f allocs/record\n", "formatLogRecord", elapsed * 1e9 / rounds,
+           (double)allocationCount / rounds);
+}
+
+int main(int argc, char** argv) {
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; i++) {
+        paths.push_back(argv[i]);
+    }
+    if (paths.empty()) {
+        paths.assign(defaultCorpora, defaultCorpora + sizeof(defaultCorpora) / sizeof(defaultCorpora[0]));
+    }
+    
+    printf("sizeof(GPSParser) = %zu B, sizeof(GPSParser::Fix) = %zu B\n\n", sizeof(GPSParser), sizeof(GPSParser::Fix));
+    
+    for (size_t i = 0; i < paths.size(); i++) {
+        std::vector<uint8_t> corpus;
+        if (!loadFile(paths[i], corpus) || corpus.empty()) {
+            fprintf(stderr, "Cannot read corpus %s\n", paths[i]);
+            return 1;
+        }
+        const char* name = strrchr(paths[i], '/') != nullptr ? strrchr(paths[i], '/') + 1 : paths[i];
+        benchParser(name, corpus);
+        std::string baselineName = std::string(name) + " String";
+        benchStringParser(baselineName.c_str(), corpus);
+        
+        // Screens that show less need less decoding
+        std::string subsetName = std::string(name) + " compass";
+        benchParser(subsetName.c_str(), corpus, GPSParser::FIELD_SPEED | GPSParser::FIELD_COURSE);
+        subsetName = std::string(name) + " time only";
+        benchParser(subsetName.c_str(), corpus, GPSParser::FIELD_TIME);
+        
+        std::string noisyName = std::string(name) + " +noise";
+        addNoise(corpus, 500);
+        benchParser(noisyName.c_str(), corpus);
+    }
+    
+    printf("\n");
+    for (size_t i = 0; i < paths.size(); i++) {
+        std::vector<uint8_t> corpus;
+        loadFile(paths[i], corpus);
+        const char* name = strrchr(paths[i], '/') != nullptr ? strrchr(paths[i], '/') + 1 : paths[i];
+        benchInputPaths(name, corpus);
+    }
+    std::vector<uint8_t> capture;
+    synthesizeCapture(capture);
+    benchInputPaths("synthetic 10 Hz capture", capture);
+    
+    printf("\n");
+    benchPipeline();
+    
+    printf("\n");
+    benchFieldParsers();
+    benchLogFormat();
+    
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("\npeak resident set %ld KB\n", usage.ru_maxrss);
+    return failures == 0 ? 0 : 1;
+}
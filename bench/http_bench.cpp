@@ -0,0 +1,238 @@
+// Host benchmark for HTTPConnection against a stand-in log server on the
+// loopback interface (env:http).
+//
+//   pio run -e http && .pio/build/http/program [requests]
+//
+// Posts log records the way TCPLogger did before, with a new connection per
+// record as HTTPClient made it, and over one keep-alive connection. Reports
+// requests/s and the p50/p99 request time. Two more runs check the fallbacks:
+// a server that answers HTTP/1.0 and closes after every response (like the
+// Flask development server), and one that drops idle keep-alive connections.
+
+#include <Arduino.h>
+#include <Client.h>
+#include <errno.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "HTTPConnection.h"
+#include "LogFormat.h"
+
+#define BENCH_REQUESTS 5000
+#define BENCH_HOST "127.0.0.1"
+#define BENCH_PATH "/api/log"
+
+// Client over a POSIX socket, Nagle off as TCPLogger sets it
+class SocketClient : public Client {
+public:
+    SocketClient() : socketFd(-1) {}
+    ~SocketClient() { stop(); }
+    
+    int connect(const char* host, uint16_t port) override {
+        stop();
+        socketFd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        inet_pton(AF_INET, host, &address.sin_addr);
+        if (::connect(socketFd, (sockaddr*)&address, sizeof(address)) != 0) {
+            stop();
+            return 0;
+        }
+        int on = 1;
+        setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        return 1;
+    }
+    
+    size_t write(const uint8_t* buffer, size_t size) override {
+        ssize_t written = socketFd < 0 ? -1 : send(socketFd, buffer, size, MSG_NOSIGNAL);
+        return written < 0 ? 0 : written;
+    }
+    
+    int available() override {
+        int count = 0;
+        if (socketFd < 0 || ioctl(socketFd, FIONREAD, &count) != 0) {
+            return 0;
+        }
+        return count;
+    }
+    
+    int read() override {
+        uint8_t c;
+        return read(&c, 1) == 1 ? c : -1;
+    }
+    
+    int read(uint8_t* buffer, size_t size) override {
+        ssize_t count = socketFd < 0 ? -1 : recv(socketFd, buffer, size, MSG_DONTWAIT);
+        return count < 0 ? -1 : count;
+    }
+    
+    void stop() override {
+        if (socketFd >= 0) {
+            close(socketFd);
+            socketFd = -1;
+        }
+    }
+    
+    uint8_t connected() override {
+        if (socketFd < 0) {
+            return 0;
+        }
+        // Readable data or nothing yet: open. End of stream: closed by the peer.
+        uint8_t c;
+        ssize_t count = recv(socketFd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        return count > 0 || (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+    }
+
+private:
+    int socketFd;
+};
+
+// Stand-in log server, a thread per connection
+struct Server {
+    enum Mode {
+        KEEP_ALIVE,    // HTTP/1.1, answers on the same connection until the client closes it
+        CLOSE,         // HTTP/1.0, closes after every response
+        DROP_IDLE      // HTTP/1.1, but closes silently after every few responses
+    };
+    
+    Mode mode;
+    int listenFd;
+    uint16_t port;
+    std::atomic<uint32_t> requests;
+    std::atomic<uint32_t> connections;
+    std::thread acceptor;
+    
+    Server(Mode mode) : mode(mode), requests(0), connections(0) {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        inet_pton(AF_INET, BENCH_HOST, &address.sin_addr);
+        bind(listenFd, (sockaddr*)&address, sizeof(address));
+        socklen_t length = sizeof(address);
+        getsockname(listenFd, (sockaddr*)&address, &length);
+        port = ntohs(address.sin_port);
+        listen(listenFd, 64);
+        acceptor = std::thread([this]() { accepting(); });
+    }
+    
+    ~Server() {
+        shutdown(listenFd, SHUT_RDWR);
+        close(listenFd);
+        acceptor.join();
+    }
+    
+    void accepting() {
+        while (true) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd < 0) {
+                return;
+            }
+            connections++;
+            std::thread([this, fd]() { serve(fd); }).detach();
+        }
+    }
+    
+    void serve(int fd) {
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        std::string input;
+        char buffer[4096];
+        uint32_t served = 0;
+        while (true) {
+            // One request: headers, then Content-Length bytes of body
+            size_t end;
+            while ((end = input.find("\r\n\r\n")) == std::string::npos) {
+                ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+                if (count <= 0) {
+                    close(fd);
+                    return;
+                }
+                input.append(buffer, count);
+            }
+            size_t lengthAt = input.find("Content-Length: ");
+            size_t body = lengthAt < end ? atol(input.c_str() + lengthAt + 16) : 0;
+            while (input.size() < end + 4 + body) {
+                ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+                if (count <= 0) {
+                    close(fd);
+                    return;
+                }
+                input.append(buffer, count);
+            }
+            input.erase(0, end + 4 + body);
+            requests++;
+            served++;
+            
+            static const char ok[] = "{\"status\":\"ok\"}";
+            int length = snprintf(buffer, sizeof(buffer), "%s 200 OK\r\nContent-Type: application/json\r\n"
+                                  "Content-Length: %zu\r\n\r\n%s", mode == CLOSE ? "HTTP/1.0" : "HTTP/1.1",
+                                  sizeof(ok) - 1, ok);
+            send(fd, buffer, length, MSG_NOSIGNAL);
+            if (mode == CLOSE || (mode == DROP_IDLE && served % 16 == 0)) {
+                close(fd);
+                return;
+            }
+        }
+    }
+};
+
+static double percentile(std::vector<double>& times, double percent) {
+    std::sort(times.begin(), times.end());
+    return times[std::min(times.size() - 1, (size_t)(times.size() * percent / 100))];
+}
+
+static void run(const char* name, Server::Mode mode, bool reuse, uint32_t requests) {
+    Server server(mode);
+    char record[LOG_RECORD_MAX_LENGTH];
+    size_t length = formatLogRecord(record, sizeof(record), "GPS-ESP32", 1710497712000ULL, "INFO",
+                                    "GPS Update: Pos=52.0907392,5.0728783, Speed=12.34, Sats=9");
+    
+    SocketClient client;
+    HTTPConnection* connection = new HTTPConnection(client, BENCH_HOST, server.port, BENCH_PATH, "application/json");
+    std::vector<double> times;
+    uint32_t failures = 0;
+    uint64_t start = nativeMicros();
+    for (uint32_t i = 0; i < requests; i++) {
+        uint64_t requestStart = nativeMicros();
+        if (!reuse) {
+            // What HTTPClient did for every record: connect, post, close
+            connection->close();
+        }
+        if (connection->post((const uint8_t*)record, length) != 200) {
+            failures++;
+        }
+        times.push_back((nativeMicros() - requestStart) / 1000.0);
+    }
+    if (!reuse) {
+        connection->close();
+    }
+    double seconds = (nativeMicros() - start) / 1e6;
+    
+    printf("%-28s %8.0f requests/s  p50 %6.3f ms  p99 %6.3f ms  %5u connections  %u failed\n", name,
+           requests / seconds, percentile(times, 50), percentile(times, 99), (unsigned)connection->getConnects(),
+           (unsigned)failures);
+    if (server.requests != requests - failures) {
+        printf("  server saw %u requests\n", (unsigned)server.requests.load());
+    }
+    delete connection;
+}
+
+int main(int argc, char** argv) {
+    uint32_t requests = argc > 1 ? atoi(argv[1]) : BENCH_REQUESTS;
+    
+    printf("%u log records posted to a local stand-in server\n", (unsigned)requests);
+    run("connection per request", Server::KEEP_ALIVE, false, requests);
+    run("keep-alive", Server::KEEP_ALIVE, true, requests);
+    run("keep-alive, HTTP/1.0 server", Server::CLOSE, true, requests);
+    run("keep-alive, idle drops", Server::DROP_IDLE, true, requests);
+    return 0;
+}
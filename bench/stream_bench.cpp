@@ -0,0 +1,254 @@
+// Host test of NMEAStream against a stand-in TCP sink on the loopback
+// interface (env:stream).
+//
+//   pio run -e stream && .pio/build/stream/program [seconds]
+//   nc -lk 10110 > out.nmea & .pio/build/stream/program 127.0.0.1 10110 [seconds]
+//
+// The synthetic receiver sends at 20 times its 10 Hz real time, about
+// 90 KB/s, into the stream. The built-in sink checks every line it receives
+// for a valid NMEA checksum in three runs: reading as fast as it can, reading
+// 25 KB/s so that the buffer fills and lines are dropped, and closing the
+// connection every 64 KB so that the stream reconnects. Given a host and port
+// it streams to that sink instead and reports once per second.
+
+#include <Arduino.h>
+#include <errno.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "GPSSource.h"
+#include "NMEAStream.h"
+
+#define BENCH_HOST "127.0.0.1"
+#define BENCH_RECEIVER_RATE 10     // Hz
+#define BENCH_RECEIVER_SPEED 100   // Times real time
+#define BENCH_SLOW_READ 512        // Bytes per read of the slow sink, every 20 ms
+#define BENCH_RESTART_BYTES 65536  // The restarting sink closes after this many
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        printf("  FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+// "$...*hh\r\n" with the XOR of the characters between '$' and '*'
+static bool validSentence(const std::string& line) {
+    if (line.size() < 6 || line[0] != '$' || line.compare(line.size() - 2, 2, "\r\n") != 0) {
+        return false;
+    }
+    size_t star = line.size() - 5;
+    if (line[star] != '*') {
+        return false;
+    }
+    uint8_t checksum = 0;
+    for (size_t i = 1; i < star; i++) {
+        checksum ^= (uint8_t)line[i];
+    }
+    return strtoul(line.substr(star + 1, 2).c_str(), nullptr, 16) == checksum;
+}
+
+// Stand-in sink, one connection at a time as nc -lk
+struct Sink {
+    enum Mode {
+        FAST,
+        SLOW,
+        RESTART
+    };
+    
+    Mode mode;
+    int listenFd;
+    uint16_t port;
+    std::atomic<bool> open;
+    std::atomic<uint32_t> lines;
+    std::atomic<uint32_t> bad;
+    std::atomic<uint32_t> fragments;   // Incomplete lines at the end of a connection
+    std::atomic<uint32_t> connections;
+    std::thread acceptor;
+    
+    Sink(Mode mode) : mode(mode), open(false), lines(0), bad(0), fragments(0), connections(0) {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (mode == SLOW) {
+            // A small window, so that the sender feels the slow reader soon
+            int size = 4096;
+            setsockopt(listenFd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        }
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        inet_pton(AF_INET, BENCH_HOST, &address.sin_addr);
+        bind(listenFd, (sockaddr*)&address, sizeof(address));
+        socklen_t length = sizeof(address);
+        getsockname(listenFd, (sockaddr*)&address, &length);
+        port = ntohs(address.sin_port);
+        listen(listenFd, 1);
+        acceptor = std::thread([this]() { accepting(); });
+    }
+    
+    ~Sink() {
+        shutdown(listenFd, SHUT_RDWR);
+        close(listenFd);
+        acceptor.join();
+    }
+    
+    void accepting() {
+        while (true) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd < 0) {
+                return;
+            }
+            connections++;
+            open = true;
+            serve(fd);
+            open = false;
+        }
+    }
+    
+    void serve(int fd) {
+        std::string line;
+        char buffer[4096];
+        size_t total = 0;
+        while (true) {
+            size_t cap = (mode == SLOW) ? BENCH_SLOW_READ : sizeof(buffer);
+            ssize_t count = recv(fd, buffer, cap, 0);
+            if (count <= 0) {
+                break;
+            }
+            for (ssize_t i = 0; i < count; i++) {
+                line += buffer[i];
+                if (buffer[i] == '\n') {
+                    if (validSentence(line)) {
+                        lines++;
+                    }
+                    else {
+                        bad++;
+                    }
+                    line.clear();
+                }
+            }
+            total += count;
+            if (mode == SLOW) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+            if (mode == RESTART && total >= BENCH_RESTART_BYTES) {
+                // Whatever is still in flight is lost with the connection
+                break;
+            }
+        }
+        if (!line.empty()) {
+            fragments++;
+        }
+        close(fd);
+    }
+};
+
+// Feed the stream from the synthetic receiver for the given time, calling
+// process() between reads as the loop does. Returns the bytes fed.
+static size_t feed(NMEAStream& stream, double seconds, bool report) {
+    SyntheticGPSSource::Settings settings = SyntheticGPSSource::defaultSettings();
+    settings.rateHz = BENCH_RECEIVER_RATE;
+    SyntheticGPSSource source(settings);
+    source.setSpeed(BENCH_RECEIVER_SPEED);
+    
+    uint8_t block[256];
+    size_t bytes = 0;
+    unsigned long start = millis();
+    unsigned long lastReport = start;
+    NMEAStream::Stats last = stream.getStats();
+    while (millis() - start < seconds * 1000) {
+        size_t count;
+        while ((count = source.read(block, sizeof(block))) > 0) {
+            stream.write(block, count);
+            bytes += count;
+        }
+        stream.process();
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+        
+        if (report && millis() - lastReport >= 1000) {
+            NMEAStream::Stats stats = stream.getStats();
+            printf("%7lu lines/s %9lu bytes/s  dropped %lu lines  waiting %lu  %s\n",
+                   (unsigned long)(stats.lines - last.lines), (unsigned long)(stats.written - last.written),
+                   (unsigned long)(stats.droppedLines - last.droppedLines), (unsigned long)stats.waiting,
+                   stream.isConnected() ? "connected" : "not connected");
+            last = stats;
+            lastReport = millis();
+        }
+    }
+    return bytes;
+}
+
+// Write out what is left, until the socket takes no more for a while, then close
+static void drain(NMEAStream& stream) {
+    unsigned long start = millis();
+    unsigned long lastProgress = start;
+    uint32_t written = stream.getStats().written;
+    while (millis() - start < 5000 && millis() - lastProgress < 300) {
+        stream.process();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        NMEAStream::Stats stats = stream.getStats();
+        if (stats.written != written || stats.waiting > 0 || !stream.isConnected()) {
+            written = stats.written;
+            lastProgress = millis();
+        }
+    }
+    stream.close();
+}
+
+static void run(const char* name, Sink::Mode mode, double seconds) {
+    Sink* sink = new Sink(mode);
+    NMEAStream stream(BENCH_HOST, sink->port);
+    size_t bytes = feed(stream, seconds, false);
+    drain(stream);
+    
+    // Until the sink has read everything and seen the connection close
+    unsigned long start = millis();
+    while (sink->open && millis() - start < 5000) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    NMEAStream::Stats stats = stream.getStats();
+    printf("%-16s %6.1f KB/s in %6.1f KB/s out  %6lu lines  %5lu dropped  %3lu connects  "
+           "sink: %6lu lines %lu bad %lu cut\n", name, bytes / seconds / 1024, stats.written / seconds / 1024,
+           (unsigned long)stats.lines, (unsigned long)stats.droppedLines, (unsigned long)stats.connects,
+           (unsigned long)sink->lines.load(), (unsigned long)sink->bad.load(), (unsigned long)sink->fragments.load());
+    
+    check(sink->bad == 0, "the sink received a garbled line");
+    check(stats.lines + stats.droppedLines > 0, "nothing was fed");
+    if (mode != Sink::RESTART) {
+        check(sink->fragments == 0, "the stream ended in the middle of a line");
+        check(sink->lines == stats.lines, "the sink did not receive every line put into the buffer");
+    }
+    if (mode == Sink::SLOW) {
+        check(stats.droppedLines > 0, "the slow sink never caused a drop");
+    }
+    if (mode == Sink::RESTART) {
+        check(stats.connects > 1, "the stream did not reconnect");
+    }
+    delete sink;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 2) {
+        // An external sink, e.g. nc -lk 10110
+        double seconds = argc > 3 ? atof(argv[3]) : 10.0;
+        NMEAStream stream(argv[1], atoi(argv[2]));
+        feed(stream, seconds, true);
+        drain(stream);
+        return 0;
+    }
+    
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    printf("Synthetic receiver at %u Hz, %u times real time, for %.1f s per run\n", BENCH_RECEIVER_RATE,
+           BENCH_RECEIVER_SPEED, seconds);
+    run("fast sink", Sink::FAST, seconds);
+    run("slow sink", Sink::SLOW, seconds);
+    run("restarting sink", Sink::RESTART, seconds);
+    return failures == 0 ? 0 : 1;
+}
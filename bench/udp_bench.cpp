@@ -0,0 +1,245 @@
+// Host test of NMEAUdp against a UDP listener on the loopback interface
+// (env:udp).
+//
+//   pio run -e udp && .pio/build/udp/program [seconds]
+//   nc -ul 10110 & .pio/build/udp/program 127.0.0.1 10110 [sentence|epoch] [seconds]
+//
+// The synthetic receiver at 10 Hz, five times real time, feeds the output
+// with a bad sentence slipped in between some epochs. The listener checks
+// every datagram: only valid sentences, and in epoch mode only the sentences
+// of one epoch. Runs a datagram per sentence and per epoch to a unicast
+// address, then per epoch to a multicast group. Given an address and port it
+// sends there instead and reports the per second counters.
+
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "GPSSource.h"
+#include "NMEAUdp.h"
+
+#define BENCH_RECEIVER_RATE 10     // Hz
+#define BENCH_RECEIVER_SPEED 5     // Times real time
+#define BENCH_BAD_EVERY 7          // Epoch gaps between bad sentences
+#define BENCH_MULTICAST "239.192.0.1"
+
+static const char badSentence[] = "$GPGGA,100000.00,5205.00000,N,00504.00000,E,1,10,0.90,10.0,M,46.0,M,,*00\r\n";
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        printf("  FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+// "$...*hh\r\n" with the XOR of the characters between '$' and '*'
+static bool validSentence(const std::string& line) {
+    if (line.size() < 6 || line[0] != '$' || line.compare(line.size() - 2, 2, "\r\n") != 0) {
+        return false;
+    }
+    size_t star = line.size() - 5;
+    if (line[star] != '*') {
+        return false;
+    }
+    uint8_t checksum = 0;
+    for (size_t i = 1; i < star; i++) {
+        checksum ^= (uint8_t)line[i];
+    }
+    return strtoul(line.substr(star + 1, 2).c_str(), nullptr, 16) == checksum;
+}
+
+// Time field of the sentences that have one in field 1, empty for the others
+static std::string timeOf(const std::string& line) {
+    static const char* const types[] = { "GGA", "RMC", "GNS", "ZDA" };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (line.compare(3, 3, types[i]) == 0) {
+            return line.substr(7, line.find(',', 7) - 7);
+        }
+    }
+    return "";
+}
+
+struct Listener {
+    int fd;
+    uint16_t port;
+    bool sameEpoch;                       // Every datagram is to hold one epoch
+    std::atomic<bool> stop;
+    std::atomic<uint32_t> packets;
+    std::atomic<uint32_t> bytes;
+    std::atomic<uint32_t> sentences;
+    std::atomic<uint32_t> bad;
+    std::atomic<uint32_t> mixed;          // Datagrams with sentences of more than one epoch
+    std::thread reader;
+    
+    Listener(const char* group, bool sameEpoch) :
+        sameEpoch(sameEpoch), stop(false), packets(0), bytes(0), sentences(0), bad(0), mixed(0) {
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        bind(fd, (sockaddr*)&address, sizeof(address));
+        socklen_t length = sizeof(address);
+        getsockname(fd, (sockaddr*)&address, &length);
+        port = ntohs(address.sin_port);
+        if (group != nullptr) {
+            ip_mreq membership = {};
+            inet_pton(AF_INET, group, &membership.imr_multiaddr);
+            membership.imr_interface.s_addr = htonl(INADDR_ANY);
+            setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership));
+        }
+        timeval timeout = { 0, 100000 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        reader = std::thread([this]() { reading(); });
+    }
+    
+    ~Listener() {
+        stop = true;
+        reader.join();
+        close(fd);
+    }
+    
+    void reading() {
+        char buffer[2048];
+        while (!stop) {
+            ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+            if (count <= 0) {
+                continue;
+            }
+            packets++;
+            bytes += count;
+            std::string epoch;
+            size_t start = 0;
+            while (start < (size_t)count) {
+                const char* end = (const char*)memchr(buffer + start, '\n', count - start);
+                size_t next = end != nullptr ? end - buffer + 1 : count;
+                std::string line(buffer + start, next - start);
+                start = next;
+                if (!validSentence(line)) {
+                    bad++;
+                    continue;
+                }
+                sentences++;
+                std::string time = timeOf(line);
+                if (sameEpoch && !time.empty()) {
+                    if (!epoch.empty() && time != epoch) {
+                        mixed++;
+                    }
+                    epoch = time;
+                }
+            }
+        }
+    }
+};
+
+// Feed the output from the synthetic receiver for the given time, a bad
+// sentence between some epochs. Returns the bad sentences fed.
+static uint32_t feed(NMEAUdp& output, double seconds, uint32_t& epochs, bool report) {
+    SyntheticGPSSource::Settings settings = SyntheticGPSSource::defaultSettings();
+    settings.rateHz = BENCH_RECEIVER_RATE;
+    SyntheticGPSSource source(settings);
+    source.setSpeed(report ? 1 : BENCH_RECEIVER_SPEED);
+    
+    uint8_t block[256];
+    uint32_t badFed = 0;
+    uint32_t lastEpoch = 0;
+    unsigned long start = millis();
+    unsigned long lastReport = start;
+    while (millis() - start < seconds * 1000) {
+        size_t count;
+        while ((count = source.read(block, sizeof(block))) > 0) {
+            output.write(block, count);
+            // Only between sentences, one cut in the middle would be rejected too
+            if (block[count - 1] == '\n' && source.getEpochs() != lastEpoch &&
+                source.getEpochs() % BENCH_BAD_EVERY == 0) {
+                output.write((const uint8_t*)badSentence, sizeof(badSentence) - 1);
+                lastEpoch = source.getEpochs();
+                badFed++;
+            }
+        }
+        output.process();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        
+        if (report && millis() - lastReport >= 1000) {
+            NMEAUdp::Stats stats = output.getStats();
+            printf("%5lu packets/s %7lu bytes/s  %lu sentences, %lu rejected, %lu failed\n",
+                   (unsigned long)stats.packetsPerSecond, (unsigned long)stats.bytesPerSecond,
+                   (unsigned long)stats.sentences, (unsigned long)stats.rejected, (unsigned long)stats.failed);
+            lastReport = millis();
+        }
+    }
+    output.flush();
+    epochs = source.getEpochs();
+    return badFed;
+}
+
+static void run(const char* name, NMEAUdp::Mode mode, bool toGroup, double seconds) {
+    Listener* listener = new Listener(toGroup ? BENCH_MULTICAST : nullptr, mode == NMEAUdp::EPOCH);
+    NMEAUdp output(toGroup ? BENCH_MULTICAST : "127.0.0.1", listener->port, mode);
+    if (!output.begin()) {
+        printf("%-22s could not open the socket\n", name);
+        failures++;
+        delete listener;
+        return;
+    }
+    uint32_t epochs;
+    uint32_t badFed = feed(output, seconds, epochs, false);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    // Closes the second a short run may end in
+    output.process();
+    
+    NMEAUdp::Stats stats = output.getStats();
+    printf("%-22s %5lu epochs %6lu sentences  %5lu packets/s %7lu bytes/s  %lu rejected  %lu failed  "
+           "listener: %lu packets %lu sentences %lu bad %lu mixed\n", name, (unsigned long)epochs,
+           (unsigned long)stats.sentences, (unsigned long)stats.packetsPerSecond, (unsigned long)stats.bytesPerSecond,
+           (unsigned long)stats.rejected, (unsigned long)stats.failed, (unsigned long)listener->packets.load(),
+           (unsigned long)listener->sentences.load(), (unsigned long)listener->bad.load(),
+           (unsigned long)listener->mixed.load());
+    
+    check(stats.sentences > 0 && stats.failed == 0, "nothing sent, or datagrams failed");
+    check(stats.rejected == badFed, "rejected sentences do not match the bad ones fed");
+    check(listener->bad == 0, "the listener received a bad sentence");
+    check(listener->packets == stats.packets && listener->bytes == stats.bytes, "the listener missed datagrams");
+    check(listener->sentences == stats.sentences, "the listener missed sentences");
+    check(seconds < 1 || stats.packetsPerSecond > 0, "no per second counts");
+    if (mode == NMEAUdp::EPOCH) {
+        check(listener->mixed == 0, "a datagram held sentences of two epochs");
+        // One per epoch, and one for the satellite sentences the receiver adds
+        // once a second. A couple more before there is an expected count.
+        check(stats.packets <= epochs + epochs / BENCH_RECEIVER_RATE + 2, "more datagrams than epochs");
+    }
+    else {
+        check(stats.packets == stats.sentences, "not one datagram per sentence");
+    }
+    delete listener;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 2) {
+        // An external listener, e.g. nc -ul 10110 or OpenCPN
+        NMEAUdp::Mode mode = (argc > 3 && strcmp(argv[3], "sentence") == 0) ? NMEAUdp::SENTENCE : NMEAUdp::EPOCH;
+        double seconds = argc > 4 ? atof(argv[4]) : 10.0;
+        NMEAUdp output(argv[1], atoi(argv[2]), mode);
+        if (!output.begin()) {
+            printf("Could not open the socket to %s\n", argv[1]);
+            return 1;
+        }
+        uint32_t epochs;
+        feed(output, seconds, epochs, true);
+        return 0;
+    }
+    
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    printf("Synthetic receiver at %u Hz, %u times real time, for %.1f s per run\n", BENCH_RECEIVER_RATE,
+           BENCH_RECEIVER_SPEED, seconds);
+    run("sentence, unicast", NMEAUdp::SENTENCE, false, seconds);
+    run("epoch, unicast", NMEAUdp::EPOCH, false, seconds);
+    run("epoch, multicast", NMEAUdp::EPOCH, true, seconds);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,236 @@
+// Host harness for GPSFilter (env:filter).
+//
+//   pio run -e filter && .pio/build/filter/program [log.nmea|log.gpsrec ...]
+//
+// Synthetic routes are driven by a noisy 1 Hz receiver and, for ground truth,
+// a noise free 25 Hz one over the same route. The filter prediction at each
+// 25 Hz step is compared with the truth, next to what the screens showed
+// before: the last fix, held until the next one.
+//
+// Recorded logs have no ground truth. For those every fix is predicted from
+// the ones before it and compared with what the receiver then reported.
+
+#include <Arduino.h>
+#include <vector>
+#include "GPSParser.h"
+#include "GPSSource.h"
+#include "GPSFilter.h"
+
+#define REPLAY_SECONDS 1800
+#define REPLAY_TRUTH_RATE 25
+#define REPLAY_BLOCK_SIZE 64   // Smaller than an epoch, so no fix is missed between reads
+#define REPLAY_COURSE_SPEED 1.0f  // m/s, course errors only count above this speed
+
+#define METERS_PER_DEGREE 111320.0
+#define METERS_PER_SECOND_PER_KNOT 0.514444
+
+static const char* defaultLogs[] = {
+    "bench/corpus/gn_multi_1hz.nmea"
+};
+
+struct Scenario {
+    const char* name;
+    float speed;     // m/s
+    float noise;     // m
+    float hdop;
+};
+
+// Errors against a reference, accumulated as sums of squares
+struct Errors {
+    double position = 0;
+    double speed = 0;
+    double course = 0;
+    uint32_t count = 0;
+    uint32_t courseCount = 0;
+    
+    void add(int32_t latitudeE7, int32_t longitudeE7, float speedKnots, float course,
+             const GPSParser::Fix& reference) {
+        double north = (latitudeE7 - reference.latitudeE7) * 1e-7 * METERS_PER_DEGREE;
+        double east = ((int64_t)longitudeE7 - reference.longitudeE7) * 1e-7 * METERS_PER_DEGREE *
+                      cos(reference.latitudeE7 * 1e-7 * M_PI / 180);
+        position += north * north + east * east;
+        double speedError = (speedKnots - reference.speed) * METERS_PER_SECOND_PER_KNOT;
+        speed += speedError * speedError;
+        count++;
+        if (reference.speed * METERS_PER_SECOND_PER_KNOT >= REPLAY_COURSE_SPEED) {
+            double courseError = fmod(course - reference.course + 540.0, 360.0) - 180.0;
+            this->course += courseError * courseError;
+            courseCount++;
+        }
+    }
+    
+    double rms(double sum, uint32_t n) const { return n > 0 ? sqrt(sum / n) : 0.0; }
+    double positionRMS() const { return rms(position, count); }
+    double speedRMS() const { return rms(speed, count); }
+    double courseRMS() const { return rms(course, courseCount); }
+};
+
+static int64_t fixTime(const GPSParser::Fix& fix) {
+    return gpsUnixMillis(fix.date, fix.timeOfDay);
+}
+
+// Every fix with a valid position the source delivers, up to a time limit
+static void collectFixes(GPSSource& source, std::vector<GPSParser::Fix>& fixes, uint32_t seconds) {
+    GPSParser parser;
+    uint8_t block[REPLAY_BLOCK_SIZE];
+    uint32_t sequence = 0;
+    int64_t end = 0;
+    while (true) {
+        size_t length = source.read(block, sizeof(block));
+        if (length == 0) {
+            if (source.finished()) {
+                return;
+            }
+            continue;
+        }
+        parser.processGPSData(block, length);
+        if (parser.getFixSequence() == sequence) {
+            continue;
+        }
+        sequence = parser.getFixSequence();
+        
+        GPSParser::Fix fix;
+        parser.getFix(fix);
+        if (!fix.validPosition || !fix.validTime) {
+            continue;
+        }
+        if (end == 0) {
+            end = fixTime(fix) + (int64_t)seconds * 1000;
+        }
+        if (fixTime(fix) > end) {
+            return;
+        }
+        fixes.push_back(fix);
+    }
+}
+
+static void replayScenario(const Scenario& scenario) {
+    // A block of about 500 x 470 m, driven clockwise with four sharp turns
+    static const SyntheticGPSSource::Waypoint route[] = {
+        { 520907392, 50728783 }, { 520950000, 50728783 }, { 520950000, 50800000 }, { 520907392, 50800000 }
+    };
+    
+    SyntheticGPSSource::Settings settings = SyntheticGPSSource::defaultSettings();
+    settings.route = route;
+    settings.waypoints = 4;
+    settings.speed = scenario.speed;
+    settings.noise = scenario.noise;
+    settings.hdop = scenario.hdop;
+    settings.rateHz = 1;
+    SyntheticGPSSource receiver(settings);
+    receiver.setSpeed(GPS_SOURCE_SPEED_FAST);
+    
+    settings.noise = 0;
+    settings.rateHz = REPLAY_TRUTH_RATE;
+    SyntheticGPSSource truthReceiver(settings);
+    truthReceiver.setSpeed(GPS_SOURCE_SPEED_FAST);
+    
+    std::vector<GPSParser::Fix> fixes;
+    std::vector<GPSParser::Fix> truth;
+    collectFixes(receiver, fixes, REPLAY_SECONDS);
+    collectFixes(truthReceiver, truth, REPLAY_SECONDS);
+    
+    // Step through the truth, feeding the filter every fix that is due by then
+    GPSFilter filter;
+    Errors held;
+    Errors predicted;
+    Errors atFix;
+    Errors filteredAtFix;
+    size_t next = 0;
+    size_t truthIndex = 0;
+    for (size_t i = 0; i < truth.size(); i++) {
+        int64_t time = fixTime(truth[i]);
+        while (next < fixes.size() && fixTime(fixes[next]) <= time) {
+            filter.update(fixes[next++]);
+        }
+        if (next == 0) {
+            continue;
+        }
+        
+        const GPSParser::Fix& last = fixes[next - 1];
+        GPSFilter::Estimate estimate;
+        if (!filter.predict(time, estimate)) {
+            continue;
+        }
+        held.add(last.latitudeE7, last.longitudeE7, last.speed, last.course, truth[i]);
+        predicted.add(estimate.latitudeE7, estimate.longitudeE7, estimate.speed, estimate.course, truth[i]);
+        
+        // The fixes themselves against the filter right after taking them in
+        if (fixTime(last) == time) {
+            atFix.add(last.latitudeE7, last.longitudeE7, last.speed, last.course, truth[i]);
+            filteredAtFix.add(estimate.latitudeE7, estimate.longitudeE7, estimate.speed, estimate.course, truth[i]);
+        }
+        truthIndex++;
+    }
+    
+    printf("%-20s %5zu fixes %6u steps  position %6.2f -> %6.2f m  (at fixes %5.2f -> %5.2f m)  "
+           "speed %5.2f -> %5.2f m/s  course %6.2f -> %6.2f deg\n",
+           scenario.name, fixes.size(), (unsigned)truthIndex, held.positionRMS(), predicted.positionRMS(),
+           atFix.positionRMS(), filteredAtFix.positionRMS(), held.speedRMS(), predicted.speedRMS(),
+           held.courseRMS(), predicted.courseRMS());
+}
+
+// Predict each fix of a log from the ones before it
+static bool replayLog(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        fprintf(stderr, "Cannot read log %s\n", path);
+        return false;
+    }
+    ReplayGPSSource source(file);
+    source.setSpeed(GPS_SOURCE_SPEED_FAST);
+    std::vector<GPSParser::Fix> fixes;
+    collectFixes(source, fixes, UINT32_MAX / 1000);
+    fclose(file);
+    
+    GPSFilter filter;
+    Errors held;
+    Errors predicted;
+    for (size_t i = 0; i < fixes.size(); i++) {
+        GPSFilter::Estimate estimate;
+        if (i > 0 && filter.predict(fixTime(fixes[i]), estimate)) {
+            const GPSParser::Fix& last = fixes[i - 1];
+            held.add(last.latitudeE7, last.longitudeE7, last.speed, last.course, fixes[i]);
+            predicted.add(estimate.latitudeE7, estimate.longitudeE7, estimate.speed, estimate.course, fixes[i]);
+        }
+        filter.update(fixes[i]);
+    }
+    
+    const char* name = strrchr(path, '/') != nullptr ? strrchr(path, '/') + 1 : path;
+    printf("%-20s %5zu fixes  next fix position %6.2f -> %6.2f m  speed %5.2f -> %5.2f m/s  "
+           "(%u restarts)\n", name, fixes.size(), held.positionRMS(), predicted.positionRMS(), held.speedRMS(),
+           predicted.speedRMS(), filter.getRestarts());
+    return true;
+}
+
+int main(int argc, char** argv) {
+    static const Scenario scenarios[] = {
+        { "standing", 0.0f, 2.5f, 0.9f },
+        { "walking", 1.4f, 2.5f, 0.9f },
+        { "cycling", 6.0f, 2.5f, 0.9f },
+        { "driving", 15.0f, 2.5f, 0.9f },
+        { "driving, poor sky", 15.0f, 8.0f, 3.0f }
+    };
+    
+    printf("RMS errors, last fix held -> filter prediction, against the truth at %u Hz over %u s\n",
+           REPLAY_TRUTH_RATE, REPLAY_SECONDS);
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        replayScenario(scenarios[i]);
+    }
+    
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; i++) {
+        paths.push_back(argv[i]);
+    }
+    if (paths.empty()) {
+        paths.assign(defaultLogs, defaultLogs + sizeof(defaultLogs) / sizeof(defaultLogs[0]));
+    }
+    
+    printf("\nRMS errors, last fix held -> filter prediction, against the next fix of the log\n");
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (!replayLog(paths[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+// Fuzz target for GPSParser::processGPSData().
+//
+// Coverage guided with libFuzzer (clang):
+//   clang++ -std=gnu++11 -g -O1 -fsanitize=fuzzer,address,undefined -I native -I src
+//       fuzz/fuzz_nmea.cpp src/GPSParser.cpp src/UBXParser.cpp src/NMEANumeric.cpp src/GPSTime.cpp
+//       src/LatencyHistogram.cpp -o fuzz_nmea
+// (one command, wrapped here)
+//   ./fuzz_nmea fuzz/corpus
+//
+// Replaying the seed corpus or crash files without libFuzzer (env:fuzz):
+//   pio run -e fuzz && .pio/build/fuzz/program fuzz/corpus/*
+//
+// Every input runs through a fresh parser and the published state is checked
+// against the parser's invariants, aborting on the first violation. The
+// parsing throughput is printed on exit so hardening can be weighed against speed.
+
+#include <Arduino.h>
+#include "GPSParser.h"
+
+static uint64_t fuzzBytes = 0;
+static uint64_t fuzzInputs = 0;
+static uint64_t fuzzNanoseconds = 0;
+
+#define FUZZ_CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "Invariant violated: %s (%s:%d)\n", #condition, __FILE__, __LINE__); \
+            abort(); \
+        } \
+    } while (0)
+
+static uint64_t nanoseconds() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void printThroughput() {
+    if (fuzzNanoseconds > 0) {
+        fprintf(stderr, "Parsed %llu inputs, %llu bytes at %.1f MB/s (%.2f ns/byte)\n",
+                (unsigned long long)fuzzInputs, (unsigned long long)fuzzBytes,
+                fuzzBytes * 1e3 / fuzzNanoseconds, (double)fuzzNanoseconds / max(fuzzBytes, (uint64_t)1));
+    }
+}
+
+static void checkFix(GPSParser& parser) {
+    GPSParser::Fix fix;
+    parser.getFix(fix);
+    
+    FUZZ_CHECK(fix.latitudeE7 >= -900000000 && fix.latitudeE7 <= 900000000);
+    FUZZ_CHECK(fix.longitudeE7 >= -1800000000 && fix.longitudeE7 <= 1800000000);
+    FUZZ_CHECK(fix.satellites >= 0 && fix.satellites <= 255);
+    FUZZ_CHECK(fix.fixMode >= 1 && fix.fixMode <= 3);
+    FUZZ_CHECK(fix.hdop >= 0 && fix.pdop >= 0 && fix.vdop >= 0);
+    FUZZ_CHECK(fix.speed >= 0);
+    FUZZ_CHECK(fix.course >= 0 && fix.course < 360);
+    FUZZ_CHECK(fix.timeOfDay < GPS_MS_PER_DAY + 1000);
+    FUZZ_CHECK(fix.date >= gpsDaysFromCivil(1980, 1, 1) && fix.date < gpsDaysFromCivil(2100, 1, 1));
+    FUZZ_CHECK(fix.utcMillis == 0 || fix.utcMillis == gpsUnixMillis(fix.date, fix.timeOfDay));
+    
+    // Formatting must fit the documented buffer sizes
+    char text[GPS_POSITION_TEXT_SIZE];
+    FUZZ_CHECK(parser.formatPosition(fix, text, sizeof(text)) < GPS_POSITION_TEXT_SIZE);
+    FUZZ_CHECK(parser.formatTime(fix, text, GPS_TIME_TEXT_SIZE) == GPS_TIME_TEXT_SIZE - 1);
+    FUZZ_CHECK(parser.formatDate(fix, text, GPS_DATE_TEXT_SIZE) == GPS_DATE_TEXT_SIZE - 1);
+    FUZZ_CHECK(GPSParser::formatFixType(fix, text, GPS_FIX_TYPE_TEXT_SIZE) < GPS_FIX_TYPE_TEXT_SIZE);
+    
+    // Satellite table entries stay within the ranges the sky plot draws
+    GPSParser::SatelliteInfo satellites[GPS_MAX_SATELLITES + 1];
+    int count = parser.getSatelliteInfo(satellites, GPS_MAX_SATELLITES + 1);
+    FUZZ_CHECK(count >= 0 && count <= GPS_MAX_SATELLITES);
+    FUZZ_CHECK(parser.getSatellitesInView() == count);
+    for (int i = 0; i < count; i++) {
+        FUZZ_CHECK(satellites[i].id > 0);
+        FUZZ_CHECK(satellites[i].elevation >= 0 && satellites[i].elevation <= 90);
+        FUZZ_CHECK(satellites[i].azimuth >= 0 && satellites[i].azimuth < 360);
+        FUZZ_CHECK(satellites[i].snr >= 0 && satellites[i].snr <= 99);
+        FUZZ_CHECK(satellites[i].constellation < GPSParser::CONSTELLATION_COUNT);
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    static bool registered = false;
+    if (!registered) {
+        atexit(printThroughput);
+        registered = true;
+    }
+    if (size < 1) {
+        return 0;
+    }
+    
+    // The first byte picks the protocol and where byte-wise feeding switches to
+    // block feeding, so both ingestion paths see the same kinds of input
+    GPSParser* parser = new GPSParser();
+    parser->setProtocol((GPSParser::Protocol)(data[0] % 3));
+    size_t split = 1 + (data[0] >> 2) * (size - 1) / 64;
+    if (split > size) {
+        split = size;
+    }
+    
+    uint64_t start = nanoseconds();
+    for (size_t i = 1; i < split; i++) {
+        parser->processGPSData((char)data[i]);
+    }
+    parser->processGPSData(data + split, size - split);
+    fuzzNanoseconds += nanoseconds() - start;
+    fuzzBytes += size - 1;
+    fuzzInputs++;
+    
+    checkFix(*parser);
+    GPSParser::Stats stats = parser->getStats();
+    FUZZ_CHECK(stats.accepted + stats.rejected + stats.truncated + stats.overflowed <= size);
+    
+    delete parser;
+    return 0;
+}
+
+#ifdef NMEA_FUZZ_REPLAY
+// Stand-in for the libFuzzer driver: run each file given on the command line once
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        FILE* file = fopen(argv[i], "rb");
+        if (file == nullptr) {
+            fprintf(stderr, "Cannot read %s\n", argv[i]);
+            return 1;
+        }
+        static uint8_t buffer[1 << 20];
+        size_t size = fread(buffer, 1, sizeof(buffer), file);
+        fclose(file);
+        LLVMFuzzerTestOneInput(buffer, size);
+    }
+    return 0;
+}
+#endif
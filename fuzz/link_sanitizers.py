@@ -0,0 +1,4 @@
+# The sanitizer runtimes have to be linked in as well, build_flags only reach the compiler
+Import("env")
+
+env.Append(LINKFLAGS=["-fsanitize=address,undefined"])
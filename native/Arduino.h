@@ -0,0 +1,93 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// Minimal stand-in for the Arduino core, enough to build the parser, the
+// receiver configurator and the log formatting on the host (env:native).
+// Nothing here talks to hardware.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <sched.h>
+#include <algorithm>
+#include <string>
+
+using std::min;
+using std::max;
+
+#define constrain(value, low, high) ((value) < (low) ? (low) : ((value) > (high) ? (high) : (value)))
+
+// Monotonic time since the first call, like millis()/micros() since boot
+inline uint64_t nativeMicros() {
+    static timespec start = { 0, 0 };
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (start.tv_sec == 0 && start.tv_nsec == 0) {
+        start = now;
+    }
+    return (uint64_t)(now.tv_sec - start.tv_sec) * 1000000 + (now.tv_nsec - start.tv_nsec) / 1000;
+}
+
+inline unsigned long millis() { return (unsigned long)(nativeMicros() / 1000); }
+inline unsigned long micros() { return (unsigned long)nativeMicros(); }
+
+inline void delay(unsigned long ms) {
+    timespec duration = { (time_t)(ms / 1000), (long)(ms % 1000) * 1000000 };
+    nanosleep(&duration, nullptr);
+}
+
+// Let other threads run, as yield() lets other tasks run
+inline void yield() { sched_yield(); }
+
+// Arduino String, the subset the sources use, backed by std::string
+class String {
+public:
+    String(const char* text = "") : value(text != nullptr ? text : "") {}
+    String(const std::string& text) : value(text) {}
+    String(char c) : value(1, c) {}
+    String(int number) : value(std::to_string(number)) {}
+    String(unsigned int number) : value(std::to_string(number)) {}
+    String(long number) : value(std::to_string(number)) {}
+    String(unsigned long number) : value(std::to_string(number)) {}
+    String(double number, unsigned int decimals = 2) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, number);
+        value = buffer;
+    }
+    
+    unsigned int length() const { return (unsigned int)value.size(); }
+    const char* c_str() const { return value.c_str(); }
+    bool reserve(unsigned int size) { value.reserve(size); return true; }
+    bool concat(const char* text, unsigned int length) { value.append(text, length); return true; }
+    bool startsWith(const String& prefix) const { return value.compare(0, prefix.value.size(), prefix.value) == 0; }
+    int indexOf(char c, unsigned int from = 0) const {
+        size_t index = value.find(c, from);
+        return (index == std::string::npos) ? -1 : (int)index;
+    }
+    String substring(unsigned int from, unsigned int to) const { return String(value.substr(from, to - from)); }
+    String substring(unsigned int from) const { return String(value.substr(from)); }
+    char charAt(unsigned int index) const { return (index < value.size()) ? value[index] : 0; }
+    long toInt() const { return atol(value.c_str()); }
+    float toFloat() const { return (float)atof(value.c_str()); }
+    
+    String& operator+=(const String& other) { value += other.value; return *this; }
+    String& operator+=(const char* text) { value += text; return *this; }
+    String& operator+=(char c) { value += c; return *this; }
+    bool operator==(const String& other) const { return value == other.value; }
+    bool operator==(const char* text) const { return value == text; }
+    bool operator!=(const String& other) const { return value != other.value; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    
+    friend String operator+(const String& a, const String& b) { return String(a.value + b.value); }
+    friend String operator+(const String& a, const char* b) { return String(a.value + b); }
+    friend String operator+(const char* a, const String& b) { return String(a + b.value); }
+
+private:
+    std::string value;
+};
+
+#endif // NATIVE_ARDUINO_H
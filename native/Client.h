@@ -0,0 +1,22 @@
+#ifndef NATIVE_CLIENT_H
+#define NATIVE_CLIENT_H
+
+#include "Arduino.h"
+
+// Stand-in for the Arduino core's Client, the byte stream over a network
+// connection that WiFiClient implements. Only the members the sources use,
+// with the same signatures.
+class Client {
+public:
+    virtual ~Client() {}
+    
+    virtual int connect(const char* host, uint16_t port) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) = 0;
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int read(uint8_t* buffer, size_t size) = 0;
+    virtual void stop() = 0;
+    virtual uint8_t connected() = 0;
+};
+
+#endif // NATIVE_CLIENT_H
@@ -22,6 +22,13 @@ if not os.path.isfile(config_path):
             'logger': {
                 'server': '192.168.1.100',
                 'port': 8080
+            },
+            'gps': {
+                'source': 'uart',
+                'protocol': 'auto',
+                'autoconfig': True,
+                'baud': 115200,
+                'rate': 5
             }
         }, f, default_flow_style=False)
     print("Created default config file. Please edit it with your settings.")
@@ -0,0 +1,97 @@
+#include "GPSClock.h"
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <sys/time.h>
+#endif
+
+GPSClock::GPSClock() :
+    synchronized(false),
+    offsetMicros(0),
+    lastSequence(0),
+    lastLocal(0),
+    localHigh(0),
+    lastDifference(0),
+    steps(0),
+    updates(0) {
+}
+
+uint64_t GPSClock::uptime() {
+    // Count the wraps of millis(), which happen every 49.7 days
+    uint32_t local = localMillis();
+    if (local < lastLocal) {
+        localHigh += 1ULL << 32;
+    }
+    lastLocal = local;
+    return localHigh + local;
+}
+
+int64_t GPSClock::now() {
+    if (!synchronized) {
+        return 0;
+    }
+    return (int64_t)uptime() + offsetMicros / 1000;
+}
+
+void GPSClock::update(GPSParser& parser) {
+    // Copying the fix is only worth it when there is a new one
+    uint32_t sequence = parser.getFixSequence();
+    if (sequence == lastSequence) {
+        return;
+    }
+    lastSequence = sequence;
+    
+    GPSParser::Fix fix;
+    parser.getFix(fix);
+    update(fix);
+}
+
+void GPSClock::update(const GPSParser::Fix& fix) {
+    if (fix.utcMillis == 0) {
+        return;
+    }
+    updates++;
+    
+    // The local time at publication, the fix may have been queued since
+    int64_t local = (int64_t)uptime() - (localMicros() - fix.publishedMicros) / 1000;
+    int64_t differenceMicros = (fix.utcMillis - local) * 1000 - offsetMicros;
+    lastDifference = (int32_t)constrain(differenceMicros / 1000, (int64_t)INT32_MIN, (int64_t)INT32_MAX);
+    
+    if (!synchronized || differenceMicros > GPS_CLOCK_STEP_THRESHOLD * 1000LL ||
+        differenceMicros < -GPS_CLOCK_STEP_THRESHOLD * 1000LL) {
+        // First fix or a jump, e.g. after a receiver restart: take the fix time as is
+        offsetMicros += differenceMicros;
+        synchronized = true;
+        steps++;
+        setSystemClock(fix.utcMillis);
+    }
+    else {
+        // Slew: average out the jitter of the sentence arrival
+        int64_t correction = differenceMicros / GPS_CLOCK_SLEW_DIVISOR;
+        offsetMicros += correction;
+        adjustSystemClock((int32_t)(correction / 1000));
+    }
+}
+
+void GPSClock::setSystemClock(int64_t unixMillis) {
+#ifdef ARDUINO_ARCH_ESP32
+    struct timeval time;
+    time.tv_sec = unixMillis / 1000;
+    time.tv_usec = (unixMillis % 1000) * 1000;
+    settimeofday(&time, nullptr);
+#else
+    (void)unixMillis;
+#endif
+}
+
+void GPSClock::adjustSystemClock(int32_t milliseconds) {
+#ifdef ARDUINO_ARCH_ESP32
+    if (milliseconds != 0) {
+        struct timeval delta;
+        delta.tv_sec = milliseconds / 1000;
+        delta.tv_usec = (milliseconds % 1000) * 1000;
+        adjtime(&delta, nullptr);
+    }
+#else
+    (void)milliseconds;
+#endif
+}
@@ -0,0 +1,67 @@
+#ifndef GPS_CLOCK_H
+#define GPS_CLOCK_H
+
+#include <Arduino.h>
+#include "GPSParser.h"
+
+// Clock discipline
+#define GPS_CLOCK_STEP_THRESHOLD 500  // ms, larger differences step the clock instead of slewing it
+#define GPS_CLOCK_SLEW_DIVISOR 8      // Fraction of the difference corrected per fix
+
+// UTC wall clock disciplined by the GPS fixes. Between fixes it runs on the
+// local uptime, so now() is cheap and always available once synchronized. On
+// the ESP32 the system clock follows as well, for time() and TLS.
+//
+// The difference to the fix time includes the receiver's output latency (the
+// time the sentences take to arrive), tens to a few hundred ms depending on
+// baud rate: fine for time stamps, not for timing measurements.
+class GPSClock {
+public:
+    // Fix fields the clock uses, for GPSParser::subscribe()
+    static const uint16_t FIELDS = GPSParser::FIELD_TIME | GPSParser::FIELD_DATE;
+    
+    GPSClock();
+    virtual ~GPSClock() {}
+    
+    // Check for a new fix and correct the clock with it. A fix that is taken
+    // from a queue is corrected by the time it waited since publication.
+    void update(GPSParser& parser);
+    void update(const GPSParser::Fix& fix);
+    
+    bool isSynchronized() const { return synchronized; }
+    
+    // UTC now as Unix time in milliseconds, 0 before the first fix with a date
+    int64_t now();
+    
+    // Local time since boot in milliseconds, not wrapping like millis()
+    uint64_t uptime();
+    
+    // Statistics
+    int32_t getLastDifference() const { return lastDifference; }  // ms, fix minus clock before correcting
+    uint32_t getSteps() const { return steps; }
+    uint32_t getUpdates() const { return updates; }
+
+protected:
+    // Local time source, a test can run on simulated time
+    virtual unsigned long localMillis() { return millis(); }
+    virtual uint32_t localMicros() { return micros(); }
+    
+    // Set the system clock, stepping it or slewing it by the given amount (ms)
+    virtual void setSystemClock(int64_t unixMillis);
+    virtual void adjustSystemClock(int32_t milliseconds);
+
+private:
+    bool synchronized;
+    int64_t offsetMicros;       // UTC minus uptime, in µs so that small corrections accumulate
+    uint32_t lastSequence;
+    
+    // millis() extended to 64 bits
+    uint32_t lastLocal;
+    uint64_t localHigh;
+    
+    int32_t lastDifference;
+    uint32_t steps;
+    uint32_t updates;
+};
+
+#endif // GPS_CLOCK_H
@@ -0,0 +1,508 @@
+#include "GPSConfigurator.h"
+
+// NMEA sentences the receivers send by default and how each chipset addresses them
+struct NMEAMessage {
+    uint32_t sentenceId;
+    uint8_t ubxId;     // Message ID in UBX class 0xF0
+    uint32_t ubxKey;   // CFG-MSGOUT key of its rate on UART1
+    uint8_t mtkField;  // Field position in PMTK314
+    bool consumed;     // The parser has a handler for it
+};
+
+static const NMEAMessage nmeaMessages[] = {
+    { nmeaSentenceId("GGA"), 0x00, 0x209100BB, 3, GPS_ENABLE_GGA },
+    { nmeaSentenceId("GLL"), 0x01, 0x209100CA, 0, false },
+    { nmeaSentenceId("GSA"), 0x02, 0x209100C0, 4, GPS_ENABLE_GSA },
+    { nmeaSentenceId("GSV"), 0x03, 0x209100C5, 5, GPS_ENABLE_GSV },
+    { nmeaSentenceId("RMC"), 0x04, 0x209100AC, 1, GPS_ENABLE_RMC },
+    { nmeaSentenceId("VTG"), 0x05, 0x209100B1, 2, false }
+};
+
+static const uint8_t NMEA_MESSAGE_COUNT = sizeof(nmeaMessages) / sizeof(nmeaMessages[0]);
+
+// PMTK314 has one output divider per sentence type
+#define PMTK314_FIELD_COUNT 19
+
+// CFG-VALSET keys, bits 28-30 give the size of the value
+#define UBX_KEY_UART1_BAUDRATE 0x40520001
+#define UBX_KEY_RATE_MEAS 0x30210001
+#define UBX_KEY_RATE_NAV 0x30210002
+#define UBX_KEY_RATE_TIMEREF 0x20210003
+#define UBX_KEY_MSGOUT_NAV_PVT 0x20910007
+#define UBX_KEY_MSGOUT_NAV_DOP 0x20910039
+#define UBX_KEY_MSGOUT_NAV_SAT 0x20910016
+
+// Largest command sent: a CFG-VALSET header and twelve keys with their values
+#define UBX_VALSET_MAX_PAYLOAD (4 + 12 * 8)
+
+static void writeU16(uint8_t* p, uint16_t value) {
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+}
+
+static void writeU32(uint8_t* p, uint32_t value) {
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = value >> 24;
+}
+
+// Append a key and its value to a CFG-VALSET payload
+static size_t appendValue(uint8_t* payload, size_t length, uint32_t key, uint32_t value) {
+    writeU32(&payload[length], key);
+    length += 4;
+    uint8_t size = (key >> 28) & 0x07;
+    uint8_t bytes = (size == 4) ? 4 : (size == 3) ? 2 : 1;
+    for (uint8_t i = 0; i < bytes; i++) {
+        payload[length++] = (value >> (8 * i)) & 0xFF;
+    }
+    return length;
+}
+
+// Output divider for satellite information, about once a second at higher rates
+static uint8_t satelliteDivider(uint16_t rateMs, uint8_t maximum) {
+    if (rateMs == 0 || rateMs >= 1000) {
+        return 1;
+    }
+    uint16_t divider = 1000 / rateMs;
+    return (divider > maximum) ? maximum : (uint8_t)divider;
+}
+
+GPSConfigurator::GPSConfigurator(GPSPort& port) : port(port) {
+}
+
+const char* GPSConfigurator::getChipsetName(Chipset chipset) {
+    switch (chipset) {
+        case CHIPSET_UBLOX: return "u-blox";
+        case CHIPSET_MTK: return "MediaTek";
+        default: return "Unknown";
+    }
+}
+
+GPSConfigurator::Result GPSConfigurator::configure(const Settings& settings) {
+    Result result;
+    memset(&result, 0, sizeof(result));
+    useValset = false;
+    
+    // Satellite view sentences are only needed about once a second
+    wantedSentences = 0;
+    for (uint8_t i = 0; i < NMEA_MESSAGE_COUNT; i++) {
+        if (nmeaMessages[i].consumed && settings.protocol != GPSParser::PROTOCOL_UBX) {
+            wantedSentences |= 1UL << i;
+        }
+    }
+    
+    if (!detectBaud(settings, result)) {
+        // Nothing to talk to, leave the port at the target rate for a receiver that starts late
+        port.setBaud(settings.baud);
+        result.baud = settings.baud;
+        return result;
+    }
+    
+    result.chipset = detectChipset(result);
+    switch (result.chipset) {
+        case CHIPSET_UBLOX:
+            result.configured = configureUBlox(settings, result);
+            break;
+        case CHIPSET_MTK:
+            result.configured = configureMTK(settings, result);
+            break;
+        default:
+            // Keep whatever the receiver sends, the parser copes with it
+            result.baud = port.getBaud();
+            return result;
+    }
+    
+    result.verified = verify(settings, result);
+    result.baud = port.getBaud();
+    return result;
+}
+
+bool GPSConfigurator::detectBaud(const Settings& settings, Result& result) {
+    // Try the target rate first, a warm receiver may still be configured from the last boot
+    const uint32_t candidates[] = GPS_DETECT_BAUD_RATES;
+    const uint8_t candidateCount = sizeof(candidates) / sizeof(candidates[0]);
+    
+    for (int8_t i = -1; i < candidateCount; i++) {
+        uint32_t baud = (i < 0) ? settings.baud : candidates[i];
+        if (i >= 0 && baud == settings.baud) {
+            continue;
+        }
+        
+        port.setBaud(baud);
+        lineLength = 0;
+        validMessages = 0;
+        
+        // Two checksummed messages in a row do not happen by accident at the wrong rate
+        unsigned long start = port.now();
+        while (port.now() - start < GPS_DETECT_TIMEOUT) {
+            listen(0);
+            if (validMessages >= 2) {
+                result.detectedBaud = baud;
+                return true;
+            }
+            yield();
+        }
+    }
+    
+    return false;
+}
+
+GPSConfigurator::Chipset GPSConfigurator::detectChipset(Result& result) {
+    // u-blox answers a MON-VER poll, MediaTek answers PMTK605 with PMTK705
+    await = AWAIT_UBX;
+    awaitClass = UBX_CLASS_MON;
+    awaitId = UBX_MON_VER;
+    if (sendUBX(UBX_CLASS_MON, UBX_MON_VER, nullptr, 0) && listen(GPS_PROBE_TIMEOUT)) {
+        // Extensions of 30 characters follow the software and hardware versions,
+        // one is "PROTVER=34.10", or "PROTVER 18.00" on older receivers
+        const uint8_t* payload = ubx.getPayload();
+        for (uint16_t offset = 40; offset + 30 <= ubx.getLength(); offset += 30) {
+            const char* extension = (const char*)&payload[offset];
+            if (strncmp(extension, "PROTVER", 7) == 0) {
+                result.protocolVersion = atoi(extension + 8);
+            }
+        }
+        return CHIPSET_UBLOX;
+    }
+    
+    await = AWAIT_NMEA;
+    awaitPrefix = "PMTK705,";
+    if (sendPMTK("PMTK605") && listen(GPS_PROBE_TIMEOUT)) {
+        return CHIPSET_MTK;
+    }
+    
+    return CHIPSET_UNKNOWN;
+}
+
+bool GPSConfigurator::configureUBlox(const Settings& settings, Result& result) {
+    useValset = result.protocolVersion >= GPS_UBLOX_VALSET_PROTVER;
+    if (useValset) {
+        return configureUBloxValues(settings, result);
+    }
+    bool ok = true;
+    
+    // Baud rate first so the higher navigation rate has the bandwidth it needs.
+    // The acknowledgement may come at either rate, so it is not waited for.
+    if (result.detectedBaud != settings.baud) {
+        uint8_t prt[20];
+        memset(prt, 0, sizeof(prt));
+        prt[0] = 1;                     // UART1
+        writeU32(&prt[4], 0x000008D0);  // 8N1
+        writeU32(&prt[8], settings.baud);
+        writeU16(&prt[12], 0x0003);     // UBX + NMEA in
+        writeU16(&prt[14], 0x0003);     // UBX + NMEA out, UBX is needed for the poll replies
+        sendUBX(UBX_CLASS_CFG, UBX_CFG_PRT, prt, sizeof(prt));
+        switchBaud(settings.baud);
+    }
+    
+    uint8_t slowRate = satelliteDivider(settings.rateMs, 255);
+    
+    for (uint8_t i = 0; i < NMEA_MESSAGE_COUNT; i++) {
+        uint8_t rate = 0;
+        if (wantedSentences & (1UL << i)) {
+            rate = (nmeaMessages[i].sentenceId == nmeaSentenceId("GSV")) ? slowRate : 1;
+        }
+        uint8_t msg[3] = { UBX_CLASS_NMEA, nmeaMessages[i].ubxId, rate };
+        ok &= sendUBXWithAck(UBX_CLASS_CFG, UBX_CFG_MSG, msg, sizeof(msg));
+    }
+    
+    if (settings.protocol == GPSParser::PROTOCOL_UBX) {
+        const uint8_t navMessages[3][3] = {
+            { UBX_CLASS_NAV, UBX_NAV_PVT, 1 },
+            { UBX_CLASS_NAV, UBX_NAV_DOP, 1 },
+            { UBX_CLASS_NAV, UBX_NAV_SAT, slowRate }
+        };
+        for (uint8_t i = 0; i < 3; i++) {
+            ok &= sendUBXWithAck(UBX_CLASS_CFG, UBX_CFG_MSG, navMessages[i], 3);
+        }
+    }
+    
+    // Measurement period, one navigation solution per measurement, aligned to GPS time
+    uint8_t rate[6];
+    writeU16(&rate[0], settings.rateMs);
+    writeU16(&rate[2], 1);
+    writeU16(&rate[4], 1);
+    ok &= sendUBXWithAck(UBX_CLASS_CFG, UBX_CFG_RATE, rate, sizeof(rate));
+    
+    return ok;
+}
+
+bool GPSConfigurator::configureUBloxValues(const Settings& settings, Result& result) {
+    // CFG-VALSET: version 0, RAM layer, two reserved bytes, then keys and values
+    uint8_t payload[UBX_VALSET_MAX_PAYLOAD];
+    memset(payload, 0, 4);
+    payload[1] = 0x01;
+    
+    // Baud rate first, not waited for as with CFG-PRT
+    if (result.detectedBaud != settings.baud) {
+        size_t length = appendValue(payload, 4, UBX_KEY_UART1_BAUDRATE, settings.baud);
+        sendUBX(UBX_CLASS_CFG, UBX_CFG_VALSET, payload, length);
+        switchBaud(settings.baud);
+    }
+    
+    // Everything else in one command, applied together or not at all
+    uint8_t slowRate = satelliteDivider(settings.rateMs, 255);
+    size_t length = 4;
+    for (uint8_t i = 0; i < NMEA_MESSAGE_COUNT; i++) {
+        uint8_t rate = 0;
+        if (wantedSentences & (1UL << i)) {
+            rate = (nmeaMessages[i].sentenceId == nmeaSentenceId("GSV")) ? slowRate : 1;
+        }
+        length = appendValue(payload, length, nmeaMessages[i].ubxKey, rate);
+    }
+    if (settings.protocol == GPSParser::PROTOCOL_UBX) {
+        length = appendValue(payload, length, UBX_KEY_MSGOUT_NAV_PVT, 1);
+        length = appendValue(payload, length, UBX_KEY_MSGOUT_NAV_DOP, 1);
+        length = appendValue(payload, length, UBX_KEY_MSGOUT_NAV_SAT, slowRate);
+    }
+    length = appendValue(payload, length, UBX_KEY_RATE_MEAS, settings.rateMs);
+    length = appendValue(payload, length, UBX_KEY_RATE_NAV, 1);
+    length = appendValue(payload, length, UBX_KEY_RATE_TIMEREF, 1);  // GPS time
+    return sendUBXWithAck(UBX_CLASS_CFG, UBX_CFG_VALSET, payload, length);
+}
+
+uint16_t GPSConfigurator::pollUBloxRate() {
+    await = AWAIT_UBX;
+    awaitClass = UBX_CLASS_CFG;
+    if (useValset) {
+        // CFG-VALGET from the RAM layer, the reply has the key and value after a four byte header
+        uint8_t request[8] = { 0, 0, 0, 0 };
+        writeU32(&request[4], UBX_KEY_RATE_MEAS);
+        awaitId = UBX_CFG_VALGET;
+        if (!sendUBX(UBX_CLASS_CFG, UBX_CFG_VALGET, request, sizeof(request)) || !listen(GPS_ACK_TIMEOUT) ||
+            ubx.getLength() < 10 || memcmp(&ubx.getPayload()[4], &request[4], 4) != 0) {
+            return 0;
+        }
+        const uint8_t* payload = ubx.getPayload();
+        return (uint16_t)payload[8] | ((uint16_t)payload[9] << 8);
+    }
+    
+    // CFG-RATE without payload is a poll, the reply carries the current settings
+    awaitId = UBX_CFG_RATE;
+    if (!sendUBX(UBX_CLASS_CFG, UBX_CFG_RATE, nullptr, 0) || !listen(GPS_ACK_TIMEOUT) || ubx.getLength() < 6) {
+        return 0;
+    }
+    const uint8_t* payload = ubx.getPayload();
+    return (uint16_t)payload[0] | ((uint16_t)payload[1] << 8);
+}
+
+bool GPSConfigurator::configureMTK(const Settings& settings, Result& result) {
+    char command[64];
+    bool ok = true;
+    
+    // PMTK251 is not acknowledged, the receiver switches right away
+    if (result.detectedBaud != settings.baud) {
+        snprintf(command, sizeof(command), "PMTK251,%lu", (unsigned long)settings.baud);
+        sendPMTK(command);
+        switchBaud(settings.baud);
+    }
+    
+    // Output dividers range from 0 (off) to 5 fixes
+    uint8_t dividers[PMTK314_FIELD_COUNT];
+    memset(dividers, 0, sizeof(dividers));
+    uint8_t slowRate = satelliteDivider(settings.rateMs, 5);
+    for (uint8_t i = 0; i < NMEA_MESSAGE_COUNT; i++) {
+        if (wantedSentences & (1UL << i)) {
+            dividers[nmeaMessages[i].mtkField] = (nmeaMessages[i].sentenceId == nmeaSentenceId("GSV")) ? slowRate : 1;
+        }
+    }
+    
+    size_t length = snprintf(command, sizeof(command), "PMTK314");
+    for (uint8_t i = 0; i < PMTK314_FIELD_COUNT; i++) {
+        length += snprintf(command + length, sizeof(command) - length, ",%u", dividers[i]);
+    }
+    ok &= sendPMTKWithAck(command);
+    
+    snprintf(command, sizeof(command), "PMTK220,%u", settings.rateMs);
+    ok &= sendPMTKWithAck(command);
+    
+    return ok;
+}
+
+uint16_t GPSConfigurator::pollMTKRate() {
+    // PMTK400 queries the fix interval, answered by PMTK500,<interval>,...
+    await = AWAIT_NMEA;
+    awaitPrefix = "PMTK500,";
+    if (!sendPMTK("PMTK400") || !listen(GPS_ACK_TIMEOUT)) {
+        return 0;
+    }
+    return (uint16_t)atoi(&line[1 + strlen("PMTK500,")]);
+}
+
+void GPSConfigurator::switchBaud(uint32_t baud) {
+    // Let the command leave the UART and the receiver reconfigure its own,
+    // whatever arrives meanwhile is read and dropped
+    port.flush();
+    await = AWAIT_NOTHING;
+    listen(GPS_BAUD_SWITCH_DELAY);
+    port.setBaud(baud);
+    lineLength = 0;
+}
+
+bool GPSConfigurator::verify(const Settings& settings, Result& result) {
+    // The receiver must answer the poll at the new baud rate with the new period
+    uint16_t rateMs = (result.chipset == CHIPSET_UBLOX) ? pollUBloxRate() : pollMTKRate();
+    result.rateMs = rateMs;
+    
+    // Then watch the output for a while: it must only carry the sentences that were kept
+    validMessages = 0;
+    unwantedSentences = 0;
+    listen(GPS_DETECT_TIMEOUT);
+    result.unwantedSentences = unwantedSentences;
+    
+    return rateMs == settings.rateMs && validMessages > 0 && unwantedSentences == 0;
+}
+
+bool GPSConfigurator::listen(unsigned long timeout) {
+    // Read until the awaited reply arrived or the timeout expired, a zero
+    // timeout only drains what is buffered
+    unsigned long start = port.now();
+    do {
+        while (port.available() > 0) {
+            int c = port.read();
+            if (c < 0) {
+                break;
+            }
+            handleByte((uint8_t)c);
+            if (awaitDone) {
+                awaitDone = false;
+                return awaitSuccess;
+            }
+        }
+        if (timeout > 0) {
+            yield();
+        }
+    } while (port.now() - start < timeout);
+    
+    // Nothing came, stop waiting for it
+    await = AWAIT_NOTHING;
+    return false;
+}
+
+void GPSConfigurator::handleByte(uint8_t b) {
+    // UBX frames and NMEA sentences share the line, UBX gets the first look
+    UBXParser::Result frame = ubx.processByte(b);
+    if (frame == UBXParser::UBX_FRAME_READY) {
+        handleFrame();
+        return;
+    }
+    if (frame != UBXParser::UBX_IDLE) {
+        return;
+    }
+    
+    if (b == '$') {
+        line[0] = '$';
+        lineLength = 1;
+    }
+    else if (b == '\n') {
+        if (lineLength > 0) {
+            line[lineLength] = '\0';
+            handleSentence();
+            lineLength = 0;
+        }
+    }
+    else if (b == '\r' || lineLength == 0) {
+        return;
+    }
+    else if (b < 0x20 || b > 0x7E || lineLength >= NMEA_SENTENCE_BUFFER_SIZE - 1) {
+        // Noise or a wrong baud rate
+        lineLength = 0;
+    }
+    else {
+        line[lineLength++] = (char)b;
+    }
+}
+
+void GPSConfigurator::handleSentence() {
+    // $<body>*<two hex digits>, checksum is the XOR of the body
+    const char* star = strchr(line, '*');
+    if (star == nullptr || strlen(star) != 3) {
+        return;
+    }
+    int8_t high = nmeaHexValue(star[1]);
+    int8_t low = nmeaHexValue(star[2]);
+    if (high < 0 || low < 0 || nmeaChecksum(&line[1], star) != ((high << 4) | low)) {
+        return;
+    }
+    validMessages++;
+    
+    // Count sentence types the receiver should no longer send
+    const char* address = &line[1];
+    const char* end = strchr(address, ',');
+    if (end == nullptr) {
+        end = star;
+    }
+    if (address[0] != 'P' && end - address == 5) {
+        uint32_t id = nmeaSentenceId(&address[2]);
+        for (uint8_t i = 0; i < NMEA_MESSAGE_COUNT; i++) {
+            if (nmeaMessages[i].sentenceId == id && !(wantedSentences & (1UL << i))) {
+                unwantedSentences++;
+            }
+        }
+    }
+    
+    if (await == AWAIT_NMEA && strncmp(address, awaitPrefix, strlen(awaitPrefix)) == 0) {
+        finishAwait(true);
+    }
+}
+
+void GPSConfigurator::handleFrame() {
+    validMessages++;
+    
+    if (await == AWAIT_UBX && ubx.getClass() == awaitClass && ubx.getId() == awaitId) {
+        finishAwait(true);
+    }
+    else if (await == AWAIT_UBX_ACK && ubx.getClass() == UBX_CLASS_ACK && ubx.getLength() >= 2 &&
+             ubx.getPayload()[0] == awaitClass && ubx.getPayload()[1] == awaitId) {
+        // A NAK ends the wait as well, as a failure
+        finishAwait(ubx.getId() == UBX_ACK_ACK);
+    }
+}
+
+void GPSConfigurator::finishAwait(bool success) {
+    await = AWAIT_NOTHING;
+    awaitDone = true;
+    awaitSuccess = success;
+}
+
+bool GPSConfigurator::sendUBX(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t length) {
+    uint8_t frame[UBX_VALSET_MAX_PAYLOAD + UBX_FRAME_OVERHEAD];
+    size_t frameLength = UBXParser::buildFrame(cls, id, payload, length, frame, sizeof(frame));
+    if (frameLength == 0) {
+        return false;
+    }
+    return port.write(frame, frameLength) == frameLength;
+}
+
+bool GPSConfigurator::sendUBXWithAck(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t length) {
+    await = AWAIT_UBX_ACK;
+    awaitClass = cls;
+    awaitId = id;
+    return sendUBX(cls, id, payload, length) && listen(GPS_ACK_TIMEOUT);
+}
+
+bool GPSConfigurator::sendPMTK(const char* body) {
+    char sentence[NMEA_SENTENCE_BUFFER_SIZE];
+    int length = snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body,
+                          nmeaChecksum(body, body + strlen(body)));
+    if (length <= 0 || length >= (int)sizeof(sentence)) {
+        return false;
+    }
+    return port.write((const uint8_t*)sentence, length) == (size_t)length;
+}
+
+bool GPSConfigurator::sendPMTKWithAck(const char* body) {
+    // Acknowledged with PMTK001,<command>,<flag>, flag 3 means the command succeeded
+    const char* comma = strchr(body, ',');
+    int commandLength = (comma != nullptr) ? comma - body : strlen(body);
+    char prefix[16];
+    snprintf(prefix, sizeof(prefix), "PMTK001,%.*s,", commandLength - 4, body + 4);
+    
+    await = AWAIT_NMEA;
+    awaitPrefix = prefix;
+    if (!sendPMTK(body) || !listen(GPS_ACK_TIMEOUT)) {
+        return false;
+    }
+    return line[1 + strlen(prefix)] == '3';
+}
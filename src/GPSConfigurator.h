@@ -0,0 +1,108 @@
+#ifndef GPS_CONFIGURATOR_H
+#define GPS_CONFIGURATOR_H
+
+#include <Arduino.h>
+#include "GPSPort.h"
+#include "GPSParser.h"
+#include "UBXParser.h"
+
+// Baud rates probed when looking for the receiver, most likely first
+#define GPS_DETECT_BAUD_RATES { 9600, 115200, 38400, 57600, 19200, 4800 }
+
+// Timeouts in milliseconds
+#define GPS_DETECT_TIMEOUT 1500   // Listen per baud rate, receivers talk at least once a second
+#define GPS_PROBE_TIMEOUT 1000    // Wait for a chipset identification reply
+#define GPS_ACK_TIMEOUT 500       // Wait for a command acknowledgement
+#define GPS_BAUD_SWITCH_DELAY 100 // Give the receiver time to switch its UART
+
+// u-blox protocol version from which receivers are configured with CFG-VALSET.
+// M10 receivers reject the older CFG-PRT, CFG-MSG and CFG-RATE.
+#define GPS_UBLOX_VALSET_PROTVER 27
+
+// Brings the receiver up at a known baud rate and navigation rate, with only
+// the sentences the parser consumes enabled. Runs once at boot and blocks for
+// a few seconds at most.
+class GPSConfigurator {
+public:
+    enum Chipset : uint8_t {
+        CHIPSET_UNKNOWN = 0,
+        CHIPSET_UBLOX,        // UBX-CFG messages
+        CHIPSET_MTK           // PMTK sentences
+    };
+    
+    struct Settings {
+        uint32_t baud;                 // Target baud rate
+        uint16_t rateMs;               // Navigation measurement period (ms)
+        GPSParser::Protocol protocol;  // Decides which output is kept
+    };
+    
+    struct Result {
+        uint32_t detectedBaud;  // Baud rate the receiver was found at, 0 when silent
+        Chipset chipset;
+        uint8_t protocolVersion;  // u-blox protocol version (PROTVER) from MON-VER, 0 if not reported
+        uint32_t baud;          // Baud rate the port is left at
+        uint16_t rateMs;        // Measurement period read back from the receiver, 0 if unknown
+        bool configured;        // Every command was acknowledged
+        bool verified;          // Receiver answers at the new baud rate with the new settings
+        uint32_t unwantedSentences;  // Disabled sentence types still seen during verification
+    };
+    
+    GPSConfigurator(GPSPort& port);
+    
+    Result configure(const Settings& settings);
+    
+    static const char* getChipsetName(Chipset chipset);
+
+private:
+    GPSPort& port;
+    UBXParser ubx;
+    
+    // Receive side: validated NMEA sentences and UBX frames
+    char line[NMEA_SENTENCE_BUFFER_SIZE];
+    uint8_t lineLength = 0;
+    uint32_t validMessages = 0;
+    uint32_t unwantedSentences = 0;
+    uint32_t wantedSentences = 0;  // Bitmask over the NMEA message table, 1 = keep
+    
+    // Reply the receive loop is waiting for
+    enum Await : uint8_t {
+        AWAIT_NOTHING = 0,
+        AWAIT_UBX,     // Frame of awaitClass/awaitId
+        AWAIT_UBX_ACK, // ACK-ACK or ACK-NAK for awaitClass/awaitId
+        AWAIT_NMEA     // Sentence whose address starts with awaitPrefix
+    };
+    Await await = AWAIT_NOTHING;
+    uint8_t awaitClass = 0;
+    uint8_t awaitId = 0;
+    const char* awaitPrefix = nullptr;
+    bool awaitDone = false;
+    bool awaitSuccess = false;
+    
+    bool listen(unsigned long timeout);
+    void handleByte(uint8_t b);
+    void handleSentence();
+    void handleFrame();
+    void finishAwait(bool success);
+    
+    bool detectBaud(const Settings& settings, Result& result);
+    Chipset detectChipset(Result& result);
+    
+    // u-blox
+    bool sendUBX(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t length);
+    bool sendUBXWithAck(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t length);
+    bool useValset = false;  // Receiver takes CFG-VALSET instead of the older CFG messages
+    bool configureUBlox(const Settings& settings, Result& result);
+    bool configureUBloxValues(const Settings& settings, Result& result);
+    uint16_t pollUBloxRate();
+    
+    // MediaTek
+    bool sendPMTK(const char* body);
+    bool sendPMTKWithAck(const char* body);
+    bool configureMTK(const Settings& settings, Result& result);
+    uint16_t pollMTKRate();
+    
+    void switchBaud(uint32_t baud);
+    bool verify(const Settings& settings, Result& result);
+};
+
+#endif // GPS_CONFIGURATOR_H
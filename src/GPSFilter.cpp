@@ -0,0 +1,244 @@
+#include "GPSFilter.h"
+
+// Length of 1e-7 degree of latitude in µm, 111.32 km per degree
+#define MICROMETERS_PER_E7 11132
+
+#define MM_PER_S_PER_KNOT 514.444f
+#define RADIANS_PER_DEGREE 0.0174532925f
+
+GPSFilter::GPSFilter() : lastSequence(0), updates(0), restarts(0) {
+    reset();
+}
+
+void GPSFilter::reset() {
+    initialized = false;
+    originLatitudeE7 = 0;
+    originLongitudeE7 = 0;
+    eastScale = 1;
+    stateTime = 0;
+    stateMicros = 0;
+    east = 0;
+    north = 0;
+    velocityEast = 0;
+    velocityNorth = 0;
+    course = 0;
+    positionVariance = 0;
+    covariance = 0;
+    velocityVariance = 0;
+}
+
+void GPSFilter::update(GPSParser& parser) {
+    // Copying the fix is only worth it when there is a new one
+    uint32_t sequence = parser.getFixSequence();
+    if (sequence == lastSequence) {
+        return;
+    }
+    lastSequence = sequence;
+    
+    GPSParser::Fix fix;
+    parser.getFix(fix);
+    update(fix);
+}
+
+void GPSFilter::update(const GPSParser::Fix& fix) {
+    // Only fixes with a time and a freshly decoded position can be filtered
+    if (!fix.validTime || !fix.validPosition || !(fix.fields & GPSParser::FIELD_POSITION)) {
+        return;
+    }
+    updates++;
+    
+    int64_t time = gpsUnixMillis(fix.date, fix.timeOfDay);
+    float hdop = (fix.validHDOP && fix.hdop > 0) ? fix.hdop : GPS_FILTER_DEFAULT_HDOP;
+    float positionNoise = hdop * GPS_FILTER_POSITION_NOISE;
+    float velocityNoise = hdop * GPS_FILTER_VELOCITY_NOISE;
+    bool hasVelocity = (fix.fields & (GPSParser::FIELD_SPEED | GPSParser::FIELD_COURSE)) ==
+                       (GPSParser::FIELD_SPEED | GPSParser::FIELD_COURSE);
+    
+    // Start over after a gap or when time runs backwards, e.g. a new recording
+    int64_t elapsed = time - stateTime;
+    if (!initialized || elapsed < 0 || elapsed > GPS_FILTER_MAX_GAP) {
+        if (initialized) {
+            restarts++;
+        }
+        start(fix, time, hasVelocity, positionNoise, velocityNoise);
+        return;
+    }
+    
+    // Predict the state to the time of the fix
+    float dt = elapsed * 0.001f;
+    float q = GPS_FILTER_ACCELERATION * GPS_FILTER_ACCELERATION;
+    east += (int32_t)((int64_t)velocityEast * elapsed / 1000);
+    north += (int32_t)((int64_t)velocityNorth * elapsed / 1000);
+    positionVariance += dt * (2 * covariance + dt * velocityVariance) + q * dt * dt * dt / 3;
+    covariance += dt * velocityVariance + q * dt * dt / 2;
+    velocityVariance += q * dt;
+    
+    // Correct it with the measurement. The gains have the same units in mm as in m.
+    int32_t measuredEast, measuredNorth;
+    toLocal(fix.latitudeE7, fix.longitudeE7, measuredEast, measuredNorth);
+    float innovationEast = (float)measuredEast - east;
+    float innovationNorth = (float)measuredNorth - north;
+    float positionR = positionNoise * positionNoise;
+    float p = positionVariance;
+    float c = covariance;
+    float v = velocityVariance;
+    
+    if (hasVelocity) {
+        // Position and velocity measured: 2x2 innovation covariance
+        int32_t measuredVelocityEast, measuredVelocityNorth;
+        velocityOf(fix, measuredVelocityEast, measuredVelocityNorth);
+        float velocityInnovationEast = (float)measuredVelocityEast - velocityEast;
+        float velocityInnovationNorth = (float)measuredVelocityNorth - velocityNorth;
+        float velocityR = velocityNoise * velocityNoise;
+        
+        float s00 = p + positionR;
+        float s11 = v + velocityR;
+        float determinant = s00 * s11 - c * c;
+        float k00 = (p * s11 - c * c) / determinant;
+        float k01 = c * positionR / determinant;
+        float k10 = c * velocityR / determinant;
+        float k11 = (v * s00 - c * c) / determinant;
+        
+        east += (int32_t)lroundf(k00 * innovationEast + k01 * velocityInnovationEast);
+        north += (int32_t)lroundf(k00 * innovationNorth + k01 * velocityInnovationNorth);
+        velocityEast += (int32_t)lroundf(k10 * innovationEast + k11 * velocityInnovationEast);
+        velocityNorth += (int32_t)lroundf(k10 * innovationNorth + k11 * velocityInnovationNorth);
+        
+        positionVariance = (1 - k00) * p - k01 * c;
+        covariance = (1 - k00) * c - k01 * v;
+        velocityVariance = (1 - k11) * v - k10 * c;
+    }
+    else {
+        // Position only
+        float k0 = p / (p + positionR);
+        float k1 = c / (p + positionR);
+        
+        east += (int32_t)lroundf(k0 * innovationEast);
+        north += (int32_t)lroundf(k0 * innovationNorth);
+        velocityEast += (int32_t)lroundf(k1 * innovationEast);
+        velocityNorth += (int32_t)lroundf(k1 * innovationNorth);
+        
+        positionVariance = (1 - k0) * p;
+        covariance = (1 - k0) * c;
+        velocityVariance = v - k1 * c;
+    }
+    
+    stateTime = time;
+    stateMicros = fix.firstByteMicros;
+    
+    // The course of a standing receiver is noise
+    float speed = sqrtf((float)velocityEast * velocityEast + (float)velocityNorth * velocityNorth);
+    if (speed >= GPS_FILTER_COURSE_SPEED) {
+        course = atan2f(velocityEast, velocityNorth) / RADIANS_PER_DEGREE;
+        if (course < 0) {
+            course += 360.0f;
+        }
+    }
+    
+    // Move the origin along before the distances lose their meaning
+    if (abs(east) > GPS_FILTER_MAX_RANGE || abs(north) > GPS_FILTER_MAX_RANGE) {
+        int32_t latitudeE7, longitudeE7;
+        toGlobal(east, north, latitudeE7, longitudeE7);
+        setOrigin(latitudeE7, longitudeE7);
+        east = 0;
+        north = 0;
+    }
+}
+
+void GPSFilter::start(const GPSParser::Fix& fix, int64_t time, bool hasVelocity, float positionNoise, float velocityNoise) {
+    setOrigin(fix.latitudeE7, fix.longitudeE7);
+    east = 0;
+    north = 0;
+    velocityEast = 0;
+    velocityNorth = 0;
+    if (hasVelocity) {
+        velocityOf(fix, velocityEast, velocityNorth);
+    }
+    course = fix.course;
+    
+    positionVariance = positionNoise * positionNoise;
+    covariance = 0;
+    velocityVariance = hasVelocity ? velocityNoise * velocityNoise : GPS_FILTER_UNKNOWN_SPEED * GPS_FILTER_UNKNOWN_SPEED;
+    
+    stateTime = time;
+    stateMicros = fix.firstByteMicros;
+    initialized = true;
+}
+
+bool GPSFilter::predict(int64_t time, Estimate& estimate) const {
+    if (!initialized) {
+        return false;
+    }
+    int64_t elapsed = time - stateTime;
+    if (elapsed > GPS_FILTER_MAX_GAP || elapsed < -GPS_FILTER_MAX_GAP) {
+        return false;
+    }
+    
+    toGlobal(east + (int32_t)((int64_t)velocityEast * elapsed / 1000),
+             north + (int32_t)((int64_t)velocityNorth * elapsed / 1000),
+             estimate.latitudeE7, estimate.longitudeE7);
+    
+    float speed = sqrtf((float)velocityEast * velocityEast + (float)velocityNorth * velocityNorth);
+    estimate.speed = speed * (1.0f / MM_PER_S_PER_KNOT);
+    estimate.course = course;
+    if (speed >= GPS_FILTER_COURSE_SPEED) {
+        estimate.course = atan2f(velocityEast, velocityNorth) / RADIANS_PER_DEGREE;
+        if (estimate.course < 0) {
+            estimate.course += 360.0f;
+        }
+    }
+    
+    // The position uncertainty grows with the time since the fix
+    float dt = max(elapsed, (int64_t)0) * 0.001f;
+    float q = GPS_FILTER_ACCELERATION * GPS_FILTER_ACCELERATION;
+    estimate.accuracy = sqrtf(positionVariance + dt * (2 * covariance + dt * velocityVariance) + q * dt * dt * dt / 3);
+    estimate.time = time;
+    return true;
+}
+
+bool GPSFilter::predictNow(Estimate& estimate) const {
+    return predict(stateTime + (uint32_t)(micros() - stateMicros) / 1000, estimate);
+}
+
+void GPSFilter::setOrigin(int32_t latitudeE7, int32_t longitudeE7) {
+    originLatitudeE7 = latitudeE7;
+    originLongitudeE7 = longitudeE7;
+    float scale = MICROMETERS_PER_E7 * 65.536f * cosf(latitudeE7 * (1e-7f * RADIANS_PER_DEGREE));
+    eastScale = max((int32_t)lroundf(scale), (int32_t)1);
+}
+
+void GPSFilter::toLocal(int32_t latitudeE7, int32_t longitudeE7, int32_t& eastOut, int32_t& northOut) const {
+    int64_t latitude = (int64_t)latitudeE7 - originLatitudeE7;
+    int64_t longitude = (int64_t)longitudeE7 - originLongitudeE7;
+    
+    // Across the date line the short way round
+    if (longitude > 1800000000) {
+        longitude -= 3600000000LL;
+    }
+    else if (longitude < -1800000000) {
+        longitude += 3600000000LL;
+    }
+    
+    northOut = (int32_t)constrain(latitude * MICROMETERS_PER_E7 / 1000, (int64_t)-INT32_MAX, (int64_t)INT32_MAX);
+    eastOut = (int32_t)constrain(longitude * eastScale / 65536, (int64_t)-INT32_MAX, (int64_t)INT32_MAX);
+}
+
+void GPSFilter::toGlobal(int32_t eastIn, int32_t northIn, int32_t& latitudeE7, int32_t& longitudeE7) const {
+    int64_t latitude = originLatitudeE7 + (int64_t)northIn * 1000 / MICROMETERS_PER_E7;
+    int64_t longitude = originLongitudeE7 + (int64_t)eastIn * 65536 / eastScale;
+    if (longitude > 1800000000) {
+        longitude -= 3600000000LL;
+    }
+    else if (longitude < -1800000000) {
+        longitude += 3600000000LL;
+    }
+    latitudeE7 = (int32_t)constrain(latitude, (int64_t)-900000000, (int64_t)900000000);
+    longitudeE7 = (int32_t)longitude;
+}
+
+void GPSFilter::velocityOf(const GPSParser::Fix& fix, int32_t& eastOut, int32_t& northOut) {
+    float speed = fix.speed * MM_PER_S_PER_KNOT;
+    float course = fix.course * RADIANS_PER_DEGREE;
+    eastOut = (int32_t)lroundf(speed * sinf(course));
+    northOut = (int32_t)lroundf(speed * cosf(course));
+}
@@ -0,0 +1,94 @@
+#ifndef GPS_FILTER_H
+#define GPS_FILTER_H
+
+#include <Arduino.h>
+#include "GPSParser.h"
+
+// Noise model
+#define GPS_FILTER_POSITION_NOISE 3.0f   // m of position error per unit of HDOP
+#define GPS_FILTER_VELOCITY_NOISE 0.2f   // m/s of velocity error per unit of HDOP
+#define GPS_FILTER_DEFAULT_HDOP 2.0f     // For fixes without HDOP
+#define GPS_FILTER_ACCELERATION 1.0f     // m/s², the unmodelled acceleration (process noise)
+#define GPS_FILTER_UNKNOWN_SPEED 10.0f   // m/s, velocity uncertainty when starting from a fix without one
+
+// Restarts and output
+#define GPS_FILTER_MAX_GAP 10000         // ms without a fix before the filter starts over
+#define GPS_FILTER_MAX_RANGE 100000000   // mm from the origin before it moves along (100 km)
+#define GPS_FILTER_COURSE_SPEED 500      // mm/s, slower than this the course holds its last value
+
+// Constant velocity Kalman filter over the fix stream, one per axis in a
+// local east/north frame. Positions are integer mm and velocities mm/s
+// relative to an origin near the receiver, so precision does not depend on
+// where on earth it is. Both axes see the same noise, so they share one
+// covariance, kept in float. Predictions at any time between fixes let the
+// screens move smoothly at a higher rate than the receiver delivers.
+class GPSFilter {
+public:
+    // Filtered or predicted navigation solution
+    struct Estimate {
+        int32_t latitudeE7;
+        int32_t longitudeE7;
+        float speed;       // knots, as in the fix
+        float course;      // degrees
+        float accuracy;    // m, standard deviation of the position
+        int64_t time;      // Fix time (Unix ms) it is valid for
+    };
+    
+    // Fix fields the filter uses, for GPSParser::subscribe()
+    static const uint16_t FIELDS = GPSParser::FIELD_POSITION | GPSParser::FIELD_SPEED |
+                                   GPSParser::FIELD_COURSE | GPSParser::FIELD_DOP;
+    
+    GPSFilter();
+    
+    // Feed the parser's latest fix when there is a new one, or one fix
+    void update(GPSParser& parser);
+    void update(const GPSParser::Fix& fix);
+    void reset();
+    
+    bool isValid() const { return initialized; }
+    
+    // Estimate at a fix time (Unix ms, as GPSClock::now() or Fix::utcMillis).
+    // False before the first fix or when the last one is older than GPS_FILTER_MAX_GAP.
+    bool predict(int64_t time, Estimate& estimate) const;
+    
+    // Estimate now, extrapolated by the local time since the last fix arrived
+    bool predictNow(Estimate& estimate) const;
+    
+    // Statistics
+    uint32_t getUpdates() const { return updates; }
+    uint32_t getRestarts() const { return restarts; }
+
+private:
+    bool initialized;
+    uint32_t lastSequence;
+    
+    // Local frame: origin and the size of 1e-7 degree of longitude there, in 1/65536 mm
+    int32_t originLatitudeE7;
+    int32_t originLongitudeE7;
+    int32_t eastScale;
+    
+    // State at the time of the last fix, in mm and mm/s from the origin
+    int64_t stateTime;
+    uint32_t stateMicros;   // micros() when that fix started to arrive
+    int32_t east;
+    int32_t north;
+    int32_t velocityEast;
+    int32_t velocityNorth;
+    float course;           // Last course while moving fast enough to tell
+    
+    // Covariance of position (m²), position and velocity (m²/s) and velocity (m²/s²)
+    float positionVariance;
+    float covariance;
+    float velocityVariance;
+    
+    uint32_t updates;
+    uint32_t restarts;
+    
+    void start(const GPSParser::Fix& fix, int64_t time, bool hasVelocity, float positionNoise, float velocityNoise);
+    void setOrigin(int32_t latitudeE7, int32_t longitudeE7);
+    void toLocal(int32_t latitudeE7, int32_t longitudeE7, int32_t& eastOut, int32_t& northOut) const;
+    void toGlobal(int32_t eastIn, int32_t northIn, int32_t& latitudeE7, int32_t& longitudeE7) const;
+    static void velocityOf(const GPSParser::Fix& fix, int32_t& eastOut, int32_t& northOut);
+};
+
+#endif // GPS_FILTER_H
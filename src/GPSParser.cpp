@@ -1,237 +1,832 @@
 #include "GPSParser.h"
 
-GPSParser::GPSParser() {
+// Handlers are registered at compile time, only enabled sentence types are built in
+const GPSParser::SentenceHandler GPSParser::sentenceHandlers[] = {
+#if GPS_ENABLE_GGA
+    { nmeaSentenceId("GGA"), &GPSParser::parseGGA },
+#endif
+#if GPS_ENABLE_RMC
+    { nmeaSentenceId("RMC"), &GPSParser::parseRMC },
+#endif
+#if GPS_ENABLE_GSA
+    { nmeaSentenceId("GSA"), &GPSParser::parseGSA },
+#endif
+#if GPS_ENABLE_GSV
+    { nmeaSentenceId("GSV"), &GPSParser::parseGSV },
+#endif
+    { 0, nullptr }
+};
+
+// Sentence types that make up a fix epoch
+enum : uint8_t {
+    EPOCH_GGA = 0x01,
+    EPOCH_RMC = 0x02,
+    EPOCH_GSA = 0x04,
+    EPOCH_UBX_PVT = 0x08,
+    EPOCH_UBX_DOP = 0x10,
+    EPOCH_UBX_SAT = 0x20
+};
+
+GPSParser::GPSParser() : fixSeqlock(0), satelliteSeqlock(0), newData(false), activeFields(FIELD_ALL) {
     // Initialize with default values
+    memset(&pending, 0, sizeof(pending));
+    pending.date = gpsDaysFromCivil(2000, 1, 1);
+    pending.hdop = 99.99;
+    pending.pdop = 99.99;
+    pending.vdop = 99.99;
+    pending.fixMode = 1;
+    pending.fields = FIELD_ALL;
+    published = pending;
+}
+
+// Copy text of the given length into a caller buffer, truncating and terminating
+static size_t copyText(const char* text, size_t length, char* out, size_t cap) {
+    if (cap > 0) {
+        size_t n = (length < cap) ? length : cap - 1;
+        memcpy(out, text, n);
+        out[n] = '\0';
+    }
+    return length;
+}
+
+// Three two-digit numbers with separators, e.g. 12, 35, 19 to "12:35:19"
+static size_t writeSeparated(uint8_t a, uint8_t b, uint8_t c, char separator, char* out, size_t cap) {
+    char text[8] = {
+        (char)('0' + a / 10), (char)('0' + a % 10), separator,
+        (char)('0' + b / 10), (char)('0' + b % 10), separator,
+        (char)('0' + c / 10), (char)('0' + c % 10)
+    };
+    return copyText(text, sizeof(text), out, cap);
 }
 
 void GPSParser::processGPSData(char c) {
+    // UBX frames can only start between NMEA sentences
+    if (protocol != PROTOCOL_NMEA && (sentenceLength == 0 || ubx.isInFrame())) {
+        if (c == (char)UBX_SYNC_CHAR_1 && !ubx.isInFrame()) {
+            sentenceMicros = inputMicros;
+        }
+        UBXParser::Result result = ubx.processByte((uint8_t)c);
+        if (result == UBXParser::UBX_FRAME_READY) {
+            handleUBXFrame();
+            return;
+        }
+        if (result == UBXParser::UBX_BUSY) {
+            return;
+        }
+    }
+    if (protocol == PROTOCOL_UBX) {
+        return;
+    }
+    
+    // A '$' always starts a new sentence, even if the previous one never ended
+    if (c == '$') {
+        if (sentenceLength > 0) {
+            sentencesTruncated++;
+        }
+        resetSentence();
+        sentence[sentenceLength++] = c;
+        sentenceMicros = inputMicros;
+    }
     // If we get a newline, process the current sentence
-    if (c == '\n') {
-        // Check if it's a valid NMEA sentence (starts with $)
-        if (currentSentence.startsWith("$")) {
-            // Determine sentence type
-            if (currentSentence.startsWith("$GPGGA") || currentSentence.startsWith("$GNGGA")) {
-                parseGGA(currentSentence);
-            }
-            else if (currentSentence.startsWith("$GPRMC") || currentSentence.startsWith("$GNRMC")) {
-                parseRMC(currentSentence);
-            }
-            else if (currentSentence.startsWith("$GPGSA") || currentSentence.startsWith("$GNGSA")) {
-                parseGSA(currentSentence);
+    else if (c == '\n') {
+        if (sentenceLength > 0) {
+            completeSentence();
+        }
+        resetSentence();
+    }
+    // Anything outside a sentence is ignored
+    else if (sentenceLength > 0) {
+        appendSentenceChar(c);
+    }
+}
+
+void GPSParser::processGPSData(const uint8_t* data, size_t len) {
+    processGPSData(data, len, micros());
+}
+
+void GPSParser::processGPSData(const uint8_t* data, size_t len, uint32_t receivedMicros) {
+    // The whole block counts as received at once, close enough as it is read
+    // as soon as it arrives
+    inputMicros = receivedMicros;
+    
+    // Same result as feeding the bytes one at a time, but the terminators are
+    // located with memchr and the bytes in between are appended in one loop
+    const char* p = (const char*)data;
+    const char* end = p + len;
+    
+    while (p < end) {
+        if (sentenceLength == 0 && protocol != PROTOCOL_NMEA) {
+            // Between sentences every byte may belong to a UBX frame
+            processGPSData(*p++);
+            continue;
+        }
+        if (sentenceLength == 0) {
+            // Skip to the start of the next sentence
+            p = (const char*)memchr(p, '$', end - p);
+            if (p == nullptr) {
+                return;
             }
+            processGPSData(*p++);
+            continue;
+        }
+        
+        // The sentence runs up to the newline, unless a new '$' cuts it short
+        const char* stop = (const char*)memchr(p, '\n', end - p);
+        if (stop == nullptr) {
+            stop = end;
+        }
+        const char* restart = (const char*)memchr(p, '$', stop - p);
+        if (restart != nullptr) {
+            stop = restart;
+        }
+        
+        while (p < stop) {
+            appendSentenceChar(*p++);
         }
         
-        // Reset for next sentence
-        currentSentence = "";
+        // Handle the terminator itself
+        if (p < end) {
+            processGPSData(*p++);
+        }
+    }
+}
+
+void GPSParser::appendSentenceChar(char c) {
+    // Ignore carriage returns and the rest of a sentence that is already too long
+    if (c == '\r' || sentenceOverflow) {
+        return;
+    }
+    
+    if (sentenceLength >= NMEA_SENTENCE_BUFFER_SIZE - 1) {
+        // Too long for an NMEA sentence, drop it at the next newline
+        sentenceOverflow = true;
+        return;
+    }
+    
+    sentence[sentenceLength++] = c;
+    
+    if (c < 0x20 || c > 0x7E) {
+        // Line noise, NMEA is printable ASCII only
+        sentenceCorrupt = true;
+    }
+    else if (!inChecksum) {
+        if (c == '*') {
+            inChecksum = true;
+        } else {
+            runningChecksum ^= c;
+        }
     }
-    // Otherwise, add the character to the current sentence
-    else if (c != '\r') {
-        currentSentence += c;
+    else {
+        int8_t digit = nmeaHexValue(c);
+        if (digit < 0 || checksumDigits >= 2) {
+            sentenceCorrupt = true;
+        } else {
+            receivedChecksum = (receivedChecksum << 4) | digit;
+            checksumDigits++;
+        }
     }
 }
 
-void GPSParser::parseGGA(String sentence) {
-    // $GPGGA,time,lat,N/S,lon,E/W,quality,satellites,hdop,altitude,M,geoidSep,M,dgpsAge,dgpsStationId*checksum
+void GPSParser::resetSentence() {
+    sentenceLength = 0;
+    sentenceOverflow = false;
+    sentenceCorrupt = false;
+    runningChecksum = 0;
+    receivedChecksum = 0;
+    checksumDigits = 0;
+    inChecksum = false;
+}
+
+void GPSParser::completeSentence() {
+    // Reject anything that fails validation before a single field is converted
+    if (sentenceOverflow) {
+        sentencesOverflowed++;
+        return;
+    }
+    if (sentenceCorrupt) {
+        sentencesRejected++;
+        return;
+    }
+    if (!inChecksum || checksumDigits != 2) {
+        sentencesTruncated++;
+        return;
+    }
+    if (receivedChecksum != runningChecksum) {
+        sentencesRejected++;
+        return;
+    }
+    sentencesAccepted++;
+    
+    sentence[sentenceLength] = '\0';
+    tokenizeSentence();
+    dispatchSentence();
+}
+
+void GPSParser::dispatchSentence() {
+    // Address field is the talker ID (GP = GPS, GN = multi-constellation, ...) followed
+    // by the three character sentence type. Proprietary sentences ($P...) are not handled.
+    const char* address = field(0);
+    if (address[0] == 'P' || strlen(address) != 5) {
+        return;
+    }
+    
+    uint32_t id = nmeaSentenceId(&address[2]);
+    for (const SentenceHandler* handler = sentenceHandlers; handler->parse != nullptr; handler++) {
+        if (handler->id == id) {
+            (this->*handler->parse)();
+            return;
+        }
+    }
+}
+
+void GPSParser::tokenizeSentence() {
+    // Split the sentence in place: separators are replaced by string terminators
+    // and the start of every field is recorded. The checksum is not a field.
+    fieldCount = 0;
+    fieldOffsets[fieldCount++] = 1;  // Skip the '$'
+    
+    for (uint8_t i = 1; i < sentenceLength; i++) {
+        if (sentence[i] == ',') {
+            sentence[i] = '\0';
+            if (fieldCount < NMEA_MAX_FIELDS) {
+                fieldOffsets[fieldCount++] = i + 1;
+            }
+        }
+        else if (sentence[i] == '*') {
+            sentence[i] = '\0';
+            break;
+        }
+    }
+}
+
+const char* GPSParser::field(uint8_t index) const {
+    // Missing fields read as empty strings
+    if (index >= fieldCount) {
+        return "";
+    }
+    return &sentence[fieldOffsets[index]];
+}
+
+int32_t GPSParser::intField(uint8_t index) const {
+    // Empty and malformed fields read as 0
+    int32_t value = 0;
+    nmeaParseInt(field(index), value);
+    return value;
+}
+
+bool GPSParser::decimalField(uint8_t index, uint8_t decimals, float& value) const {
+    // Only the fixed-point conversion runs per field, the division is by a power of ten
+    static const float scale[] = { 1.0f, 10.0f, 100.0f, 1000.0f, 10000.0f };
+    int32_t scaled;
+    if (decimals > 4 || nmeaParseFixed(field(index), decimals, scaled) != NMEA_FIELD_OK) {
+        return false;
+    }
+    value = scaled / scale[decimals];
+    return true;
+}
+
+bool GPSParser::rangeField(uint8_t index, uint8_t decimals, float low, float high, float& value) const {
+    // Out of range values are treated like malformed ones: the old value stays
+    float parsed;
+    if (!decimalField(index, decimals, parsed) || parsed < low || parsed > high) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+void GPSParser::beginNMEAEpoch(const char* time) {
+    // Sentences without a valid time belong to the epoch that is already open
+    uint32_t timeOfDay;
+    if (nmeaParseTime(time, timeOfDay) != NMEA_FIELD_OK) {
+        return;
+    }
+    
+    // Key the epoch on the time of day in milliseconds
+    beginEpoch(timeOfDay);
+    pending.timeOfDay = timeOfDay;
+    pending.validTime = true;
+}
+
+void GPSParser::beginEpoch(uint32_t key) {
+    if (epochOpen && key == epochKey) {
+        return;
+    }
     
-    // Split the sentence into fields
-    int commaIndex = 0;
-    int nextCommaIndex = 0;
+    if (epochOpen) {
+        // The previous epoch is over, publish whatever it collected since the
+        // last publication and expect the same sentences from now on
+        if (epochSentenceCount != publishedSentenceCount) {
+            publishFix();
+        }
+        expectedSentences = epochSentences;
+        expectedSentenceCount = epochSentenceCount;
+    }
     
-    // Skip the sentence identifier
-    commaIndex = sentence.indexOf(',');
+    epochOpen = true;
+    epochKey = key;
+    pending.firstByteMicros = sentenceMicros;
+    epochSentences = 0;
+    epochSentenceCount = 0;
+    publishedSentenceCount = 0;
     
-    // Get time
-    nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
-    if (nextCommaIndex > commaIndex + 1) {
-        time = sentence.substring(commaIndex + 1, nextCommaIndex);
-        newData = true;
+    // The next GSA or NAV-SAT starts the used satellites afresh, an epoch
+    // without one keeps those of the last
+    gsaEpochOpen = false;
+}
+
+void GPSParser::completeEpochSentence(uint8_t sentenceBit) {
+    if (!epochOpen) {
+        return;
     }
-    commaIndex = nextCommaIndex;
+    epochSentences |= sentenceBit;
+    epochSentenceCount++;
+    pending.lastByteMicros = inputMicros;
     
-    // Get latitude
-    nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
-    String latStr = sentence.substring(commaIndex + 1, nextCommaIndex);
-    commaIndex = nextCommaIndex;
+    // Publish as soon as the epoch holds everything the previous one had,
+    // rather than waiting for the first sentence of the next second
+    if (expectedSentenceCount > 0 && epochSentenceCount >= expectedSentenceCount &&
+        (epochSentences & expectedSentences) == expectedSentences) {
+        publishFix();
+    }
+}
+
+void GPSParser::publishFix() {
+    pending.sequence++;
+    pending.fields = activeFields.load(std::memory_order_relaxed);
+    pending.utcMillis = (pending.validTime && pending.validDate) ? gpsUnixMillis(pending.date, pending.timeOfDay) : 0;
+    pending.publishedMicros = micros();
+    publishedSentenceCount = epochSentenceCount;
     
-    // Get latitude direction (N/S)
-    nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
-    latDir = sentence.charAt(commaIndex + 1);
-    commaIndex = nextCommaIndex;
+    latency[LATENCY_ARRIVAL].add(pending.lastByteMicros - pending.firstByteMicros);
+    latency[LATENCY_PARSE].add(pending.publishedMicros - pending.firstByteMicros);
     
-    // Get longitude
-    nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
-    String lonStr = sentence.substring(commaIndex + 1, nextCommaIndex);
-    commaIndex = nextCommaIndex;
+    // Seqlock write: readers retry while the counter is odd or has moved
+    uint32_t seq = fixSeqlock.load(std::memory_order_relaxed);
+    fixSeqlock.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    published = pending;
+    fixSeqlock.store(seq + 2, std::memory_order_release);
     
-    // Get longitude direction (E/W)
-    nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
-    lonDir = sentence.charAt(commaIndex + 1);
-    commaIndex = nextCommaIndex;
+    newData = true;
+}
+
+void GPSParser::getFix(Fix& fix) {
+    uint32_t before, after;
+    do {
+        before = fixSeqlock.load(std::memory_order_acquire);
+        fix = published;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = fixSeqlock.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+uint32_t GPSParser::getFixSequence() {
+    // Every publication advances the seqlock by two
+    return fixSeqlock.load(std::memory_order_acquire) >> 1;
+}
+
+void GPSParser::parseGGA() {
+    // $GPGGA,time,lat,N/S,lon,E/W,quality,satellites,hdop,altitude,M,geoidSep,M,dgpsAge,dgpsStationId*checksum
+    
+    // Get time, which may start a new epoch
+    beginNMEAEpoch(field(1));
     
-    // Get fix quality
-    nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
-    int fixQuality = sentence.substring(commaIndex + 1, nextCommaIndex).toInt();
-    validPosition = (fixQuality > 0);
-    commaIndex = nextCommaIndex;
+    // Get latitude and direction (N/S)
+    const char* latStr = field(2);
+    char latDir = field(3)[0];
+    
+    // Get longitude and direction (E/W)
+    const char* lonStr = field(4);
+    char lonDir = field(5)[0];
+    
+    // Get fix quality (0-8)
+    int fixQuality = intField(6);
+    pending.validPosition = (fixQuality > 0 && fixQuality <= 8);
+    
+    // Only the subscribed fields are converted
+    uint16_t fields = activeFields.load(std::memory_order_relaxed);
     
     // Get number of satellites
-    nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
-    satellites = sentence.substring(commaIndex + 1, nextCommaIndex).toInt();
-    commaIndex = nextCommaIndex;
+    if (fields & FIELD_SATELLITES) {
+        int satellites = intField(7);
+        if (satellites >= 0 && satellites <= GPS_MAX_SATELLITES_USED) {
+            pending.satellites = satellites;
+        }
+    }
     
     // Get HDOP
-    nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
-    String hdopStr = sentence.substring(commaIndex + 1, nextCommaIndex);
-    if (hdopStr.length() > 0) {
-        hdop = hdopStr.toFloat();
-        validHDOP = true;
+    if ((fields & FIELD_DOP) && rangeField(8, 2, 0.0f, GPS_MAX_DOP, pending.hdop)) {
+        pending.validHDOP = true;
     }
-    commaIndex = nextCommaIndex;
     
-    // Get altitude
-    nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
-    String altStr = sentence.substring(commaIndex + 1, nextCommaIndex);
-    if (altStr.length() > 0) {
-        altitude = altStr.toFloat();
-        validAltitude = true;
+    // Get altitude and geoid separation
+    if (fields & FIELD_ALTITUDE) {
+        if (decimalField(9, 2, pending.altitude)) {
+            pending.validAltitude = true;
+        }
+        decimalField(11, 2, pending.geoidSeparation);
     }
     
-    // Convert latitude and longitude to decimal degrees
-    if (latStr.length() > 0 && lonStr.length() > 0) {
-        latitude = convertToDecimalDegrees(latStr, latDir);
-        longitude = convertToDecimalDegrees(lonStr, lonDir);
+    // Convert latitude and longitude to 1e-7 degrees, keeping the old position if either is malformed
+    int32_t lat, lon;
+    if ((fields & FIELD_POSITION) && nmeaParseCoordinate(latStr, latDir, lat) == NMEA_FIELD_OK &&
+        nmeaParseCoordinate(lonStr, lonDir, lon) == NMEA_FIELD_OK) {
+        pending.latitudeE7 = lat;
+        pending.longitudeE7 = lon;
     }
+    
+    completeEpochSentence(EPOCH_GGA);
 }
 
-void GPSParser::parseRMC(String sentence) {
+void GPSParser::parseRMC() {
     // $GPRMC,time,status,lat,N/S,lon,E/W,speed,course,date,magnetic variation,E/W*checksum
     
-    // Split the sentence into fields
-    int commaIndex = 0;
-    int nextCommaIndex = 0;
+    // Get time, which may start a new epoch
+    beginNMEAEpoch(field(1));
+    
+    // Get status (A=active, V=void)
+    pending.validPosition = (field(2)[0] == 'A');
     
-    // Skip the sentence identifier
-    commaIndex = sentence.indexOf(',');
+    // Get latitude and direction (N/S)
+    const char* latStr = field(3);
+    char latDir = field(4)[0];
     
-    // Get time
-    nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
-    if (nextCommaIndex > commaIndex + 1) {
-        time = sentence.substring(commaIndex + 1, nextCommaIndex);
-        newData = true;
-    }
-    commaIndex = nextCommaIndex;
+    // Get longitude and direction (E/W)
+    const char* lonStr = field(5);
+    char lonDir = field(6)[0];
     
-    // Get status (A=active, V=void)
-    nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
-    char status = sentence.charAt(commaIndex + 1);
-    validPosition = (status == 'A');
-    commaIndex = nextCommaIndex;
-    
-    // Get latitude
-    nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
-    String latStr = sentence.substring(commaIndex + 1, nextCommaIndex);
-    commaIndex = nextCommaIndex;
-    
-    // Get latitude direction (N/S)
-    nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
-    latDir = sentence.charAt(commaIndex + 1);
-    commaIndex = nextCommaIndex;
-    
-    // Get longitude
-    nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
-    String lonStr = sentence.substring(commaIndex + 1, nextCommaIndex);
-    commaIndex = nextCommaIndex;
-    
-    // Get longitude direction (E/W)
-    nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
-    lonDir = sentence.charAt(commaIndex + 1);
-    commaIndex = nextCommaIndex;
+    // Only the subscribed fields are converted
+    uint16_t fields = activeFields.load(std::memory_order_relaxed);
     
     // Get speed
-    nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
-    String speedStr = sentence.substring(commaIndex + 1, nextCommaIndex);
-    if (speedStr.length() > 0) {
-        speed = speedStr.toFloat();
+    if (fields & FIELD_SPEED) {
+        rangeField(7, 3, 0.0f, GPS_MAX_SPEED_KNOTS, pending.speed);
     }
-    commaIndex = nextCommaIndex;
     
-    // Get course
-    nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
-    String courseStr = sentence.substring(commaIndex + 1, nextCommaIndex);
-    if (courseStr.length() > 0) {
-        course = courseStr.toFloat();
+    // Get course, some receivers report due north as 360
+    if ((fields & FIELD_COURSE) && rangeField(8, 2, 0.0f, 360.0f, pending.course) && pending.course >= 360.0f) {
+        pending.course = 0.0f;
     }
-    commaIndex = nextCommaIndex;
     
     // Get date
-    nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
-    if (nextCommaIndex > commaIndex + 1) {
-        date = sentence.substring(commaIndex + 1, nextCommaIndex);
+    int32_t days;
+    if ((fields & FIELD_DATE) && nmeaParseDate(field(9), days) == NMEA_FIELD_OK) {
+        pending.date = days;
+        pending.validDate = true;
+    }
+    
+    // Convert latitude and longitude to 1e-7 degrees, keeping the old position if either is malformed
+    int32_t lat, lon;
+    if ((fields & FIELD_POSITION) && nmeaParseCoordinate(latStr, latDir, lat) == NMEA_FIELD_OK &&
+        nmeaParseCoordinate(lonStr, lonDir, lon) == NMEA_FIELD_OK) {
+        pending.latitudeE7 = lat;
+        pending.longitudeE7 = lon;
+    }
+    
+    completeEpochSentence(EPOCH_RMC);
+}
+
+void GPSParser::parseGSA() {
+    // $GPGSA,mode,fixType,id1,...,id12,PDOP,HDOP,VDOP[,systemId]*checksum
+    // Multi-constellation receivers send one GSA per system, all for the same epoch
+    
+    // Only the subscribed fields are converted, the sentence still counts towards the epoch
+    uint16_t fields = activeFields.load(std::memory_order_relaxed);
+    
+    // Get fix mode (1=no fix, 2=2D, 3=3D)
+    int mode = intField(2);
+    if (mode >= 1 && mode <= 3) {
+        pending.fixMode = mode;
+    }
+    
+    if (fields & FIELD_USED_SATELLITES) {
+        parseGSAUsedSatellites();
+    }
+    
+    // Get dilution of precision
+    if (fields & FIELD_DOP) {
+        rangeField(15, 2, 0.0f, GPS_MAX_DOP, pending.pdop);
+        if (rangeField(16, 2, 0.0f, GPS_MAX_DOP, pending.hdop)) {
+            pending.validHDOP = true;
+        }
+        rangeField(17, 2, 0.0f, GPS_MAX_DOP, pending.vdop);
+    }
+    
+    completeEpochSentence(EPOCH_GSA);
+}
+
+void GPSParser::parseGSAUsedSatellites() {
+    // Multi-constellation receivers send one GSA per system, all for the same epoch
+    if (!gsaEpochOpen) {
+        memset(pending.usedSatellites, 0, sizeof(pending.usedSatellites));
+        gsaEpochOpen = true;
+    }
+    
+    // NMEA 4.10 adds the GNSS system ID, which maps onto a talker ID
+    const char* talker = field(0);
+    switch (intField(18)) {
+        case 1: talker = "GP"; break;
+        case 2: talker = "GL"; break;
+        case 3: talker = "GA"; break;
+        case 4: talker = "GB"; break;
+        case 5: talker = "GQ"; break;
+        default: break;
     }
     
-    // Convert latitude and longitude to decimal degrees
-    if (latStr.length() > 0 && lonStr.length() > 0) {
-        latitude = convertToDecimalDegrees(latStr, latDir);
-        longitude = convertToDecimalDegrees(lonStr, lonDir);
+    // Get the satellites used in the fix
+    for (uint8_t i = 3; i <= 14; i++) {
+        const char* idStr = field(i);
+        if (idStr[0] == '\0') {
+            continue;
+        }
+        int id = intField(i);
+        Constellation constellation = constellationOf(talker, id);
+        int bit = satelliteBit(constellation, id);
+        if (bit >= 0) {
+            pending.usedSatellites[constellation] |= (uint64_t)1 << bit;
+        }
     }
 }
 
-void GPSParser::parseGSA(String sentence) {
-    // $GPGSA,mode,fixType,satellites used...,PDOP,HDOP,VDOP*checksum
+void GPSParser::parseGSV() {
+    // $GPGSV,totalMessages,messageNumber,satellitesInView,{id,elevation,azimuth,snr}x1..4[,signalId]*checksum
+    
+    // Without subscribers for the table the cycle restarts once there are some again
+    if (!(activeFields.load(std::memory_order_relaxed) & FIELD_SATELLITE_TABLE)) {
+        gsvCycleOpen = false;
+        return;
+    }
+    
+    int totalMessages = intField(1);
+    int messageNumber = intField(2);
+    if (totalMessages < 1 || totalMessages > 9 || messageNumber < 1 || messageNumber > totalMessages) {
+        return;
+    }
+    
+    const char* talker = field(0);
+    unsigned long now = millis();
     
-    // This function would parse GSA sentences for more detailed satellite info
-    // For now, we'll just extract HDOP as a simple implementation
+    if (messageNumber == 1) {
+        // Start a new cycle from the currently published table
+        startSatelliteTable();
+        gsvCycleOpen = true;
+        gsvTotalMessages = totalMessages;
+        gsvTalker[0] = talker[0];
+        gsvTalker[1] = talker[1];
+    }
+    else if (!gsvCycleOpen || messageNumber != gsvNextMessage || totalMessages != gsvTotalMessages ||
+             talker[0] != gsvTalker[0] || talker[1] != gsvTalker[1]) {
+        // Lost a part of the cycle, discard it and wait for the next one
+        gsvCycleOpen = false;
+        return;
+    }
+    gsvNextMessage = messageNumber + 1;
     
-    // Split the sentence into fields
-    int commaIndex = 0;
-    int nextCommaIndex = 0;
+    // Up to four satellites per message, an odd trailing field is the NMEA 4.10 signal ID
+    for (uint8_t base = 4; base + 3 < fieldCount; base += 4) {
+        const char* idStr = field(base);
+        if (idStr[0] == '\0') {
+            continue;
+        }
+        int id = intField(base);
+        updateSatellite(workingSatellites, workingSatelliteCount, constellationOf(talker, id),
+                        id, intField(base + 1), intField(base + 2), intField(base + 3), now);
+    }
     
-    // Skip to the HDOP field (15th field)
-    for (int i = 0; i < 15; i++) {
-        commaIndex = sentence.indexOf(',', commaIndex + 1);
-        if (commaIndex == -1) return; // Not enough fields
+    if (messageNumber == totalMessages) {
+        publishSatelliteTable(now);
+        gsvCycleOpen = false;
+    }
+}
+
+void GPSParser::updateSatellite(SatelliteInfo* table, uint8_t& count, Constellation constellation,
+                                int id, int elevation, int azimuth, int snr, unsigned long now) {
+    if (id <= 0) {
+        return;
     }
     
-    nextCommaIndex = sentence.indexOf(',', commaIndex + 1);
-    if (nextCommaIndex == -1) {
-        // Last field might end with * instead of ,
-        nextCommaIndex = sentence.indexOf('*', commaIndex + 1);
+    // Values outside their range read as not reported
+    if (elevation < 0 || elevation > 90) {
+        elevation = 0;
+    }
+    if (azimuth < 0 || azimuth > 359) {
+        azimuth = 0;
+    }
+    if (snr < 0 || snr > 99) {
+        snr = 0;
     }
     
-    if (nextCommaIndex > commaIndex + 1) {
-        String hdopStr = sentence.substring(commaIndex + 1, nextCommaIndex);
-        if (hdopStr.length() > 0) {
-            hdop = hdopStr.toFloat();
-            validHDOP = true;
+    // Update in place if the satellite is known, otherwise take the next free slot
+    SatelliteInfo* sat = nullptr;
+    for (uint8_t i = 0; i < count; i++) {
+        if (table[i].id == id && table[i].constellation == constellation) {
+            sat = &table[i];
+            break;
+        }
+    }
+    if (sat == nullptr) {
+        if (count >= GPS_MAX_SATELLITES) {
+            return;  // Table full
         }
+        sat = &table[count++];
+        sat->id = id;
+        sat->constellation = constellation;
+        sat->used = false;
     }
+    
+    sat->elevation = elevation;
+    sat->azimuth = azimuth;
+    sat->snr = snr;
+    sat->lastSeen = now;
+}
+
+void GPSParser::startSatelliteTable() {
+    // Only this task writes the published table, it can be read without the seqlock
+    memcpy(workingSatellites, publishedSatellites, publishedSatelliteCount * sizeof(SatelliteInfo));
+    workingSatelliteCount = publishedSatelliteCount;
 }
 
-float GPSParser::convertToDecimalDegrees(String pos, char dir) {
-    // NMEA format: DDMM.MMMM
-    // Need to convert to decimal degrees: DD.DDDDDD
+void GPSParser::publishSatelliteTable(unsigned long now) {
+    SatelliteInfo* table = workingSatellites;
+    uint8_t& count = workingSatelliteCount;
     
-    float value = 0.0;
+    // Age out satellites that are no longer reported, compacting the table
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (now - table[i].lastSeen <= GPS_SATELLITE_MAX_AGE) {
+            if (kept != i) {
+                table[kept] = table[i];
+            }
+            kept++;
+        }
+    }
+    count = kept;
     
-    // Find the decimal point
-    int decimalPoint = pos.indexOf('.');
-    if (decimalPoint == -1) return 0.0;
+    // Seqlock write, as for the fix: readers retry while the counter is odd or has moved
+    uint32_t seq = satelliteSeqlock.load(std::memory_order_relaxed);
+    satelliteSeqlock.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(publishedSatellites, table, count * sizeof(SatelliteInfo));
+    publishedSatelliteCount = count;
+    satelliteSeqlock.store(seq + 2, std::memory_order_release);
+}
+
+void GPSParser::handleUBXFrame() {
+    // UBX epochs are keyed on the GPS time of week, which every NAV message carries
+    UBXParser::NavPvt pvt;
+    UBXParser::NavDop dop;
     
-    // Extract degrees (characters before decimal point minus 2)
-    int degrees = pos.substring(0, decimalPoint - 2).toInt();
+    if (ubx.decodeNavPvt(pvt)) {
+        beginEpoch(pvt.iTOW);
+        
+        // Time and date, if they are in range. The nanoseconds may be negative
+        // when the second was rounded up, that part is dropped.
+        if ((pvt.valid & 0x02) && pvt.hour < 24 && pvt.minute < 60 && pvt.second <= 60) {
+            uint32_t milliseconds = (pvt.nano > 0 && pvt.nano < 1000000000) ? pvt.nano / 1000000 : 0;
+            pending.timeOfDay = ((pvt.hour * 60 + pvt.minute) * 60 + pvt.second) * 1000 + milliseconds;
+            pending.validTime = true;
+        }
+        if ((pvt.valid & 0x01) && pvt.year >= 1980 && pvt.year < 2100 && pvt.month >= 1 && pvt.month <= 12 &&
+            pvt.day >= 1 && pvt.day <= 31) {
+            pending.date = gpsDaysFromCivil(pvt.year, pvt.month, pvt.day);
+            pending.validDate = true;
+        }
+        
+        // Position is already in 1e-7 degrees. One out of range keeps the old
+        // position but marks it invalid.
+        bool inRange = (pvt.lat >= -900000000 && pvt.lat <= 900000000 &&
+                        pvt.lon >= -1800000000 && pvt.lon <= 1800000000);
+        if (inRange) {
+            pending.latitudeE7 = pvt.lat;
+            pending.longitudeE7 = pvt.lon;
+        }
+        pending.validPosition = inRange && (pvt.flags & 0x01) && pvt.fixType >= 2 && pvt.fixType <= 4;
+        pending.fixMode = (pvt.fixType == 2) ? 2 : (pvt.fixType == 3 || pvt.fixType == 4) ? 3 : 1;
+        pending.satellites = pvt.numSV;
+        
+        // Ground speed from mm/s to knots, heading from 1e-5 degrees
+        if (pvt.gSpeed >= 0) {
+            pending.speed = pvt.gSpeed * 0.001f * 1.943844f;
+        }
+        if (pvt.headMot >= 0 && pvt.headMot < 36000000) {
+            pending.course = pvt.headMot * 1e-5f;
+        }
+        
+        // Heights in mm, geoid separation is ellipsoid height minus MSL height
+        pending.altitude = pvt.hMSL * 0.001f;
+        pending.geoidSeparation = ((int64_t)pvt.height - pvt.hMSL) * 0.001f;
+        pending.validAltitude = (pending.fixMode == 3);
+        pending.pdop = pvt.pDOP * 0.01f;
+        
+        completeEpochSentence(EPOCH_UBX_PVT);
+    }
+    else if (ubx.decodeNavDop(dop)) {
+        beginEpoch(dop.iTOW);
+        pending.pdop = dop.pDOP * 0.01f;
+        pending.hdop = dop.hDOP * 0.01f;
+        pending.vdop = dop.vDOP * 0.01f;
+        pending.validHDOP = true;
+        completeEpochSentence(EPOCH_UBX_DOP);
+    }
+    else if (ubx.getClass() == UBX_CLASS_NAV && ubx.getId() == UBX_NAV_SAT) {
+        parseNavSat();
+    }
+}
+
+void GPSParser::parseNavSat() {
+    // A NAV-SAT message is a complete satellite cycle on its own
+    beginEpoch(ubx.getNavSatITOW());
+    if (!(activeFields.load(std::memory_order_relaxed) & (FIELD_SATELLITE_TABLE | FIELD_USED_SATELLITES))) {
+        completeEpochSentence(EPOCH_UBX_SAT);
+        return;
+    }
     
-    // Extract minutes (remaining characters)
-    float minutes = pos.substring(decimalPoint - 2).toFloat();
+    unsigned long now = millis();
+    startSatelliteTable();
+    if (!gsaEpochOpen) {
+        memset(pending.usedSatellites, 0, sizeof(pending.usedSatellites));
+        gsaEpochOpen = true;
+    }
     
-    // Convert to decimal degrees
-    value = degrees + (minutes / 60.0);
+    UBXParser::NavSatellite sat;
+    for (int i = 0; ubx.decodeNavSatellite(i, sat); i++) {
+        // Use the same satellite numbering as the NMEA 4.10 output of u-blox receivers
+        Constellation constellation;
+        int id = sat.svId;
+        switch (sat.gnssId) {
+            case UBXParser::GNSS_ID_GPS:     constellation = CONSTELLATION_GPS; break;
+            case UBXParser::GNSS_ID_SBAS:    constellation = CONSTELLATION_SBAS; id -= 87; break;
+            case UBXParser::GNSS_ID_GALILEO: constellation = CONSTELLATION_GALILEO; break;
+            case UBXParser::GNSS_ID_BEIDOU:  constellation = CONSTELLATION_BEIDOU; break;
+            case UBXParser::GNSS_ID_QZSS:    constellation = CONSTELLATION_QZSS; id += 192; break;
+            case UBXParser::GNSS_ID_GLONASS: constellation = CONSTELLATION_GLONASS; id += 64; break;
+            default: continue;
+        }
+        
+        updateSatellite(workingSatellites, workingSatelliteCount, constellation, id,
+                        max((int)sat.elevation, 0), sat.azimuth, sat.cno, now);
+        
+        int bit = satelliteBit(constellation, id);
+        if (sat.used && bit >= 0) {
+            pending.usedSatellites[constellation] |= (uint64_t)1 << bit;
+        }
+    }
     
-    // Apply direction
-    if (dir == 'S' || dir == 'W') {
-        value = -value;
+    publishSatelliteTable(now);
+    completeEpochSentence(EPOCH_UBX_SAT);
+}
+
+GPSParser::Constellation GPSParser::constellationOf(const char* talker, int id) {
+    // Dedicated talker IDs identify the system directly
+    if (talker[0] == 'G') {
+        switch (talker[1]) {
+            case 'L': return CONSTELLATION_GLONASS;
+            case 'A': return CONSTELLATION_GALILEO;
+            case 'B': return CONSTELLATION_BEIDOU;
+            case 'Q': return CONSTELLATION_QZSS;
+            default: break;
+        }
+    }
+    else if (talker[0] == 'B' && talker[1] == 'D') {
+        return CONSTELLATION_BEIDOU;
     }
     
-    return value;
+    // GP and GN talkers: use the NMEA satellite ID ranges
+    if (id >= 1 && id <= 32) return CONSTELLATION_GPS;
+    if ((id >= 33 && id <= 64) || (id >= 120 && id <= 158)) return CONSTELLATION_SBAS;
+    if (id >= 65 && id <= 99) return CONSTELLATION_GLONASS;
+    if (id >= 193 && id <= 202) return CONSTELLATION_QZSS;
+    if (id >= 301 && id <= 336) return CONSTELLATION_GALILEO;
+    if (id >= 401 && id <= 463) return CONSTELLATION_BEIDOU;
+    return CONSTELLATION_UNKNOWN;
+}
+
+int GPSParser::satelliteBit(Constellation constellation, int id) {
+    // Map the NMEA satellite ID onto a 0-63 index within its constellation.
+    // Receivers use either the extended NMEA ranges or the system's own numbering.
+    int index;
+    switch (constellation) {
+        case CONSTELLATION_SBAS:
+            index = (id >= 120) ? id - 120 : id - 33;
+            break;
+        case CONSTELLATION_GLONASS:
+            index = (id >= 65) ? id - 65 : id - 1;
+            break;
+        case CONSTELLATION_QZSS:
+            index = (id >= 193) ? id - 193 : id - 1;
+            break;
+        case CONSTELLATION_GALILEO:
+            index = (id >= 301) ? id - 301 : id - 1;
+            break;
+        case CONSTELLATION_BEIDOU:
+            index = (id >= 401) ? id - 401 : id - 1;
+            break;
+        default:
+            index = id - 1;
+            break;
+    }
+    return (index >= 0 && index < 64) ? index : -1;
 }
 
 bool GPSParser::isNewDataAvailable() {
@@ -242,131 +837,340 @@ void GPSParser::clearNewDataFlag() {
     newData = false;
 }
 
+GPSParser::Stats GPSParser::getStats() {
+    Stats stats;
+    stats.accepted = sentencesAccepted;
+    stats.rejected = sentencesRejected;
+    stats.truncated = sentencesTruncated;
+    stats.overflowed = sentencesOverflowed;
+    
+    UBXParser::Stats ubxStats = ubx.getStats();
+    stats.ubxAccepted = ubxStats.accepted;
+    stats.ubxRejected = ubxStats.rejected + ubxStats.overflowed;
+    return stats;
+}
+
+void GPSParser::recordLatency(LatencyStage stage, const Fix& fix) {
+    // Sequence 0 is the initial default fix, it never arrived
+    if (fix.sequence == 0 || stage >= LATENCY_STAGE_COUNT) {
+        return;
+    }
+    latency[stage].add(micros() - fix.firstByteMicros);
+}
+
+void GPSParser::resetLatency() {
+    for (uint8_t i = 0; i < LATENCY_STAGE_COUNT; i++) {
+        latency[i].reset();
+    }
+}
+
+void GPSParser::resetStats() {
+    sentencesAccepted = 0;
+    sentencesRejected = 0;
+    sentencesTruncated = 0;
+    sentencesOverflowed = 0;
+    ubx.resetStats();
+}
+
+int GPSParser::subscribe(uint16_t fields) {
+    if (subscriberCount >= GPS_MAX_SUBSCRIBERS) {
+        return -1;
+    }
+    int handle = subscriberCount++;
+    setSubscription(handle, fields);
+    return handle;
+}
+
+void GPSParser::setSubscription(int handle, uint16_t fields) {
+    if (handle < 0 || handle >= subscriberCount) {
+        return;
+    }
+    subscriptions[handle] = fields;
+    
+    // The time is always decoded
+    uint16_t active = FIELD_TIME;
+    for (uint8_t i = 0; i < subscriberCount; i++) {
+        active |= subscriptions[i];
+    }
+    activeFields.store(active, std::memory_order_relaxed);
+}
+
+uint16_t GPSParser::getActiveFields() {
+    return activeFields.load(std::memory_order_relaxed);
+}
+
+void GPSParser::setProtocol(Protocol newProtocol) {
+    protocol = newProtocol;
+}
+
+GPSParser::Protocol GPSParser::getProtocol() {
+    return protocol;
+}
+
+// The getters below each read their own snapshot of the published fix. Callers
+// that need several values of the same epoch should use getFix() instead.
+
 float GPSParser::getLatitude() {
-    return latitude;
+    return getLatitudeE7() * 1e-7f;
 }
 
 float GPSParser::getLongitude() {
-    return longitude;
+    return getLongitudeE7() * 1e-7f;
+}
+
+int32_t GPSParser::getLatitudeE7() {
+    Fix fix;
+    getFix(fix);
+    return fix.latitudeE7;
+}
+
+int32_t GPSParser::getLongitudeE7() {
+    Fix fix;
+    getFix(fix);
+    return fix.longitudeE7;
+}
+
+double GPSParser::getLatitudeDouble() {
+    return getLatitudeE7() * 1e-7;
+}
+
+double GPSParser::getLongitudeDouble() {
+    return getLongitudeE7() * 1e-7;
+}
+
+size_t GPSParser::formatPosition(char* out, size_t cap) {
+    Fix fix;
+    getFix(fix);
+    return formatPosition(fix, out, cap);
 }
 
-String GPSParser::getPositionString() {
-    if (!validPosition) {
-        return "No Fix";
+size_t GPSParser::formatPosition(const Fix& fix, char* out, size_t cap) {
+    if (!fix.validPosition) {
+        return copyText("No Fix", 6, out, cap);
     }
     
-    char buffer[30];
-    char latDir = (latitude >= 0) ? 'N' : 'S';
-    char lonDir = (longitude >= 0) ? 'E' : 'W';
-    float absLat = abs(latitude);
-    float absLon = abs(longitude);
+    if (!formatCached(fix)) {
+        size_t length = formatPosition(fix.latitudeE7, fix.longitudeE7, positionText, sizeof(positionText));
+        positionTextLength = min(length, sizeof(positionText) - 1);
+    }
+    
+    return copyText(positionText, positionTextLength, out, cap);
+}
+
+size_t GPSParser::formatPosition(int32_t latitudeE7, int32_t longitudeE7, char* out, size_t cap) {
+    char latDir = (latitudeE7 >= 0) ? 'N' : 'S';
+    char lonDir = (longitudeE7 >= 0) ? 'E' : 'W';
     
-    sprintf(buffer, "%02d°%05.2f'%c %03d°%05.2f'%c", 
-            (int)absLat, (absLat - (int)absLat) * 60, latDir,
-            (int)absLon, (absLon - (int)absLon) * 60, lonDir);
+    // Round to hundredths of a minute first, then split, so that a value just
+    // below a whole degree carries into the degrees instead of showing 60.00'
+    uint32_t absLat = abs(latitudeE7);
+    uint32_t absLon = abs(longitudeE7);
+    uint32_t lat = ((uint64_t)absLat * 6000 + 5000000) / 10000000;
+    uint32_t lon = ((uint64_t)absLon * 6000 + 5000000) / 10000000;
     
-    return String(buffer);
+    int length = snprintf(out, cap, "%02d°%02d.%02d'%c %03d°%02d.%02d'%c",
+                          (int)(lat / 6000), (int)(lat % 6000 / 100), (int)(lat % 100), latDir,
+                          (int)(lon / 6000), (int)(lon % 6000 / 100), (int)(lon % 100), lonDir);
+    return (length > 0) ? length : 0;
 }
 
 float GPSParser::getSpeed() {
-    return speed;
+    Fix fix;
+    getFix(fix);
+    return fix.speed;
 }
 
 float GPSParser::getCourse() {
-    return course;
+    Fix fix;
+    getFix(fix);
+    return fix.course;
 }
 
 float GPSParser::getAltitude() {
-    return altitude;
+    Fix fix;
+    getFix(fix);
+    return fix.altitude;
 }
 
 bool GPSParser::hasAltitude() {
-    return validAltitude;
+    Fix fix;
+    getFix(fix);
+    return fix.validAltitude;
 }
 
-String GPSParser::getTimeString() {
-    // Format: HHMMSS.SSS
-    if (time.length() < 6) {
-        return "00:00:00";
+size_t GPSParser::formatTime(char* out, size_t cap) {
+    Fix fix;
+    getFix(fix);
+    return formatTime(fix, out, cap);
+}
+
+size_t GPSParser::formatTime(const Fix& fix, char* out, size_t cap) {
+    // HH:MM:SS, a leap second at the end of the day shows as 23:59:60
+    uint32_t seconds = fix.timeOfDay / 1000;
+    if (seconds >= 86400) {
+        return writeSeparated(23, 59, 60, ':', out, cap);
     }
-    
-    int hour = time.substring(0, 2).toInt();
-    int minute = time.substring(2, 4).toInt();
-    int second = time.substring(4, 6).toInt();
-    
-    char buffer[9];
-    sprintf(buffer, "%02d:%02d:%02d", hour, minute, second);
-    return String(buffer);
+    return writeSeparated(seconds / 3600, seconds / 60 % 60, seconds % 60, ':', out, cap);
 }
 
-String GPSParser::getDateString() {
-    // Format: DDMMYY
-    if (date.length() < 6) {
-        return "01/01/00";
+size_t GPSParser::formatDate(char* out, size_t cap) {
+    Fix fix;
+    getFix(fix);
+    return formatDate(fix, out, cap);
+}
+
+size_t GPSParser::formatDate(const Fix& fix, char* out, size_t cap) {
+    // DD/MM/YY
+    int32_t year;
+    uint8_t month, day;
+    gpsCivilFromDays(fix.date, year, month, day);
+    return writeSeparated(day, month, year % 100, '/', out, cap);
+}
+
+int64_t GPSParser::getUnixMillis() {
+    Fix fix;
+    getFix(fix);
+    return fix.utcMillis;
+}
+
+bool GPSParser::formatCached(const Fix& fix) {
+    // A new fix invalidates the text, report whether it is still current and
+    // mark it as current for the caller who is about to build it
+    if (fix.sequence != formatSequence) {
+        formatSequence = fix.sequence;
+        formatValid = false;
     }
-    
-    int day = date.substring(0, 2).toInt();
-    int month = date.substring(2, 4).toInt();
-    int year = date.substring(4, 6).toInt();
-    
-    char buffer[9];
-    sprintf(buffer, "%02d/%02d/%02d", day, month, year);
-    return String(buffer);
+    bool cached = formatValid;
+    formatValid = true;
+    return cached;
 }
 
 int GPSParser::getSatellites() {
-    return satellites;
+    Fix fix;
+    getFix(fix);
+    return fix.satellites;
 }
 
 float GPSParser::getHDOP() {
-    return hdop;
+    Fix fix;
+    getFix(fix);
+    return fix.hdop;
 }
 
 bool GPSParser::hasHDOP() {
-    return validHDOP;
+    Fix fix;
+    getFix(fix);
+    return fix.validHDOP;
 }
 
 bool GPSParser::hasValidPosition() {
-    return validPosition && satellites >= 4;
+    Fix fix;
+    getFix(fix);
+    return fix.validPosition && fix.satellites >= 4;
 }
 
 bool GPSParser::hasValidFix() {
-    return validPosition;
+    Fix fix;
+    getFix(fix);
+    return fix.validPosition;
 }
 
 int GPSParser::getFixQuality() {
-    if(!validPosition) return 0;
-    if(satellites >= 7) return 2; // DGPS fix
-    if(satellites >= 4) return 1; // GPS fix
+    Fix fix;
+    getFix(fix);
+    return getFixQuality(fix);
+}
+
+int GPSParser::getFixQuality(const Fix& fix) {
+    if(!fix.validPosition) return 0;
+    if(fix.satellites >= 7) return 2; // DGPS fix
+    if(fix.satellites >= 4) return 1; // GPS fix
     return 0; // No fix
 }
 
 int GPSParser::getSatelliteInfo(SatelliteInfo* satArray, int maxCount) {
-    // Placeholder implementation - would parse GSV sentences for detailed sat info
-    // For now just return 0 satellites found
-    return 0;
+    // Copy from the published table, never from a cycle in progress. If a new
+    // cycle got published while copying, the copy may be torn: start over.
+    uint32_t before, after;
+    int count;
+    do {
+        before = satelliteSeqlock.load(std::memory_order_acquire);
+        count = min((int)publishedSatelliteCount, maxCount);
+        memcpy(satArray, publishedSatellites, count * sizeof(SatelliteInfo));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = satelliteSeqlock.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    
+    // Fill in the used flag from the latest GSA
+    Fix fix;
+    getFix(fix);
+    for (int i = 0; i < count; i++) {
+        satArray[i].used = isSatelliteUsed(fix, satArray[i].constellation, satArray[i].id);
+    }
+    return count;
+}
+
+int GPSParser::getSatellitesInView() {
+    uint32_t before, after;
+    int count;
+    do {
+        before = satelliteSeqlock.load(std::memory_order_acquire);
+        count = publishedSatelliteCount;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = satelliteSeqlock.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return count;
+}
+
+bool GPSParser::isSatelliteUsed(Constellation constellation, int id) {
+    Fix fix;
+    getFix(fix);
+    return isSatelliteUsed(fix, constellation, id);
+}
+
+bool GPSParser::isSatelliteUsed(const Fix& fix, Constellation constellation, int id) {
+    if (constellation >= CONSTELLATION_COUNT) {
+        return false;
+    }
+    int bit = satelliteBit(constellation, id);
+    return bit >= 0 && (fix.usedSatellites[constellation] & ((uint64_t)1 << bit)) != 0;
 }
 
 float GPSParser::getVDOP() {
-    // Placeholder - would parse GSA sentence for VDOP
-    return 0.0;
+    Fix fix;
+    getFix(fix);
+    return fix.vdop;
 }
 
 float GPSParser::getPDOP() {
-    // Placeholder - would parse GSA sentence for PDOP
-    return 0.0;
+    Fix fix;
+    getFix(fix);
+    return fix.pdop;
 }
 
 float GPSParser::getGeoidSeparation() {
-    // Placeholder - would parse GGA sentence for geoid separation
-    return 0.0;
+    Fix fix;
+    getFix(fix);
+    return fix.geoidSeparation;
+}
+
+int GPSParser::getFixMode() {
+    Fix fix;
+    getFix(fix);
+    return fix.fixMode;
+}
+
+size_t GPSParser::formatFixType(char* out, size_t cap) {
+    Fix fix;
+    getFix(fix);
+    return formatFixType(fix, out, cap);
 }
 
-String GPSParser::getFixTypeString() {
-    switch(getFixQuality()) {
-        case 0: return "No Fix";
-        case 1: return "GPS Fix";
-        case 2: return "DGPS Fix";
-        default: return "Unknown";
+size_t GPSParser::formatFixType(const Fix& fix, char* out, size_t cap) {
+    switch(getFixQuality(fix)) {
+        case 0: return copyText("No Fix", 6, out, cap);
+        case 1: return copyText("GPS Fix", 7, out, cap);
+        case 2: return copyText("DGPS Fix", 8, out, cap);
+        default: return copyText("Unknown", 7, out, cap);
     }
 }
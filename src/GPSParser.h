@@ -2,57 +2,352 @@
 #define GPS_PARSER_H
 
 #include <Arduino.h>
+#include <atomic>
+#include "UBXParser.h"
+#include "NMEANumeric.h"
+#include "GPSTime.h"
+#include "LatencyHistogram.h"
+
+// NMEA 0183 limits a sentence to 82 characters including '$' and CR/LF.
+// The buffer leaves some margin for receivers that stretch the limit.
+#define NMEA_MAX_SENTENCE_LENGTH 82
+#define NMEA_SENTENCE_BUFFER_SIZE (NMEA_MAX_SENTENCE_LENGTH + 14)
+#define NMEA_MAX_FIELDS 24
+
+// Sentence types handled by the parser. Disable the ones a deployment never
+// uses with a build flag, e.g. -D GPS_ENABLE_GSV=0
+#ifndef GPS_ENABLE_GGA
+#define GPS_ENABLE_GGA 1
+#endif
+#ifndef GPS_ENABLE_RMC
+#define GPS_ENABLE_RMC 1
+#endif
+#ifndef GPS_ENABLE_GSA
+#define GPS_ENABLE_GSA 1
+#endif
+#ifndef GPS_ENABLE_GSV
+#define GPS_ENABLE_GSV 1
+#endif
+
+// Input protocol: 0 = NMEA only, 1 = UBX only, 2 = detect both in the same stream
+#ifndef GPS_PROTOCOL
+#define GPS_PROTOCOL 2
+#endif
+
+// Sentence type without the talker ID (e.g. "GGA") packed into an integer,
+// so "$GPGGA" and "$GNGGA" map to the same key
+constexpr uint32_t nmeaSentenceId(const char* type) {
+    return ((uint32_t)(uint8_t)type[0] << 16) | ((uint32_t)(uint8_t)type[1] << 8) | (uint32_t)(uint8_t)type[2];
+}
+
+// Satellite table
+#define GPS_MAX_SATELLITES 48
+#define GPS_SATELLITE_MAX_AGE 5000  // Drop satellites not reported in GSV for this long (ms)
+
+// Plausibility limits, values beyond them are discarded like malformed fields
+#define GPS_MAX_SATELLITES_USED 255
+#define GPS_MAX_DOP 99.99f
+#define GPS_MAX_SPEED_KNOTS 10000.0f
+
+// Consumers that can subscribe to fix fields, see GPSParser::subscribe()
+#define GPS_MAX_SUBSCRIBERS 4
+
+// Buffer sizes that hold the formatted texts including the terminator
+#define GPS_POSITION_TEXT_SIZE 32  // "DD°MM.MM'N DDD°MM.MM'E", the degree sign is two bytes in UTF-8
+#define GPS_TIME_TEXT_SIZE 9       // "HH:MM:SS"
+#define GPS_DATE_TEXT_SIZE 9       // "DD/MM/YY"
+#define GPS_FIX_TYPE_TEXT_SIZE 9   // "DGPS Fix"
 
 class GPSParser {
+public:
+    enum Protocol : uint8_t {
+        PROTOCOL_NMEA = 0,
+        PROTOCOL_UBX = 1,
+        PROTOCOL_AUTO = 2
+    };
+    
+    // GNSS systems, derived from the talker ID or the NMEA satellite ID range
+    enum Constellation : uint8_t {
+        CONSTELLATION_GPS = 0,
+        CONSTELLATION_SBAS,
+        CONSTELLATION_GLONASS,
+        CONSTELLATION_GALILEO,
+        CONSTELLATION_BEIDOU,
+        CONSTELLATION_QZSS,
+        CONSTELLATION_UNKNOWN,
+        CONSTELLATION_COUNT  // Always keep this as the last item
+    };
+    
+    // Fix fields as consumers subscribe to them
+    enum Field : uint16_t {
+        FIELD_TIME = 0x0001,               // Always decoded, epochs are keyed on it
+        FIELD_DATE = 0x0002,
+        FIELD_POSITION = 0x0004,
+        FIELD_SPEED = 0x0008,
+        FIELD_COURSE = 0x0010,
+        FIELD_ALTITUDE = 0x0020,           // Altitude and geoid separation
+        FIELD_SATELLITES = 0x0040,         // Number of satellites used
+        FIELD_DOP = 0x0080,
+        FIELD_FIX_MODE = 0x0100,
+        FIELD_USED_SATELLITES = 0x0200,    // Satellites used in the fix, from GSA
+        FIELD_SATELLITE_TABLE = 0x0400,    // Satellites in view, from GSV or NAV-SAT
+        FIELD_ALL = 0x07FF
+    };
+    
+    // Stages of a fix from the receiver to the user. Each histogram holds the
+    // age of the fix at the end of that stage, counted from the first byte of
+    // its epoch, so the last ones show the end-to-end age.
+    enum LatencyStage : uint8_t {
+        LATENCY_ARRIVAL = 0,  // Last byte of the epoch received
+        LATENCY_PARSE,        // Fix published
+        LATENCY_RENDER,       // Fix drawn on the screen
+        LATENCY_UPLOAD,       // Sentences of the fix uploaded
+        LATENCY_STAGE_COUNT   // Always keep this as the last item
+    };
+    
+    // For satellite view screen
+    struct SatelliteInfo {
+        int id;         // Satellite ID (PRN) as reported by the receiver
+        int elevation;  // 0-90 degrees
+        int azimuth;    // 0-359 degrees
+        int snr;        // Signal-to-noise ratio (0-99 dB), 0 when not tracked
+        bool used;      // Whether satellite is used in position fix
+        Constellation constellation;
+        unsigned long lastSeen;  // millis() of the last GSV report
+    };
+    
+    // Navigation solution of one UTC epoch, assembled from all its sentences.
+    // Values a sentence type did not report in an epoch carry over from the previous one.
+    struct Fix {
+        uint32_t sequence;       // Increments with every published fix
+        
+        // UTC time of the epoch
+        uint32_t timeOfDay;      // ms since midnight
+        int32_t date;            // days since 1970-01-01
+        int64_t utcMillis;       // Unix time (ms), 0 until both time and date are known
+        
+        // Position data in units of 1e-7 degree (about 1 cm)
+        int32_t latitudeE7;
+        int32_t longitudeE7;
+        
+        // Navigation data
+        float speed;             // knots
+        float course;            // degrees
+        float altitude;          // meters above mean sea level
+        float geoidSeparation;   // meters
+        
+        // Satellite data
+        int satellites;
+        float hdop;              // Horizontal dilution of precision
+        float pdop;              // Position dilution of precision
+        float vdop;              // Vertical dilution of precision
+        uint8_t fixMode;         // GSA fix mode: 1=no fix, 2=2D, 3=3D
+        
+        // Satellites used in the fix, one bit per satellite of each constellation
+        uint64_t usedSatellites[CONSTELLATION_COUNT];
+        
+        // Status flags
+        bool validPosition;
+        bool validAltitude;
+        bool validHDOP;
+        bool validTime;
+        bool validDate;
+        
+        // Fields decoded for this fix, the others hold the last value decoded
+        uint16_t fields;
+        
+        // micros() when the first byte ('$' or UBX sync) and the last byte
+        // (newline or checksum) of the epoch arrived, and when it was published
+        uint32_t firstByteMicros;
+        uint32_t lastByteMicros;
+        uint32_t publishedMicros;
+    };
+
 private:
-    // Position data
-    float latitude = 0.0;
-    float longitude = 0.0;
-    char latDir = 'N';
-    char lonDir = 'E';
+    // Fix being assembled from the sentences of the current epoch
+    Fix pending;
     
-    // Navigation data
-    float speed = 0.0;
-    float course = 0.0;
-    float altitude = 0.0;
+    // Epoch tracking: an epoch is published once it contains every sentence type
+    // seen in the previous epoch, or at the latest when the UTC time changes
+    bool epochOpen = false;
+    uint32_t epochKey = 0;               // NMEA time of day or UBX time of week
+    uint8_t epochSentences = 0;          // Sentence types seen in this epoch
+    uint8_t epochSentenceCount = 0;      // Sentences seen, GN receivers send several GSA
+    uint8_t expectedSentences = 0;
+    uint8_t expectedSentenceCount = 0;
+    uint8_t publishedSentenceCount = 0;
     
-    // Time and date
-    String time = "000000.000";
-    String date = "010100";
+    // Cleared by the first GSA or NAV-SAT of an epoch, so per-system GSA
+    // sentences of one epoch accumulate
+    bool gsaEpochOpen = false;
     
-    // Satellite data
-    int satellites = 0;
-    float hdop = 99.99;  // Horizontal dilution of precision
+    // Last published fix, guarded by a seqlock: odd while being written
+    Fix published;
+    std::atomic<uint32_t> fixSeqlock;
+    
+    // Satellite table: GSV cycles and NAV-SAT are assembled in the working
+    // table and only become visible once complete, when they are copied to the
+    // published table. Like the fix, the published table and its count are
+    // guarded by a seqlock.
+    SatelliteInfo workingSatellites[GPS_MAX_SATELLITES];
+    uint8_t workingSatelliteCount = 0;
+    SatelliteInfo publishedSatellites[GPS_MAX_SATELLITES];
+    uint8_t publishedSatelliteCount = 0;
+    std::atomic<uint32_t> satelliteSeqlock;
+    
+    // GSV multi-part message assembly
+    bool gsvCycleOpen = false;
+    uint8_t gsvTotalMessages = 0;
+    uint8_t gsvNextMessage = 0;
+    char gsvTalker[2] = {0, 0};
     
     // Status flags
-    bool newData = false;
-    bool validPosition = false;
-    bool validAltitude = false;
-    bool validHDOP = false;
+    std::atomic<bool> newData;
+    
+    // Arrival time of the bytes being processed and of the current sentence's first byte
+    uint32_t inputMicros = 0;
+    uint32_t sentenceMicros = 0;
     
-    // NMEA sentence parsing
-    String currentSentence = "";
-    bool parsingGGA = false;
-    bool parsingRMC = false;
-    bool parsingGSA = false;
+    // Fix age per stage
+    LatencyHistogram latency[LATENCY_STAGE_COUNT];
+    
+    // Fields some consumer subscribed to, the parser skips converting the
+    // others. Until the first subscription every field is decoded.
+    uint16_t subscriptions[GPS_MAX_SUBSCRIBERS];
+    uint8_t subscriberCount = 0;
+    std::atomic<uint16_t> activeFields;
+    
+    // Position text of the fix with formatSequence, built on first use. Time
+    // and date are integer splits, cheap enough to format on every call.
+    uint32_t formatSequence = 0;
+    bool formatValid = false;
+    char positionText[GPS_POSITION_TEXT_SIZE];
+    uint8_t positionTextLength = 0;
+    
+    // UBX binary protocol
+    Protocol protocol = (Protocol)GPS_PROTOCOL;
+    UBXParser ubx;
+    
+    // NMEA sentence assembly, done in place without heap allocation
+    char sentence[NMEA_SENTENCE_BUFFER_SIZE];
+    uint8_t sentenceLength = 0;
+    bool sentenceOverflow = false;
+    bool sentenceCorrupt = false;
+    
+    // Checksum is computed while the sentence streams in
+    uint8_t runningChecksum = 0;
+    uint8_t receivedChecksum = 0;
+    uint8_t checksumDigits = 0;
+    bool inChecksum = false;
+    
+    // Start offsets of the fields of the current sentence, field 0 is the address
+    uint8_t fieldOffsets[NMEA_MAX_FIELDS];
+    uint8_t fieldCount = 0;
+    
+    // Sentence statistics
+    uint32_t sentencesAccepted = 0;
+    uint32_t sentencesRejected = 0;
+    uint32_t sentencesTruncated = 0;
+    uint32_t sentencesOverflowed = 0;
+    
+    // Sentence dispatch table, terminated by an entry with a null parser
+    struct SentenceHandler {
+        uint32_t id;
+        void (GPSParser::*parse)();
+    };
+    static const SentenceHandler sentenceHandlers[];
     
     // Helper methods
-    void parseGGA(String sentence);
-    void parseRMC(String sentence);
-    void parseGSA(String sentence);
-    float convertToDecimalDegrees(String pos, char dir);
+    void appendSentenceChar(char c);
+    void resetSentence();
+    void completeSentence();
+    void tokenizeSentence();
+    void dispatchSentence();
+    const char* field(uint8_t index) const;
+    int32_t intField(uint8_t index) const;
+    bool decimalField(uint8_t index, uint8_t decimals, float& value) const;
+    bool rangeField(uint8_t index, uint8_t decimals, float low, float high, float& value) const;
+    void beginNMEAEpoch(const char* time);
+    void beginEpoch(uint32_t key);
+    void completeEpochSentence(uint8_t sentenceBit);
+    void publishFix();
+    void parseGGA();
+    void parseRMC();
+    void parseGSA();
+    void parseGSAUsedSatellites();
+    void parseGSV();
+    void updateSatellite(SatelliteInfo* table, uint8_t& count, Constellation constellation,
+                         int id, int elevation, int azimuth, int snr, unsigned long now);
+    void startSatelliteTable();
+    void publishSatelliteTable(unsigned long now);
+    void handleUBXFrame();
+    void parseNavSat();
+    bool formatCached(const Fix& fix);
+    static Constellation constellationOf(const char* talker, int id);
+    static int satelliteBit(Constellation constellation, int id);
 
 public:
     GPSParser();
     
     void processGPSData(char c);
+    void processGPSData(const uint8_t* data, size_t len);
+    
+    // Same, with the micros() at which the data arrived when it was read
+    // later, e.g. from a backlog in the UART buffer
+    void processGPSData(const uint8_t* data, size_t len, uint32_t receivedMicros);
     bool isNewDataAvailable();
     void clearNewDataFlag();
     
+    // Consistent copy of the last published fix, safe to call from another task
+    void getFix(Fix& fix);
+    
+    // Sequence number of the last published fix, cheap to poll for new fixes
+    uint32_t getFixSequence();
+    
+    // Input link quality
+    struct Stats {
+        uint32_t accepted;    // Sentences with a valid checksum
+        uint32_t rejected;    // Checksum mismatch or invalid characters
+        uint32_t truncated;   // Missing or incomplete checksum, or cut off by a new '$'
+        uint32_t overflowed;  // Longer than the sentence buffer
+        uint32_t ubxAccepted; // UBX frames with a valid checksum
+        uint32_t ubxRejected; // UBX frames with a bad checksum or length
+    };
+    
+    Stats getStats();
+    void resetStats();
+    
+    // Fix age histograms. The parser records arrival and parsing, consumers
+    // report when they rendered or uploaded a fix. Each stage must have a
+    // single writer, reading from another task gives an approximate snapshot.
+    void recordLatency(LatencyStage stage, const Fix& fix);
+    const LatencyHistogram& getLatency(LatencyStage stage) const { return latency[stage]; }
+    void resetLatency();
+    
+    // Decode only the fields consumers need. subscribe() returns a handle for
+    // changing the subscription later, -1 when all GPS_MAX_SUBSCRIBERS are taken.
+    int subscribe(uint16_t fields);
+    void setSubscription(int handle, uint16_t fields);
+    uint16_t getActiveFields();
+    
+    // Select which protocol(s) the input carries
+    void setProtocol(Protocol newProtocol);
+    Protocol getProtocol();
+    
     // Position getters
     float getLatitude();
     float getLongitude();
-    String getPositionString();
+    int32_t getLatitudeE7();
+    int32_t getLongitudeE7();
+    double getLatitudeDouble();
+    double getLongitudeDouble();
+    
+    // Text formatting into a caller buffer. The text is truncated to fit, out is
+    // always terminated and the return value is the length of the full text.
+    // The position text is built once per fix and cached: call from one task only.
+    size_t formatPosition(char* out, size_t cap);
+    size_t formatPosition(const Fix& fix, char* out, size_t cap);
+    static size_t formatPosition(int32_t latitudeE7, int32_t longitudeE7, char* out, size_t cap);
     
     // Navigation getters
     float getSpeed();
@@ -60,9 +355,12 @@ public:
     float getAltitude();
     bool hasAltitude();
     
-    // Time and date getters
-    String getTimeString();
-    String getDateString();
+    // Time and date as text, and as Unix time in milliseconds (0 if unknown)
+    int64_t getUnixMillis();
+    size_t formatTime(char* out, size_t cap);
+    size_t formatDate(char* out, size_t cap);
+    static size_t formatTime(const Fix& fix, char* out, size_t cap);
+    static size_t formatDate(const Fix& fix, char* out, size_t cap);
     
     // Satellite data getters
     int getSatellites();
@@ -73,24 +371,21 @@ public:
     bool hasValidPosition();
     bool hasValidFix();
     int getFixQuality();  // 0=no fix, 1=GPS fix, 2=DGPS fix
-    
-    // For satellite view screen
-    struct SatelliteInfo {
-        int id;
-        int elevation;  // 0-90 degrees
-        int azimuth;    // 0-359 degrees
-        int snr;        // Signal-to-noise ratio (0-99 dB)
-        bool used;      // Whether satellite is used in position fix
-    };
+    static int getFixQuality(const Fix& fix);
     
     // Return array of visible satellites (up to maxCount)
     int getSatelliteInfo(SatelliteInfo* satArray, int maxCount);
-
+    int getSatellitesInView();
+    bool isSatelliteUsed(Constellation constellation, int id);
+    static bool isSatelliteUsed(const Fix& fix, Constellation constellation, int id);
+    
     // Additional GPS data getters
     float getVDOP();
     float getPDOP();
     float getGeoidSeparation();
-    String getFixTypeString();
+    int getFixMode();  // 1=no fix, 2=2D, 3=3D
+    size_t formatFixType(char* out, size_t cap);
+    static size_t formatFixType(const Fix& fix, char* out, size_t cap);
 };
 
 #endif // GPS_PARSER_H
@@ -0,0 +1,71 @@
+#ifndef GPS_PORT_H
+#define GPS_PORT_H
+
+#include <Arduino.h>
+
+// Byte link to the GPS receiver. The configurator talks to the receiver
+// through this interface only, so a scripted fake receiver can stand in
+// for the UART when running on the host.
+class GPSPort {
+public:
+    virtual ~GPSPort() {}
+    
+    // (Re)open the link at the given baud rate, dropping buffered input
+    virtual void setBaud(uint32_t baud) = 0;
+    virtual uint32_t getBaud() const = 0;
+    
+    virtual int available() = 0;
+    virtual int read() = 0;
+    
+    // Read up to length bytes that are already buffered, without waiting
+    virtual size_t readBytes(uint8_t* buffer, size_t length) {
+        size_t count = 0;
+        while (count < length && available() > 0) {
+            buffer[count++] = (uint8_t)read();
+        }
+        return count;
+    }
+    virtual size_t write(const uint8_t* data, size_t length) = 0;
+    
+    // Block until all written bytes have left the transmitter
+    virtual void flush() = 0;
+    
+    // Time source for timeouts, a fake receiver can run on simulated time
+    virtual unsigned long now() { return millis(); }
+};
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <HardwareSerial.h>
+
+// GPSPort on one of the ESP32 hardware UARTs
+class SerialGPSPort : public GPSPort {
+public:
+    SerialGPSPort(HardwareSerial& serial, int8_t rxPin, int8_t txPin)
+        : serial(serial), rxPin(rxPin), txPin(txPin), baud(0) {}
+    
+    void setBaud(uint32_t newBaud) override {
+        if (baud != 0) {
+            serial.end();
+        }
+        baud = newBaud;
+        serial.begin(baud, SERIAL_8N1, rxPin, txPin);
+    }
+    
+    uint32_t getBaud() const override { return baud; }
+    int available() override { return serial.available(); }
+    int read() override { return serial.read(); }
+    size_t readBytes(uint8_t* buffer, size_t length) override {
+        return serial.readBytes(buffer, min(length, (size_t)serial.available()));
+    }
+    size_t write(const uint8_t* data, size_t length) override { return serial.write(data, length); }
+    void flush() override { serial.flush(); }
+
+private:
+    HardwareSerial& serial;
+    int8_t rxPin;
+    int8_t txPin;
+    uint32_t baud;
+};
+#endif
+
+#endif // GPS_PORT_H
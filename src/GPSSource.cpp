@@ -0,0 +1,353 @@
+#include "GPSSource.h"
+#include <stdarg.h>
+#include "GPSTime.h"
+
+#define METERS_PER_DEGREE 111320.0  // Along a meridian, and along the equator
+
+size_t PortGPSSource::read(uint8_t* buffer, size_t cap) {
+    size_t count = port.readBytes(buffer, cap);
+    if (count > 0) {
+        // The last byte read arrived before everything still waiting, 10 bits per byte
+        uint32_t baud = port.getBaud();
+        uint32_t waiting = max(port.available(), 0);
+        received = micros() - (baud > 0 ? (uint32_t)((uint64_t)waiting * 10000000 / baud) : 0);
+    }
+    return count;
+}
+
+void PlaybackGPSSource::setSpeed(uint16_t factor) {
+    speed = factor;
+    started = false;
+}
+
+uint32_t PlaybackGPSSource::playbackTime(uint32_t position) {
+    if (speed == GPS_SOURCE_SPEED_FAST) {
+        return UINT32_MAX;
+    }
+    
+    unsigned long time = now();
+    if (!started) {
+        started = true;
+        startTime = time;
+        startPosition = position;
+    }
+    uint64_t due = startPosition + (uint64_t)(time - startTime) * speed;
+    return (due > UINT32_MAX) ? UINT32_MAX : (uint32_t)due;
+}
+
+ReplayGPSSource::ReplayGPSSource(FILE* file, uint32_t baud) : file(file), baud(baud > 0 ? baud : GPS_REPLAY_DEFAULT_BAUD) {
+    // A raw capture has no header, whatever was read for the check is data
+    chunkLength = fread(chunk, 1, GPS_RECORDING_MAGIC_LENGTH, file);
+    timestamped = (chunkLength == GPS_RECORDING_MAGIC_LENGTH &&
+                   memcmp(chunk, GPS_RECORDING_MAGIC, GPS_RECORDING_MAGIC_LENGTH) == 0);
+    if (timestamped) {
+        chunkLength = 0;
+    }
+}
+
+bool ReplayGPSSource::loadChunk() {
+    chunkOffset = 0;
+    chunkLength = 0;
+    if (endOfFile) {
+        return false;
+    }
+    
+    if (timestamped) {
+        uint8_t header[6];
+        if (fread(header, 1, sizeof(header), file) != sizeof(header)) {
+            endOfFile = true;
+            return false;
+        }
+        chunkTime = header[0] | ((uint32_t)header[1] << 8) | ((uint32_t)header[2] << 16) | ((uint32_t)header[3] << 24);
+        size_t length = header[4] | ((size_t)header[5] << 8);
+        
+        // A record that cannot be right ends the replay rather than misaligning the rest
+        if (length > GPS_RECORDING_MAX_CHUNK || fread(chunk, 1, length, file) != length) {
+            endOfFile = true;
+            return false;
+        }
+        chunkLength = length;
+    }
+    else {
+        chunkLength = fread(chunk, 1, sizeof(chunk), file);
+        if (chunkLength == 0) {
+            endOfFile = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t ReplayGPSSource::rawTime(uint64_t bytes) const {
+    // 10 bits per byte on the wire: start bit, 8 data bits, stop bit
+    uint64_t time = bytes * 10000 / baud;
+    return (time > UINT32_MAX) ? UINT32_MAX : (uint32_t)time;
+}
+
+size_t ReplayGPSSource::read(uint8_t* buffer, size_t cap) {
+    size_t count = 0;
+    while (count < cap) {
+        if (chunkOffset >= chunkLength && !loadChunk()) {
+            break;
+        }
+        
+        size_t length = min(cap - count, chunkLength - chunkOffset);
+        if (timestamped) {
+            // Records are due as a whole
+            if (chunkTime > playbackTime(chunkTime)) {
+                break;
+            }
+        }
+        else {
+            // Bytes are due one by one at the pace of the baud rate
+            uint64_t due = (uint64_t)playbackTime(rawTime(rawBytesDelivered)) * baud / 10000 + 1;
+            if (due <= rawBytesDelivered) {
+                break;
+            }
+            length = (size_t)min((uint64_t)length, due - rawBytesDelivered);
+            rawBytesDelivered += length;
+        }
+        
+        memcpy(buffer + count, chunk + chunkOffset, length);
+        chunkOffset += length;
+        count += length;
+    }
+    return count;
+}
+
+bool ReplayGPSSource::finished() {
+    return chunkOffset >= chunkLength && !loadChunk();
+}
+
+bool ReplayGPSSource::writeHeader(FILE* file) {
+    return fwrite(GPS_RECORDING_MAGIC, 1, GPS_RECORDING_MAGIC_LENGTH, file) == GPS_RECORDING_MAGIC_LENGTH;
+}
+
+bool ReplayGPSSource::writeRecord(FILE* file, uint32_t time, const uint8_t* data, uint16_t length) {
+    if (length > GPS_RECORDING_MAX_CHUNK) {
+        return false;
+    }
+    uint8_t header[6] = {
+        (uint8_t)time, (uint8_t)(time >> 8), (uint8_t)(time >> 16), (uint8_t)(time >> 24),
+        (uint8_t)length, (uint8_t)(length >> 8)
+    };
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header) && fwrite(data, 1, length, file) == length;
+}
+
+SyntheticGPSSource::Settings SyntheticGPSSource::defaultSettings() {
+    static const Waypoint home = { 520907392, 50728783 };
+    Settings settings;
+    settings.route = &home;
+    settings.waypoints = 1;
+    settings.speed = 0;
+    settings.rateHz = 1;
+    settings.noise = 1.5f;
+    settings.satellites = 10;
+    settings.hdop = 0.9f;
+    settings.startDay = 19797;             // 2024-03-15
+    settings.startTimeOfDay = 36000000;    // 10:00:00
+    settings.seed = 1;
+    return settings;
+}
+
+SyntheticGPSSource::SyntheticGPSSource(const Settings& newSettings) : settings(newSettings) {
+    settings.waypoints = constrain(settings.waypoints, 1, GPS_SYNTHETIC_MAX_WAYPOINTS);
+    settings.rateHz = constrain(settings.rateHz, 1, 50);
+    settings.satellites = constrain(settings.satellites, 4, 12);
+    noiseState = (settings.seed != 0) ? settings.seed : 1;
+    
+    if (settings.route != nullptr) {
+        memcpy(route, settings.route, settings.waypoints * sizeof(Waypoint));
+    }
+    else {
+        route[0] = defaultSettings().route[0];
+        settings.waypoints = 1;
+    }
+    settings.route = route;
+    
+    // Segment lengths on a local flat earth, good enough over a few km
+    for (uint8_t i = 0; i < settings.waypoints; i++) {
+        const Waypoint& from = route[i];
+        const Waypoint& to = route[(i + 1) % settings.waypoints];
+        double north = (to.latitudeE7 - from.latitudeE7) * 1e-7 * METERS_PER_DEGREE;
+        double east = (to.longitudeE7 - from.longitudeE7) * 1e-7 * METERS_PER_DEGREE *
+                      cos((from.latitudeE7 + to.latitudeE7) * 0.5e-7 * M_PI / 180);
+        segmentLength[i] = sqrt(north * north + east * east);
+        routeLength += segmentLength[i];
+    }
+}
+
+uint32_t SyntheticGPSSource::epochTime(uint32_t index) const {
+    return (uint32_t)((uint64_t)index * 1000 / settings.rateHz);
+}
+
+size_t SyntheticGPSSource::read(uint8_t* buffer, size_t cap) {
+    size_t count = 0;
+    while (count < cap) {
+        if (epochOffset >= epochLength) {
+            if (epochTime(epoch) > playbackTime(epochTime(epoch))) {
+                break;
+            }
+            generateEpoch();
+        }
+        
+        size_t length = min(cap - count, epochLength - epochOffset);
+        memcpy(buffer + count, epochText + epochOffset, length);
+        epochOffset += length;
+        count += length;
+    }
+    return count;
+}
+
+float SyntheticGPSSource::gaussian() {
+    // Box-Muller on two uniform numbers from a linear congruential generator
+    noiseState = noiseState * 1103515245 + 12345;
+    float u1 = ((noiseState >> 8) + 1.0f) / 16777217.0f;
+    noiseState = noiseState * 1103515245 + 12345;
+    float u2 = (noiseState >> 8) / 16777216.0f;
+    return sqrtf(-2.0f * logf(u1)) * cosf(2.0f * (float)M_PI * u2);
+}
+
+size_t SyntheticGPSSource::formatCoordinate(char* out, size_t cap, int32_t valueE7, bool latitude) {
+    // ddmm.mmmmm or dddmm.mmmmm, minutes in units of 1e-5
+    uint32_t value = (valueE7 < 0) ? -(int64_t)valueE7 : valueE7;
+    uint32_t degrees = value / 10000000;
+    uint32_t minutes = (uint32_t)(((uint64_t)(value % 10000000) * 3 + 2) / 5);
+    if (minutes >= 6000000) {
+        degrees++;
+        minutes -= 6000000;
+    }
+    char hemisphere = latitude ? (valueE7 < 0 ? 'S' : 'N') : (valueE7 < 0 ? 'W' : 'E');
+    int length = snprintf(out, cap, "%0*lu%02lu.%05lu,%c", latitude ? 2 : 3, (unsigned long)degrees,
+                          (unsigned long)(minutes / 100000), (unsigned long)(minutes % 100000), hemisphere);
+    return (length > 0) ? length : 0;
+}
+
+size_t SyntheticGPSSource::appendSentence(size_t length, const char* format, ...) {
+    // '$', body, then "*hh\r\n" with the checksum over the body
+    size_t room = sizeof(epochText) - length;
+    if (room < 7) {
+        return length;
+    }
+    va_list args;
+    va_start(args, format);
+    int body = vsnprintf(epochText + length + 1, room - 6, format, args);
+    va_end(args);
+    if (body < 0 || (size_t)body >= room - 6) {
+        return length;
+    }
+    
+    uint8_t checksum = 0;
+    for (int i = 0; i < body; i++) {
+        checksum ^= (uint8_t)epochText[length + 1 + i];
+    }
+    epochText[length] = '$';
+    snprintf(epochText + length + 1 + body, 6, "*%02X\r\n", checksum);
+    return length + 1 + body + 5;
+}
+
+void SyntheticGPSSource::generateEpoch() {
+    uint32_t time = epochTime(epoch);
+    
+    // Position along the route, which repeats once driven
+    int32_t latitude = route[0].latitudeE7;
+    int32_t longitude = route[0].longitudeE7;
+    float course = 0;
+    float speed = 0;
+    if (routeLength > 0 && settings.speed > 0) {
+        double distance = fmod(settings.speed * (time * 0.001), routeLength);
+        uint8_t segment = 0;
+        while (segment + 1 < settings.waypoints && distance > segmentLength[segment]) {
+            distance -= segmentLength[segment];
+            segment++;
+        }
+        const Waypoint& from = route[segment];
+        const Waypoint& to = route[(segment + 1) % settings.waypoints];
+        double fraction = (segmentLength[segment] > 0) ? min(distance / segmentLength[segment], 1.0) : 0.0;
+        latitude = from.latitudeE7 + (int32_t)((to.latitudeE7 - from.latitudeE7) * fraction);
+        longitude = from.longitudeE7 + (int32_t)(((int64_t)to.longitudeE7 - from.longitudeE7) * fraction);
+        
+        double north = (double)(to.latitudeE7 - from.latitudeE7);
+        double east = ((int64_t)to.longitudeE7 - from.longitudeE7) * cos(latitude * 1e-7 * M_PI / 180);
+        course = atan2(east, north) * 180 / M_PI;
+        if (course < 0) {
+            course += 360;
+        }
+        if (course >= 360) {
+            course = 0;
+        }
+        speed = settings.speed;
+    }
+    trueLatitudeE7 = latitude;
+    trueLongitudeE7 = longitude;
+    
+    // Measurement noise in meters, converted to 1e-7 degrees
+    if (settings.noise > 0) {
+        double perMeter = 1e7 / METERS_PER_DEGREE;
+        latitude += (int32_t)(gaussian() * settings.noise * perMeter);
+        longitude += (int32_t)(gaussian() * settings.noise * perMeter / max(cos(latitude * 1e-7 * M_PI / 180), 0.01));
+        latitude = constrain(latitude, -900000000, 900000000);
+        longitude = constrain(longitude, -1800000000, 1800000000);
+    }
+    
+    // UTC time and date of the epoch
+    uint64_t milliseconds = settings.startTimeOfDay + (uint64_t)time;
+    int32_t days = settings.startDay + (int32_t)(milliseconds / 86400000);
+    uint32_t timeOfDay = milliseconds % 86400000;
+    char timeText[11];
+    snprintf(timeText, sizeof(timeText), "%02lu%02lu%02lu.%02lu", (unsigned long)(timeOfDay / 3600000),
+             (unsigned long)(timeOfDay / 60000 % 60), (unsigned long)(timeOfDay / 1000 % 60),
+             (unsigned long)(timeOfDay % 1000 / 10));
+    
+    int32_t year;
+    uint8_t month, day;
+    gpsCivilFromDays(days, year, month, day);
+    char dateText[7];
+    snprintf(dateText, sizeof(dateText), "%02u%02u%02u", (unsigned)(day % 100), (unsigned)(month % 100),
+             (unsigned)(year % 100));
+    
+    char latitudeText[16];
+    char longitudeText[16];
+    formatCoordinate(latitudeText, sizeof(latitudeText), latitude, true);
+    formatCoordinate(longitudeText, sizeof(longitudeText), longitude, false);
+    
+    size_t length = 0;
+    length = appendSentence(length, "GNRMC,%s,A,%s,%s,%.3f,%.2f,%s,,,A", timeText, latitudeText, longitudeText,
+                            speed * 1.943844f, course, dateText);
+    length = appendSentence(length, "GNGGA,%s,%s,%s,1,%02u,%.2f,10.0,M,46.0,M,,", timeText, latitudeText,
+                            longitudeText, settings.satellites, settings.hdop);
+    
+    // Satellite status with the first epoch of every second
+    if (time % 1000 < epochTime(1)) {
+        char used[64];
+        size_t usedLength = 0;
+        for (uint8_t i = 1; i <= 12; i++) {
+            if (i <= settings.satellites) {
+                usedLength += snprintf(used + usedLength, sizeof(used) - usedLength, "%02u,", i);
+            }
+            else {
+                used[usedLength++] = ',';
+            }
+        }
+        used[usedLength] = '\0';
+        length = appendSentence(length, "GNGSA,A,3,%s%.2f,%.2f,%.2f", used, settings.hdop * 1.6f, settings.hdop,
+                                settings.hdop * 1.3f);
+        
+        uint8_t messages = (settings.satellites + 3) / 4;
+        for (uint8_t message = 0; message < messages; message++) {
+            char satellites[80];
+            size_t satellitesLength = 0;
+            for (uint8_t id = message * 4 + 1; id <= min(message * 4 + 4, (int)settings.satellites); id++) {
+                satellitesLength += snprintf(satellites + satellitesLength, sizeof(satellites) - satellitesLength,
+                                             ",%02u,%02u,%03u,%02u", id, 10 + (id * 37) % 80, (id * 83) % 360,
+                                             30 + (id * 7) % 20);
+            }
+            satellites[satellitesLength] = '\0';
+            length = appendSentence(length, "GPGSV,%u,%u,%02u%s", messages, message + 1, settings.satellites, satellites);
+        }
+    }
+    
+    epochLength = length;
+    epochOffset = 0;
+    epoch++;
+}
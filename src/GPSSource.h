@@ -0,0 +1,174 @@
+#ifndef GPS_SOURCE_H
+#define GPS_SOURCE_H
+
+#include <Arduino.h>
+#include <stdio.h>
+#include "GPSPort.h"
+
+// Playback speed that delivers everything as fast as it is read
+#define GPS_SOURCE_SPEED_FAST 0
+
+// Recorded logs with timestamps start with this line, followed by records of
+// a little-endian uint32 time (ms), a uint16 length and that many bytes
+#define GPS_RECORDING_MAGIC "GPSREC1\n"
+#define GPS_RECORDING_MAGIC_LENGTH 8
+#define GPS_RECORDING_MAX_CHUNK 512
+
+// Bytes per second of a raw recording without timestamps, 10 bits per byte
+#define GPS_REPLAY_DEFAULT_BAUD 115200
+
+// Synthetic receiver
+#define GPS_SYNTHETIC_MAX_WAYPOINTS 16
+#define GPS_SYNTHETIC_EPOCH_SIZE 640  // Largest epoch: GGA, RMC, GSA and three GSV
+
+// Where the parser input comes from: the receiver, a recorded log or a
+// generated route. read() returns the bytes that are due at the moment and
+// never blocks, so the main loop drains every kind of source the same way.
+class GPSSource {
+public:
+    virtual ~GPSSource() {}
+    
+    // Copy up to cap due bytes into buffer, returns the count, 0 if none are due
+    virtual size_t read(uint8_t* buffer, size_t cap) = 0;
+    
+    // True once a finite source has delivered everything
+    virtual bool finished() { return false; }
+    
+    // micros() at which the bytes of the last read() arrived, for the fix latency
+    virtual uint32_t receivedMicros() { return micros(); }
+};
+
+// The receiver on a GPSPort, usually the UART
+class PortGPSSource : public GPSSource {
+public:
+    PortGPSSource(GPSPort& port) : port(port), received(0) {}
+    
+    size_t read(uint8_t* buffer, size_t cap) override;
+    
+    // Estimated from the bytes still waiting in the receive buffer, which came
+    // in after the ones read. Assumes the receiver sends without pauses, so
+    // after a stall the bytes may have waited longer than this tells.
+    uint32_t receivedMicros() override { return received; }
+
+private:
+    GPSPort& port;
+    uint32_t received;
+};
+
+// Sources with their own timeline, played back at real time, N times faster
+// or as fast as they are read
+class PlaybackGPSSource : public GPSSource {
+public:
+    // 1 = real time, N = N times faster, GPS_SOURCE_SPEED_FAST = no pacing.
+    // Can be changed during playback, which continues from where it is.
+    void setSpeed(uint16_t factor);
+    uint16_t getSpeed() const { return speed; }
+    
+    // Time source for pacing, a test can run on simulated time
+    virtual unsigned long now() { return millis(); }
+
+protected:
+    // Source time (ms) due for delivery. The first call after a start or a speed
+    // change anchors the playback clock at position, the time of the next data.
+    uint32_t playbackTime(uint32_t position);
+
+private:
+    uint16_t speed = 1;
+    bool started = false;
+    unsigned long startTime = 0;
+    uint32_t startPosition = 0;
+};
+
+// Replay of a recorded log, NMEA and UBX alike. A recording with timestamps
+// (GPS_RECORDING_MAGIC) is delivered with its original timing, a raw capture
+// at the pace of the given baud rate.
+class ReplayGPSSource : public PlaybackGPSSource {
+public:
+    // The file stays owned by the caller and must remain open during replay
+    ReplayGPSSource(FILE* file, uint32_t baud = GPS_REPLAY_DEFAULT_BAUD);
+    
+    size_t read(uint8_t* buffer, size_t cap) override;
+    bool finished() override;
+    
+    bool isTimestamped() const { return timestamped; }
+    
+    // Write a recording: the header once, then one record per chunk of input
+    static bool writeHeader(FILE* file);
+    static bool writeRecord(FILE* file, uint32_t time, const uint8_t* data, uint16_t length);
+
+private:
+    FILE* file;
+    uint32_t baud;
+    bool timestamped;
+    bool endOfFile = false;
+    
+    // Bytes read from the file but not yet delivered, with the source time
+    // they are due at
+    uint8_t chunk[GPS_RECORDING_MAX_CHUNK];
+    size_t chunkLength = 0;
+    size_t chunkOffset = 0;
+    uint32_t chunkTime = 0;
+    
+    uint64_t rawBytesDelivered = 0;
+    
+    bool loadChunk();
+    uint32_t rawTime(uint64_t bytes) const;
+};
+
+// Receiver simulation driving a route at constant speed. Sends GGA and RMC
+// every epoch and GSA and GSV once per second, with Gaussian position noise.
+class SyntheticGPSSource : public PlaybackGPSSource {
+public:
+    struct Waypoint {
+        int32_t latitudeE7;
+        int32_t longitudeE7;
+    };
+    
+    struct Settings {
+        const Waypoint* route;     // Driven in order, from the last point back to the first
+        uint8_t waypoints;
+        float speed;               // m/s
+        uint8_t rateHz;            // Epochs per second, 1-50
+        float noise;               // Standard deviation of the position error (m)
+        uint8_t satellites;        // Satellites used, 4-12
+        float hdop;
+        int32_t startDay;          // Days since 1970-01-01
+        uint32_t startTimeOfDay;   // ms since midnight UTC
+        uint32_t seed;             // Noise generator seed
+    };
+    
+    // Stationary near Utrecht at 1 Hz, adjust from there
+    static Settings defaultSettings();
+    
+    SyntheticGPSSource(const Settings& settings);
+    
+    size_t read(uint8_t* buffer, size_t cap) override;
+    
+    // Noise free position of the current epoch, for comparing against the parser
+    int32_t getTrueLatitudeE7() const { return trueLatitudeE7; }
+    int32_t getTrueLongitudeE7() const { return trueLongitudeE7; }
+    uint32_t getEpochs() const { return epoch; }
+
+private:
+    Settings settings;
+    Waypoint route[GPS_SYNTHETIC_MAX_WAYPOINTS];
+    float segmentLength[GPS_SYNTHETIC_MAX_WAYPOINTS];  // m, from each waypoint to the next
+    float routeLength = 0;
+    
+    uint32_t epoch = 0;
+    uint32_t noiseState;
+    int32_t trueLatitudeE7 = 0;
+    int32_t trueLongitudeE7 = 0;
+    
+    char epochText[GPS_SYNTHETIC_EPOCH_SIZE];
+    size_t epochLength = 0;
+    size_t epochOffset = 0;
+    
+    uint32_t epochTime(uint32_t index) const;
+    void generateEpoch();
+    float gaussian();
+    size_t appendSentence(size_t length, const char* format, ...);
+    static size_t formatCoordinate(char* out, size_t cap, int32_t valueE7, bool latitude);
+};
+
+#endif // GPS_SOURCE_H
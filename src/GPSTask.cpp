@@ -0,0 +1,63 @@
+#include "GPSTask.h"
+
+GPSTask::GPSTask(GPSParser& parser, GPSSource* source) : parser(parser), source(source), lastSequence(0) {
+#ifdef ARDUINO_ARCH_ESP32
+    handle = nullptr;
+#endif
+}
+
+bool GPSTask::begin(uint8_t core) {
+#ifdef ARDUINO_ARCH_ESP32
+    if (handle != nullptr) {
+        return true;
+    }
+    return xTaskCreatePinnedToCore(run, "gps", GPS_TASK_STACK_SIZE, this, GPS_TASK_PRIORITY, &handle, core) == pdPASS;
+#else
+    (void)core;
+    return false;
+#endif
+}
+
+#ifdef ARDUINO_ARCH_ESP32
+void GPSTask::run(void* task) {
+    GPSTask* self = (GPSTask*)task;
+    TickType_t wake = xTaskGetTickCount();
+    for (;;) {
+        self->poll();
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(GPS_TASK_INTERVAL));
+    }
+}
+#endif
+
+void GPSTask::poll() {
+    uint8_t block[256];
+    size_t count;
+    while ((count = source->read(block, sizeof(block))) > 0) {
+        uint32_t received = source->receivedMicros();
+        raw.push(block, count);
+        
+        // The parser only keeps the latest fix, so look for one after every
+        // slice that is too short to complete two epochs
+        for (size_t offset = 0; offset < count; offset += GPS_TASK_SLICE) {
+            size_t length = min(count - offset, (size_t)GPS_TASK_SLICE);
+            parser.processGPSData(block + offset, length, received);
+            
+            uint32_t sequence = parser.getFixSequence();
+            if (sequence != lastSequence) {
+                lastSequence = sequence;
+                GPSParser::Fix fix;
+                parser.getFix(fix);
+                fixes.push(fix);
+            }
+        }
+    }
+}
+
+GPSTask::Stats GPSTask::getStats() const {
+    Stats stats;
+    stats.fixesDropped = fixes.getDropped();
+    stats.fixesHighWater = fixes.getHighWater();
+    stats.rawDropped = raw.getDropped();
+    stats.rawHighWater = raw.getHighWater();
+    return stats;
+}
@@ -0,0 +1,68 @@
+#ifndef GPS_TASK_H
+#define GPS_TASK_H
+
+#include <Arduino.h>
+#include "GPSParser.h"
+#include "GPSSource.h"
+#include "SPSCRing.h"
+
+// Queues to the main loop, powers of two
+#define GPS_TASK_FIX_QUEUE 16      // Fixes, several seconds at 1-5 Hz
+#define GPS_TASK_RAW_QUEUE 4096    // Raw bytes for the NMEA upload
+
+// FreeRTOS task. The Arduino loop runs on core 1, so the GPS gets core 0 to
+// itself apart from the WiFi stack, which has a higher priority.
+#define GPS_TASK_CORE 0
+#define GPS_TASK_PRIORITY 3
+#define GPS_TASK_STACK_SIZE 4096
+#define GPS_TASK_INTERVAL 2        // ms between polls, 23 bytes at 115200 baud
+#define GPS_TASK_SLICE 64          // Bytes parsed between checks for a new fix, less than an epoch
+
+// Reads the GPS source and parses it in a task of its own, so that a
+// blocking HTTP post or a screen redraw in the loop no longer delays the
+// input. Every published fix and all raw bytes are queued for the loop
+// through lock-free rings. The parser's getters (getFix(), the satellite
+// table) remain safe to call from the loop.
+class GPSTask {
+public:
+    GPSTask(GPSParser& parser, GPSSource* source);
+    
+    // Switch sources before begin()
+    void setSource(GPSSource* newSource) { source = newSource; }
+    
+    // Start the task pinned to a core. Where there is no FreeRTOS (the
+    // host build) it returns false and the caller runs poll() itself.
+    bool begin(uint8_t core = GPS_TASK_CORE);
+    
+    // Read everything the source has, parse it and queue fixes and bytes
+    void poll();
+    
+    // Consumer side, from one other task
+    bool readFix(GPSParser::Fix& fix) { return fixes.pop(fix); }
+    size_t readRaw(uint8_t* buffer, size_t cap) { return raw.pop(buffer, cap); }
+    
+    // Queue overflow statistics
+    struct Stats {
+        uint32_t fixesDropped;    // Fixes the loop did not collect in time
+        uint32_t fixesHighWater;  // Most fixes waiting at once
+        uint32_t rawDropped;      // Bytes lost to the NMEA upload
+        uint32_t rawHighWater;
+    };
+    
+    Stats getStats() const;
+
+private:
+    GPSParser& parser;
+    GPSSource* source;
+    uint32_t lastSequence;
+    
+    SPSCRing<GPSParser::Fix, GPS_TASK_FIX_QUEUE> fixes;
+    SPSCRing<uint8_t, GPS_TASK_RAW_QUEUE> raw;
+
+#ifdef ARDUINO_ARCH_ESP32
+    TaskHandle_t handle;
+    static void run(void* task);
+#endif
+};
+
+#endif // GPS_TASK_H
@@ -0,0 +1,14 @@
+#include "GPSTime.h"
+
+void gpsCivilFromDays(int32_t days, int32_t& year, uint8_t& month, uint8_t& day) {
+    // Count in 400 year eras starting on 0000-03-01, so the leap day ends a year
+    int32_t shifted = days + 719468;
+    int32_t era = (shifted >= 0 ? shifted : shifted - 146096) / 146097;
+    uint32_t dayOfEra = shifted - era * 146097;
+    uint32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    uint32_t monthIndex = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    month = (monthIndex < 10) ? monthIndex + 3 : monthIndex - 9;
+    year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+}
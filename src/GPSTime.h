@@ -0,0 +1,41 @@
+#ifndef GPS_TIME_H
+#define GPS_TIME_H
+
+#include <Arduino.h>
+
+// Calendar arithmetic for GPS time stamps: days since 1970-01-01 in the
+// Gregorian calendar and Unix time in milliseconds, integer only. The
+// conversions to days are constexpr so that fixed dates fold at compile time.
+
+#define GPS_MS_PER_DAY 86400000
+
+// Days before the first of each month in a non-leap year
+constexpr uint16_t gpsDaysBeforeMonth[12] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+
+constexpr bool gpsIsLeapYear(int32_t year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+// Leap days from 1970 up to the start of year (year >= 1)
+constexpr int32_t gpsLeapDaysSince1970(int32_t year) {
+    return (year - 1) / 4 - (year - 1) / 100 + (year - 1) / 400 - 477;
+}
+
+// Days since 1970-01-01 of a valid calendar date, month and day from 1
+constexpr int32_t gpsDaysFromCivil(int32_t year, uint8_t month, uint8_t day) {
+    return (year - 1970) * 365 + gpsLeapDaysSince1970(year) + gpsDaysBeforeMonth[month - 1] +
+           ((month > 2 && gpsIsLeapYear(year)) ? 1 : 0) + day - 1;
+}
+
+constexpr int64_t gpsUnixMillis(int32_t days, uint32_t timeOfDay) {
+    return (int64_t)days * GPS_MS_PER_DAY + timeOfDay;
+}
+
+static_assert(gpsDaysFromCivil(1970, 1, 1) == 0, "Epoch");
+static_assert(gpsDaysFromCivil(2000, 3, 1) == 11017, "Leap year 2000");
+static_assert(gpsDaysFromCivil(2100, 3, 1) == 47541, "No leap year 2100");
+
+// Calendar date of days since 1970-01-01
+void gpsCivilFromDays(int32_t days, int32_t& year, uint8_t& month, uint8_t& day);
+
+#endif // GPS_TIME_H
@@ -0,0 +1,229 @@
+#include "HTTPConnection.h"
+#include <strings.h>
+
+HTTPConnection::HTTPConnection(Client& client, const char* host, uint16_t port, const char* path, const char* contentType) :
+    client(client),
+    host(host),
+    port(port),
+    headerLength(0),
+    requests(0),
+    connects(0) {
+    int length = snprintf(header, sizeof(header),
+                          "POST %s HTTP/1.1\r\n"
+                          "Host: %s:%u\r\n"
+                          "Content-Type: %s\r\n"
+                          "Connection: keep-alive\r\n"
+                          "Content-Length: ",
+                          path, host, (unsigned)port, contentType);
+    if (length > 0 && (size_t)length < sizeof(header)) {
+        headerLength = length;
+    }
+}
+
+bool HTTPConnection::connect() {
+    if (client.connected()) {
+        return true;
+    }
+    // Anything left of the last connection goes
+    client.stop();
+    if (!client.connect(host.c_str(), port)) {
+        return false;
+    }
+    connects++;
+    return true;
+}
+
+void HTTPConnection::close() {
+    client.stop();
+}
+
+int HTTPConnection::post(const uint8_t* body, size_t length) {
+    if (headerLength == 0) {
+        return ERROR_HEADER;
+    }
+    bool reused = client.connected();
+    if (!reused && !connect()) {
+        return ERROR_CONNECT;
+    }
+    requests++;
+    
+    int status = send(body, length);
+    if (reused && (status == ERROR_WRITE || status == ERROR_CLOSED)) {
+        // The server closed the connection while it was idle, it never saw the request
+        close();
+        if (!connect()) {
+            return ERROR_CONNECT;
+        }
+        status = send(body, length);
+    }
+    if (status < 0) {
+        close();
+    }
+    return status;
+}
+
+int HTTPConnection::send(const uint8_t* body, size_t length) {
+    // Headers and as much of the body as fits in one write, so that the
+    // server does not wait for the body behind a delayed ACK
+    memcpy(buffer, header, headerLength);
+    size_t used = headerLength;
+    used += snprintf((char*)buffer + used, sizeof(buffer) - used, "%u\r\n\r\n", (unsigned)length);
+    size_t first = min(length, sizeof(buffer) - used);
+    memcpy(buffer + used, body, first);
+    used += first;
+    
+    if (client.write(buffer, used) != used) {
+        return ERROR_WRITE;
+    }
+    if (first < length && client.write(body + first, length - first) != length - first) {
+        return ERROR_WRITE;
+    }
+    return readResponse();
+}
+
+int HTTPConnection::readResponse() {
+    unsigned long start = millis();
+    char line[HTTP_CONNECTION_LINE_SIZE];
+    
+    // Status line, "HTTP/1.1 200 OK"
+    int length = readLine(line, sizeof(line), start);
+    if (length < 0) {
+        return length;
+    }
+    unsigned minor;
+    int status;
+    if (sscanf(line, "HTTP/1.%u %d", &minor, &status) != 2) {
+        return ERROR_RESPONSE;
+    }
+    
+    // HTTP/1.0 servers close after the response unless they say otherwise
+    bool keepAlive = minor >= 1;
+    bool chunked = false;
+    long contentLength = -1;
+    while ((length = readLine(line, sizeof(line), start)) > 0) {
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            contentLength = atol(line + 15);
+        }
+        else if (strncasecmp(line, "Connection:", 11) == 0) {
+            if (strcasestr(line + 11, "close") != nullptr) {
+                keepAlive = false;
+            }
+            else if (strcasestr(line + 11, "keep-alive") != nullptr) {
+                keepAlive = true;
+            }
+        }
+        else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+            chunked = strcasestr(line + 18, "chunked") != nullptr;
+        }
+    }
+    if (length < 0) {
+        return length == ERROR_CLOSED ? ERROR_RESPONSE : length;
+    }
+    
+    // Skip the body, the logger has no use for it
+    int result = 0;
+    if (status < 200 || status == 204 || status == 304) {
+        // No body
+    }
+    else if (chunked) {
+        while (result == 0) {
+            length = readLine(line, sizeof(line), start);
+            if (length < 0) {
+                result = length;
+                break;
+            }
+            uint32_t size = strtoul(line, nullptr, 16);
+            if (size == 0) {
+                // Trailers up to the empty line
+                while ((length = readLine(line, sizeof(line), start)) > 0) {
+                }
+                result = min(length, 0);
+                break;
+            }
+            result = skip(size, start);
+            if (result == 0) {
+                result = min(readLine(line, sizeof(line), start), 0);
+            }
+        }
+    }
+    else if (contentLength >= 0) {
+        result = skip(contentLength, start);
+    }
+    else {
+        // The body ends when the server closes the connection
+        keepAlive = false;
+        result = skip(UINT32_MAX, start);
+        if (result == ERROR_CLOSED) {
+            result = 0;
+        }
+    }
+    
+    if (result < 0) {
+        return result == ERROR_CLOSED ? ERROR_RESPONSE : result;
+    }
+    if (!keepAlive) {
+        close();
+    }
+    return status;
+}
+
+int HTTPConnection::readByte(unsigned long start) {
+    uint32_t waiting = micros();
+    while (client.available() <= 0) {
+        if (!client.connected()) {
+            return ERROR_CLOSED;
+        }
+        if (millis() - start > HTTP_CONNECTION_TIMEOUT) {
+            return ERROR_TIMEOUT;
+        }
+        // A server nearby answers within a tick, sleeping a whole one would double the request time
+        if (micros() - waiting < HTTP_CONNECTION_SPIN) {
+            yield();
+        }
+        else {
+            delay(1);
+        }
+    }
+    return client.read();
+}
+
+int HTTPConnection::readLine(char* line, size_t cap, unsigned long start) {
+    // Up to the newline without the line end, cut to what fits
+    size_t length = 0;
+    while (true) {
+        int c = readByte(start);
+        if (c < 0) {
+            return c;
+        }
+        if (c == '\n') {
+            break;
+        }
+        if (c != '\r' && length + 1 < cap) {
+            line[length++] = (char)c;
+        }
+    }
+    line[length] = '\0';
+    return length;
+}
+
+int HTTPConnection::skip(uint32_t length, unsigned long start) {
+    while (length > 0) {
+        int available = client.available();
+        if (available <= 0) {
+            // Waits, or tells why there is nothing more
+            int c = readByte(start);
+            if (c < 0) {
+                return c;
+            }
+            length--;
+            continue;
+        }
+        size_t count = min((size_t)available, (size_t)min(length, (uint32_t)sizeof(buffer)));
+        int received = client.read(buffer, count);
+        if (received <= 0) {
+            return ERROR_CLOSED;
+        }
+        length -= received;
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+#ifndef HTTP_CONNECTION_H
+#define HTTP_CONNECTION_H
+
+#include <Arduino.h>
+#include <Client.h>
+
+#define HTTP_CONNECTION_HEADER_SIZE 256   // Request line and headers, built once
+#define HTTP_CONNECTION_BUFFER_SIZE 1460  // One TCP segment: the headers and the start of the body
+#define HTTP_CONNECTION_LINE_SIZE 128     // Response header lines are cut to this length
+#define HTTP_CONNECTION_TIMEOUT 5000      // ms to wait for the response
+#define HTTP_CONNECTION_SPIN 1000         // µs to poll for the response before sleeping between polls
+
+// HTTP/1.1 POST requests to one endpoint over a connection that stays open
+// between requests. The request line and headers are built once, so a request
+// is one write for the headers and the body, then a read of the response.
+//
+// Works over any Arduino Client: WiFiClient on the ESP32, a socket on the host.
+class HTTPConnection {
+public:
+    enum Error {
+        ERROR_CONNECT = -1,   // The server could not be reached
+        ERROR_WRITE = -2,     // The request could not be sent completely
+        ERROR_CLOSED = -3,    // The server closed the connection before answering
+        ERROR_TIMEOUT = -4,   // No complete response in time
+        ERROR_RESPONSE = -5,  // Not an HTTP response
+        ERROR_HEADER = -6     // The request line and headers did not fit
+    };
+    
+    HTTPConnection(Client& client, const char* host, uint16_t port, const char* path, const char* contentType);
+    
+    // Open the connection unless it is open, true if it is then
+    bool connect();
+    bool isConnected() { return client.connected(); }
+    void close();
+    
+    // Send a request, returning the status code or a negative Error. One
+    // that fails because the server had closed the idle connection is
+    // repeated once on a new connection.
+    int post(const uint8_t* body, size_t length);
+    
+    // Statistics
+    uint32_t getRequests() const { return requests; }
+    uint32_t getConnects() const { return connects; }
+
+private:
+    Client& client;
+    String host;
+    uint16_t port;
+    
+    // Up to and including "Content-Length: "
+    char header[HTTP_CONNECTION_HEADER_SIZE];
+    size_t headerLength;
+    
+    uint8_t buffer[HTTP_CONNECTION_BUFFER_SIZE];
+    
+    uint32_t requests;
+    uint32_t connects;
+    
+    int send(const uint8_t* body, size_t length);
+    int readResponse();
+    int readByte(unsigned long start);
+    int readLine(char* line, size_t cap, unsigned long start);
+    int skip(uint32_t length, unsigned long start);
+};
+
+#endif // HTTP_CONNECTION_H
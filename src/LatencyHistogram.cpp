@@ -0,0 +1,46 @@
+#include "LatencyHistogram.h"
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::add(uint32_t micros) {
+    // The bucket is the bit length of the value
+    uint8_t index = (micros == 0) ? 0 : 32 - __builtin_clz(micros);
+    if (index >= LATENCY_BUCKETS) {
+        index = LATENCY_BUCKETS - 1;
+    }
+    buckets[index]++;
+    count++;
+    if (micros > maximum) {
+        maximum = micros;
+    }
+}
+
+void LatencyHistogram::reset() {
+    memset(buckets, 0, sizeof(buckets));
+    count = 0;
+    maximum = 0;
+}
+
+uint32_t LatencyHistogram::percentile(uint8_t percent) const {
+    if (count == 0) {
+        return 0;
+    }
+    
+    // Rank of the value, rounded up so that p100 is the last one
+    uint32_t rank = ((uint64_t)count * min(percent, (uint8_t)100) + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < LATENCY_BUCKETS - 1; i++) {
+        seen += buckets[i];
+        if (seen >= max(rank, (uint32_t)1)) {
+            return min((uint32_t)1 << i, maximum);
+        }
+    }
+    return maximum;
+}
+
+size_t LatencyHistogram::format(char* out, size_t cap) const {
+    return snprintf(out, cap, "%.1f / %.1f / %.1f ms", percentile(50) * 0.001f, percentile(99) * 0.001f,
+                    maximum * 0.001f);
+}
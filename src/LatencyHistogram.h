@@ -0,0 +1,37 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <Arduino.h>
+
+// Buckets of powers of two in microseconds: bucket 0 holds 0 µs, bucket n
+// holds [2^(n-1), 2^n) µs and the last one everything from about 4.2 s up
+#define LATENCY_BUCKETS 24
+
+// Distribution of latencies in fixed memory, adding one is a few instructions.
+// Written by one task, other tasks may read it (a count can lag by one).
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+    
+    void add(uint32_t micros);
+    void reset();
+    
+    uint32_t getCount() const { return count; }
+    uint32_t getMax() const { return maximum; }
+    uint32_t getBucket(uint8_t index) const { return buckets[index]; }
+    
+    // Upper bound of the bucket holding the given percentile (0-100), at most
+    // the maximum: a value no more than twice too high. 0 when empty.
+    uint32_t percentile(uint8_t percent) const;
+    
+    // Median, 99th percentile and maximum as "1.0 / 16.4 / 20.1 ms",
+    // returns the length like snprintf
+    size_t format(char* out, size_t cap) const;
+
+private:
+    uint32_t buckets[LATENCY_BUCKETS];
+    uint32_t count;
+    uint32_t maximum;
+};
+
+#endif // LATENCY_HISTOGRAM_H
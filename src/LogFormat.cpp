@@ -0,0 +1,73 @@
+#include "LogFormat.h"
+
+size_t jsonEscape(char* out, size_t cap, const char* text) {
+    static const char hexDigits[] = "0123456789abcdef";
+    size_t length = 0;
+    
+    for (const char* p = text; *p != '\0'; p++) {
+        char c = *p;
+        char escaped[6];
+        size_t n;
+        
+        if (c == '"' || c == '\\') {
+            escaped[0] = '\\';
+            escaped[1] = c;
+            n = 2;
+        }
+        else if (c == '\n' || c == '\r' || c == '\t') {
+            escaped[0] = '\\';
+            escaped[1] = (c == '\n') ? 'n' : (c == '\r') ? 'r' : 't';
+            n = 2;
+        }
+        else if ((uint8_t)c < 0x20) {
+            escaped[0] = '\\';
+            escaped[1] = 'u';
+            escaped[2] = '0';
+            escaped[3] = '0';
+            escaped[4] = hexDigits[(uint8_t)c >> 4];
+            escaped[5] = hexDigits[c & 0x0F];
+            n = 6;
+        }
+        else {
+            // Everything else, UTF-8 included, goes through unchanged
+            escaped[0] = c;
+            n = 1;
+        }
+        
+        if (length + n > cap) {
+            break;
+        }
+        memcpy(out + length, escaped, n);
+        length += n;
+    }
+    
+    return length;
+}
+
+size_t formatLogRecord(char* out, size_t cap, const char* device, uint64_t timestamp,
+                       const char* level, const char* message) {
+    // Everything up to the message, then the message in whatever room is left
+    // before the closing quote, brace and terminator
+    int head = snprintf(out, cap, "{\"device\":\"");
+    if (head < 0 || (size_t)head >= cap) {
+        return 0;
+    }
+    size_t length = head;
+    length += jsonEscape(out + length, cap - length, device);
+    
+    int middle = snprintf(out + length, cap - length, "\",\"timestamp\":%llu,\"level\":\"%s\",\"message\":\"",
+                          (unsigned long long)timestamp, level);
+    if (middle < 0 || length + middle + 3 > cap) {
+        if (cap > 0) {
+            out[0] = '\0';
+        }
+        return 0;
+    }
+    length += middle;
+    
+    length += jsonEscape(out + length, cap - length - 3, message);
+    out[length++] = '"';
+    out[length++] = '}';
+    out[length] = '\0';
+    return length;
+}
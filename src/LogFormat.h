@@ -0,0 +1,25 @@
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include <Arduino.h>
+
+// Payload formatting for the logger, kept apart from the network code so it
+// builds and runs on the host as well.
+
+#define LOG_RECORD_MAX_LENGTH 512
+
+// Escape text for use inside a JSON string. Writes as much as fits in cap
+// bytes (never splitting an escape sequence) and returns the bytes written.
+// The output is not terminated.
+size_t jsonEscape(char* out, size_t cap, const char* text);
+
+// One log record as a JSON object:
+// {"device":"...","timestamp":1710497712000,"level":"INFO","message":"..."}
+// The timestamp is Unix time in ms, or the uptime in ms while the clock is
+// not synchronized yet (values below 1e12). The message is shortened if the
+// record would not fit, so out always holds complete, terminated JSON.
+// Returns its length, 0 if not even an empty message fits.
+size_t formatLogRecord(char* out, size_t cap, const char* device, uint64_t timestamp,
+                       const char* level, const char* message);
+
+#endif // LOG_FORMAT_H
@@ -0,0 +1,97 @@
+#ifndef MPMC_RING_H
+#define MPMC_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Fixed-size queue for any number of producer and consumer tasks, without
+// locks (D. Vyukov's bounded queue). Each slot carries a sequence number that
+// says whose turn it is, so a producer may also take the oldest item out to
+// make room while a consumer is busy with another one.
+//
+// Costs a compare-and-swap per operation more than SPSCRing, use that one
+// where there is only one task on each side.
+template <typename T, uint32_t Capacity>
+class MPMCRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    MPMCRing() : head(0), tail(0) {
+        for (uint32_t i = 0; i < Capacity; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    
+    // False if the ring is full
+    bool push(const T& item) {
+        uint32_t position = head.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots[position & (Capacity - 1)];
+            int32_t difference = (int32_t)(slot->sequence.load(std::memory_order_acquire) - position);
+            if (difference == 0) {
+                // The slot is free, claim it
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (difference < 0) {
+                return false;
+            }
+            else {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+        slot->item = item;
+        slot->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // False if the ring is empty
+    bool pop(T& item) {
+        uint32_t position = tail.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots[position & (Capacity - 1)];
+            int32_t difference = (int32_t)(slot->sequence.load(std::memory_order_acquire) - (position + 1));
+            if (difference == 0) {
+                // The slot is filled, claim it
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (difference < 0) {
+                return false;
+            }
+            else {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+        item = slot->item;
+        slot->sequence.store(position + Capacity, std::memory_order_release);
+        return true;
+    }
+    
+    // A snapshot that may be outdated by the time it is used
+    uint32_t size() const {
+        uint32_t read = tail.load(std::memory_order_acquire);
+        uint32_t write = head.load(std::memory_order_acquire);
+        return (int32_t)(write - read) > 0 ? write - read : 0;
+    }
+    static uint32_t capacity() { return Capacity; }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        T item;
+    };
+    
+    Slot slots[Capacity];
+    
+    // Free running counters of claimed slots, the index is their low bits
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+};
+
+#endif // MPMC_RING_H
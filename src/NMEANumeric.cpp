@@ -0,0 +1,221 @@
+#include "NMEANumeric.h"
+#include "GPSTime.h"
+
+static bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// value = value * 10 + digit, false if the result would not fit an int32
+static bool appendDigit(uint32_t& value, uint8_t digit) {
+    if (value > (0x7FFFFFFFUL - digit) / 10) {
+        return false;
+    }
+    value = value * 10 + digit;
+    return true;
+}
+
+// Two digit number at text, false if either is not a digit
+static bool readTwoDigits(const char* text, uint8_t& value) {
+    if (!isDigit(text[0]) || !isDigit(text[1])) {
+        return false;
+    }
+    value = (text[0] - '0') * 10 + (text[1] - '0');
+    return true;
+}
+
+NMEAFieldStatus nmeaParseFixed(const char* text, uint8_t decimals, int32_t& value) {
+    const char* p = text;
+    if (*p == '\0') {
+        return NMEA_FIELD_EMPTY;
+    }
+    
+    bool negative = (*p == '-');
+    if (*p == '-' || *p == '+') {
+        p++;
+    }
+    
+    uint32_t result = 0;
+    uint8_t digits = 0;
+    for (; isDigit(*p); p++, digits++) {
+        if (!appendDigit(result, *p - '0')) {
+            return NMEA_FIELD_INVALID;
+        }
+    }
+    
+    // Fraction: keep the requested digits, round on the first dropped one
+    uint8_t fractionDigits = 0;
+    bool roundUp = false;
+    if (*p == '.') {
+        for (p++; isDigit(*p); p++, digits++) {
+            if (fractionDigits < decimals) {
+                if (!appendDigit(result, *p - '0')) {
+                    return NMEA_FIELD_INVALID;
+                }
+                fractionDigits++;
+            }
+            else if (fractionDigits == decimals) {
+                roundUp = (*p >= '5');
+                fractionDigits++;
+            }
+        }
+    }
+    
+    if (digits == 0 || *p != '\0') {
+        return NMEA_FIELD_INVALID;
+    }
+    
+    for (; fractionDigits < decimals; fractionDigits++) {
+        if (!appendDigit(result, 0)) {
+            return NMEA_FIELD_INVALID;
+        }
+    }
+    if (roundUp) {
+        if (result == 0x7FFFFFFFUL) {
+            return NMEA_FIELD_INVALID;
+        }
+        result++;
+    }
+    
+    value = negative ? -(int32_t)result : (int32_t)result;
+    return NMEA_FIELD_OK;
+}
+
+NMEAFieldStatus nmeaParseInt(const char* text, int32_t& value) {
+    return nmeaParseFixed(text, 0, value);
+}
+
+NMEAFieldStatus nmeaParseTime(const char* text, uint32_t& milliseconds) {
+    if (text[0] == '\0') {
+        return NMEA_FIELD_EMPTY;
+    }
+    
+    uint8_t hours, minutes, seconds;
+    if (!readTwoDigits(&text[0], hours) || !readTwoDigits(&text[2], minutes) || !readTwoDigits(&text[4], seconds)) {
+        return NMEA_FIELD_INVALID;
+    }
+    if (hours > 23 || minutes > 59 || seconds > 60) {
+        return NMEA_FIELD_INVALID;
+    }
+    
+    // Optional fraction of a second, scaled to milliseconds
+    const char* p = &text[6];
+    uint16_t fraction = 0;
+    if (*p == '.') {
+        uint16_t scale = 100;
+        for (p++; isDigit(*p); p++) {
+            fraction += (*p - '0') * scale;
+            scale /= 10;
+        }
+    }
+    if (*p != '\0') {
+        return NMEA_FIELD_INVALID;
+    }
+    
+    milliseconds = ((uint32_t)hours * 3600 + minutes * 60 + seconds) * 1000 + fraction;
+    return NMEA_FIELD_OK;
+}
+
+NMEAFieldStatus nmeaParseDate(const char* text, int32_t& days) {
+    static const uint8_t daysInMonth[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    
+    if (text[0] == '\0') {
+        return NMEA_FIELD_EMPTY;
+    }
+    
+    uint8_t day, month, year;
+    if (!readTwoDigits(&text[0], day) || !readTwoDigits(&text[2], month) || !readTwoDigits(&text[4], year) ||
+        text[6] != '\0') {
+        return NMEA_FIELD_INVALID;
+    }
+    
+    int32_t fullYear = (year >= 80) ? 1900 + year : 2000 + year;
+    bool leap = gpsIsLeapYear(fullYear);
+    if (month < 1 || month > 12 || day < 1 || day > daysInMonth[month - 1] + (month == 2 && leap ? 1 : 0)) {
+        return NMEA_FIELD_INVALID;
+    }
+    
+    days = gpsDaysFromCivil(fullYear, month, day);
+    return NMEA_FIELD_OK;
+}
+
+NMEAFieldStatus nmeaParseCoordinate(const char* text, char hemisphere, int32_t& valueE7) {
+    if (text[0] == '\0') {
+        return NMEA_FIELD_EMPTY;
+    }
+    
+    int32_t maxDegrees;
+    switch (hemisphere) {
+        case 'N': case 'S': maxDegrees = 90; break;
+        case 'E': case 'W': maxDegrees = 180; break;
+        default: return NMEA_FIELD_INVALID;
+    }
+    
+    // Two minute digits precede the decimal point, up to three degree digits before them
+    const char* decimalPoint = strchr(text, '.');
+    if (decimalPoint == nullptr) {
+        decimalPoint = text + strlen(text);
+    }
+    if (decimalPoint - text < 2 || decimalPoint - text > 5) {
+        return NMEA_FIELD_INVALID;
+    }
+    
+    int32_t degrees = 0;
+    const char* p = text;
+    for (; p < decimalPoint - 2; p++) {
+        if (!isDigit(*p)) {
+            return NMEA_FIELD_INVALID;
+        }
+        degrees = degrees * 10 + (*p - '0');
+    }
+    if (degrees > maxDegrees) {
+        return NMEA_FIELD_INVALID;
+    }
+    
+    uint8_t wholeMinutes;
+    if (!readTwoDigits(p, wholeMinutes) || wholeMinutes > 59) {
+        return NMEA_FIELD_INVALID;
+    }
+    p = decimalPoint;
+    
+    // Minutes in units of 1e-7 minute, digits beyond that are dropped
+    int32_t minutes = wholeMinutes;
+    if (*p == '.') {
+        p++;
+    }
+    for (uint8_t i = 0; i < 7; i++) {
+        minutes *= 10;
+        if (isDigit(*p)) {
+            minutes += *p++ - '0';
+        }
+    }
+    while (isDigit(*p)) {
+        p++;
+    }
+    if (*p != '\0') {
+        return NMEA_FIELD_INVALID;
+    }
+    
+    // Convert to 1e-7 degrees, rounding to nearest
+    int32_t value = degrees * 10000000 + (minutes + 30) / 60;
+    if (value > maxDegrees * 10000000) {
+        return NMEA_FIELD_INVALID;
+    }
+    
+    valueE7 = (hemisphere == 'S' || hemisphere == 'W') ? -value : value;
+    return NMEA_FIELD_OK;
+}
+
+int8_t nmeaHexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+uint8_t nmeaChecksum(const char* begin, const char* end) {
+    uint8_t checksum = 0;
+    for (const char* p = begin; p < end; p++) {
+        checksum ^= (uint8_t)*p;
+    }
+    return checksum;
+}
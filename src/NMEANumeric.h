@@ -0,0 +1,43 @@
+#ifndef NMEA_NUMERIC_H
+#define NMEA_NUMERIC_H
+
+#include <Arduino.h>
+
+// Parsers for the numeric fields of NMEA sentences. They read a field in
+// place from the tokenized sentence buffer, use integer arithmetic only and
+// accept exactly the fixed formats NMEA uses: no exponents, no whitespace,
+// no locale. The result is only written when the field is valid.
+
+enum NMEAFieldStatus : uint8_t {
+    NMEA_FIELD_OK = 0,
+    NMEA_FIELD_EMPTY,    // Field present but without a value, the receiver has none
+    NMEA_FIELD_INVALID   // Malformed or out of range
+};
+
+// Decimal number scaled by 10^decimals, e.g. "-12.3456" with 2 decimals is -1235.
+// Extra fraction digits are rounded half away from zero. Values beyond int32 are invalid.
+NMEAFieldStatus nmeaParseFixed(const char* text, uint8_t decimals, int32_t& value);
+
+// Integer field, a fraction is rounded like nmeaParseFixed with 0 decimals
+NMEAFieldStatus nmeaParseInt(const char* text, int32_t& value);
+
+// UTC time of day hhmmss[.sss] to milliseconds since midnight, fraction digits
+// beyond milliseconds are dropped. Allows second 60 for leap seconds.
+NMEAFieldStatus nmeaParseTime(const char* text, uint32_t& milliseconds);
+
+// Date ddmmyy to days since 1970-01-01. Two digit years 80-99 are 1980-1999,
+// 00-79 are 2000-2079.
+NMEAFieldStatus nmeaParseDate(const char* text, int32_t& days);
+
+// Coordinate DDMM.MMMM or DDDMM.MMMM with its hemisphere field to 1e-7 degrees,
+// negative for S and W. Latitudes beyond 90 and longitudes beyond 180 degrees are invalid.
+NMEAFieldStatus nmeaParseCoordinate(const char* text, char hemisphere, int32_t& valueE7);
+
+// Value of a checksum digit, upper or lower case hex, -1 for anything else
+int8_t nmeaHexValue(char c);
+
+// Sentence checksum: XOR of the characters from begin up to end, the text
+// between '$' and '*'
+uint8_t nmeaChecksum(const char* begin, const char* end);
+
+#endif // NMEA_NUMERIC_H
@@ -0,0 +1,231 @@
+#include "NMEAStream.h"
+#include <errno.h>
+#include <fcntl.h>
+#ifdef ARDUINO_ARCH_ESP32
+#include <lwip/sockets.h>
+#include <lwip/netdb.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+NMEAStream::NMEAStream(const String& server, uint16_t port) :
+    server(server),
+    port(port),
+    lineLength(0),
+    socketFd(-1),
+    state(IDLE),
+    connectStarted(0),
+    lastConnectAttempt(0),
+    outgoingLength(0),
+    outgoingOffset(0),
+    lineOpen(false),
+    skipBytes(0),
+    lines(0),
+    droppedLines(0),
+    droppedBytes(0),
+    cutBytes(0),
+    written(0),
+    connects(0),
+    disconnects(0) {
+}
+
+NMEAStream::~NMEAStream() {
+    close();
+}
+
+void NMEAStream::write(const uint8_t* data, size_t length) {
+    while (length > 0) {
+        // Up to the line end, or as much as the line holds
+        size_t count = min(length, sizeof(line) - lineLength);
+        const uint8_t* end = (const uint8_t*)memchr(data, '\n', count);
+        if (end != nullptr) {
+            count = end - data + 1;
+        }
+        memcpy(line + lineLength, data, count);
+        lineLength += count;
+        data += count;
+        length -= count;
+        
+        if (end != nullptr || lineLength == sizeof(line)) {
+            commitLine();
+        }
+    }
+}
+
+void NMEAStream::commitLine() {
+    // Whole or not at all, a line cut short would run into the next one
+    if (buffer.capacity() - buffer.size() >= lineLength) {
+        buffer.push(line, lineLength);
+        lines++;
+    }
+    else {
+        droppedLines++;
+        droppedBytes += lineLength;
+    }
+    lineLength = 0;
+}
+
+void NMEAStream::process() {
+    if (state == IDLE && !startConnect()) {
+        return;
+    }
+    if (state == CONNECTING && !finishConnect()) {
+        return;
+    }
+    
+    while (outgoingOffset < outgoingLength || fillOutgoing()) {
+        ssize_t count = send(socketFd, outgoing + outgoingOffset, outgoingLength - outgoingOffset,
+                             MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            disconnects++;
+            close();
+            return;
+        }
+        if (count <= 0) {
+            // The socket buffer is full, the rest waits for the server to catch up
+            return;
+        }
+        outgoingOffset += count;
+        written += count;
+        lineOpen = outgoing[outgoingOffset - 1] != '\n';
+    }
+}
+
+bool NMEAStream::startConnect() {
+    // While the server is unreachable try once per interval only
+    if (lastConnectAttempt != 0 && millis() - lastConnectAttempt < NMEA_STREAM_RECONNECT_INTERVAL) {
+        return false;
+    }
+    lastConnectAttempt = max(millis(), 1UL);
+    
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, server.c_str(), &address.sin_addr) != 1) {
+        // A host name, the lookup is the one step that may wait
+        addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* result = nullptr;
+        if (getaddrinfo(server.c_str(), nullptr, &hints, &result) != 0 || result == nullptr) {
+            return false;
+        }
+        address.sin_addr = ((sockaddr_in*)result->ai_addr)->sin_addr;
+        freeaddrinfo(result);
+    }
+    
+    socketFd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (socketFd < 0) {
+        return false;
+    }
+    fcntl(socketFd, F_SETFL, fcntl(socketFd, F_GETFL, 0) | O_NONBLOCK);
+    
+    // Each write is what has collected since the last one, no reason to hold it back
+    int on = 1;
+    setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    
+    // Data the server is behind on waits in our buffer, where it is dropped in
+    // whole lines, not in megabytes of host socket buffer. lwIP ignores this,
+    // its buffer is this small already.
+    int size = NMEA_STREAM_SOCKET_BUFFER;
+    setsockopt(socketFd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    
+    state = CONNECTING;
+    connectStarted = millis();
+    if (connect(socketFd, (sockaddr*)&address, sizeof(address)) != 0 && errno != EINPROGRESS) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool NMEAStream::finishConnect() {
+    // Writable once the connection is made or has failed, SO_ERROR tells which
+    fd_set writable;
+    FD_ZERO(&writable);
+    FD_SET(socketFd, &writable);
+    timeval none = { 0, 0 };
+    int ready = select(socketFd + 1, nullptr, &writable, nullptr, &none);
+    if (ready == 0) {
+        if (millis() - connectStarted > NMEA_STREAM_CONNECT_TIMEOUT) {
+            close();
+        }
+        return false;
+    }
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (ready < 0 || getsockopt(socketFd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0) {
+        close();
+        return false;
+    }
+    
+    state = CONNECTED;
+    lastConnectAttempt = 0;
+    connects++;
+    return true;
+}
+
+void NMEAStream::close() {
+    if (socketFd >= 0) {
+        ::close(socketFd);
+        socketFd = -1;
+    }
+    
+    // Part of a line went out, the rest would garble the first line on the next connection
+    if (state == CONNECTED && lineOpen) {
+        lineOpen = false;
+        skipBytes = NMEA_STREAM_LINE_SIZE;
+        skipCutLine();
+    }
+    state = IDLE;
+}
+
+void NMEAStream::skipCutLine() {
+    // Lines are at most NMEA_STREAM_LINE_SIZE, so is the rest of one without a line end
+    while (skipBytes > 0 && outgoingOffset < outgoingLength) {
+        skipBytes--;
+        cutBytes++;
+        if (outgoing[outgoingOffset++] == '\n') {
+            skipBytes = 0;
+        }
+    }
+}
+
+bool NMEAStream::fillOutgoing() {
+    while (true) {
+        outgoingLength = buffer.pop(outgoing, sizeof(outgoing));
+        outgoingOffset = 0;
+        if (outgoingLength == 0) {
+            return false;
+        }
+        skipCutLine();
+        if (outgoingOffset < outgoingLength) {
+            return true;
+        }
+    }
+}
+
+NMEAStream::Stats NMEAStream::getStats() const {
+    Stats stats;
+    stats.lines = lines;
+    stats.droppedLines = droppedLines;
+    stats.droppedBytes = droppedBytes + cutBytes;
+    stats.written = written;
+    stats.waiting = buffer.size();
+    stats.highWater = buffer.getHighWater();
+    stats.connects = connects;
+    stats.disconnects = disconnects;
+    return stats;
+}
@@ -0,0 +1,99 @@
+#ifndef NMEA_STREAM_H
+#define NMEA_STREAM_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "SPSCRing.h"
+
+#define NMEA_STREAM_BUFFER_SIZE 4096          // Bytes waiting for the socket, a power of two
+#define NMEA_STREAM_LINE_SIZE 128             // Longest line kept whole, NMEA sentences have up to 82
+#define NMEA_STREAM_WRITE_SIZE 1460           // Taken from the buffer per write, one TCP segment
+#define NMEA_STREAM_SOCKET_BUFFER 5744       // Send buffer of the socket, lwIP's default TCP_SND_BUF
+#define NMEA_STREAM_CONNECT_TIMEOUT 3000      // ms for the server to accept the connection
+#define NMEA_STREAM_RECONNECT_INTERVAL 5000   // ms between connection attempts while it is unreachable
+
+// Raw NMEA over one plain TCP connection, every line as it arrives, for a
+// server that reads a byte stream (gpsd, a chartplotter, nc -lk 10110).
+//
+// write() takes the receiver data and puts each complete line into a bounded
+// buffer, whole or not at all. process() connects and writes as much of the
+// buffer as the socket accepts, both without ever waiting: the socket is
+// non-blocking. When the server reads slower than the receiver sends, the
+// buffer fills and new lines are dropped and counted, so the stream stays
+// whole lines with gaps rather than falling behind.
+//
+// write() and process() may run in different tasks, one each. Plain BSD
+// sockets: lwIP on the ESP32, the host's on Linux.
+class NMEAStream {
+public:
+    struct Stats {
+        uint32_t lines;            // Lines put into the buffer
+        uint32_t droppedLines;     // Lines the buffer had no room for
+        uint32_t droppedBytes;     // Their bytes, and the rest of a line cut by a lost connection
+        uint32_t written;          // Bytes the socket accepted
+        uint32_t waiting;          // Bytes in the buffer
+        uint32_t highWater;        // Most bytes in the buffer at once
+        uint32_t connects;
+        uint32_t disconnects;
+    };
+    
+    NMEAStream(const String& server, uint16_t port);
+    ~NMEAStream();
+    
+    // Producer side: raw receiver data in any pieces. A partial line waits
+    // for the rest; data without line ends (UBX) goes in pieces of
+    // NMEA_STREAM_LINE_SIZE.
+    void write(const uint8_t* data, size_t length);
+    
+    // Consumer side: connect if needed and write what the socket takes
+    void process();
+    
+    // Consumer side
+    bool isConnected() const { return state == CONNECTED; }
+    void close();
+    
+    Stats getStats() const;
+
+private:
+    enum State {
+        IDLE,
+        CONNECTING,
+        CONNECTED
+    };
+    
+    String server;
+    uint16_t port;
+    
+    // Producer side, the line being collected
+    uint8_t line[NMEA_STREAM_LINE_SIZE];
+    size_t lineLength;
+    
+    SPSCRing<uint8_t, NMEA_STREAM_BUFFER_SIZE> buffer;
+    
+    // Consumer side, the bytes taken from the buffer and not yet written
+    int socketFd;
+    State state;
+    unsigned long connectStarted;
+    unsigned long lastConnectAttempt;
+    uint8_t outgoing[NMEA_STREAM_WRITE_SIZE];
+    size_t outgoingLength;
+    size_t outgoingOffset;
+    bool lineOpen;       // The last byte written was not a line end
+    size_t skipBytes;    // Rest of a line cut by a lost connection, up to its end
+    
+    std::atomic<uint32_t> lines;
+    std::atomic<uint32_t> droppedLines;
+    std::atomic<uint32_t> droppedBytes;
+    std::atomic<uint32_t> cutBytes;
+    std::atomic<uint32_t> written;
+    std::atomic<uint32_t> connects;
+    std::atomic<uint32_t> disconnects;
+    
+    void commitLine();
+    bool startConnect();
+    bool finishConnect();
+    void skipCutLine();
+    bool fillOutgoing();
+};
+
+#endif // NMEA_STREAM_H
@@ -0,0 +1,282 @@
+#include "NMEAUdp.h"
+#include "NMEANumeric.h"
+#ifdef ARDUINO_ARCH_ESP32
+#include <lwip/sockets.h>
+#include <lwip/netdb.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Sentence types that carry the UTC time, and in which field
+static const struct {
+    char type[4];
+    uint8_t field;
+} timeFields[] = {
+    { "GGA", 1 }, { "RMC", 1 }, { "GNS", 1 }, { "ZDA", 1 }, { "GST", 1 }, { "GBS", 1 }, { "GRS", 1 }, { "GLL", 5 }
+};
+
+NMEAUdp::NMEAUdp(const String& address, uint16_t port, Mode mode) :
+    address(address),
+    port(port),
+    mode(mode),
+    socketFd(-1),
+    multicast(false),
+    destination(0),
+    lineLength(0),
+    inSentence(false),
+    datagramLength(0),
+    datagramStarted(0),
+    epochTimeLength(0),
+    epochSentences(0),
+    expectedSentences(0),
+    lastEpochSentences(UINT16_MAX),
+    secondStarted(0),
+    secondPackets(0),
+    secondBytes(0),
+    sentences(0),
+    rejected(0),
+    packets(0),
+    bytes(0),
+    failed(0),
+    packetsPerSecond(0),
+    bytesPerSecond(0) {
+}
+
+NMEAUdp::~NMEAUdp() {
+    if (socketFd >= 0) {
+        close(socketFd);
+    }
+}
+
+bool NMEAUdp::begin() {
+    if (socketFd >= 0) {
+        return true;
+    }
+    in_addr parsed;
+    if (inet_pton(AF_INET, address.c_str(), &parsed) != 1) {
+        addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo* result = nullptr;
+        if (getaddrinfo(address.c_str(), nullptr, &hints, &result) != 0 || result == nullptr) {
+            return false;
+        }
+        parsed = ((sockaddr_in*)result->ai_addr)->sin_addr;
+        freeaddrinfo(result);
+    }
+    destination = parsed.s_addr;
+    multicast = (ntohl(destination) >> 28) == 0xE;
+    
+    socketFd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (socketFd < 0) {
+        return false;
+    }
+    
+    // A subnet broadcast (192.168.1.255) looks like any other address without
+    // the netmask, so broadcasting is always allowed
+    int on = 1;
+    setsockopt(socketFd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+    if (multicast) {
+        // Stay on the local network
+        uint8_t ttl = 1;
+        setsockopt(socketFd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    }
+    secondStarted = millis();
+    return true;
+}
+
+void NMEAUdp::write(const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        char c = (char)data[i];
+        if (c == '$' || c == '!') {
+            // A new sentence, the one before it never ended
+            if (inSentence) {
+                rejected++;
+            }
+            inSentence = true;
+            lineLength = 0;
+        }
+        if (!inSentence) {
+            continue;
+        }
+        if (lineLength == sizeof(line)) {
+            rejected++;
+            inSentence = false;
+            continue;
+        }
+        line[lineLength++] = c;
+        if (c == '\n') {
+            endLine();
+        }
+    }
+}
+
+void NMEAUdp::endLine() {
+    inSentence = false;
+    if (validSentence()) {
+        addSentence();
+    }
+    else {
+        rejected++;
+    }
+}
+
+bool NMEAUdp::validSentence() const {
+    // "$...*hh" before the line end, hh the XOR of the characters in between
+    size_t end = lineLength - 1;
+    if (end > 0 && line[end - 1] == '\r') {
+        end--;
+    }
+    if (end < 4 || line[end - 3] != '*') {
+        return false;
+    }
+    for (size_t i = 1; i < end - 3; i++) {
+        if (line[i] < 0x20 || line[i] > 0x7E) {
+            return false;
+        }
+    }
+    int8_t high = nmeaHexValue(line[end - 2]);
+    int8_t low = nmeaHexValue(line[end - 1]);
+    return high >= 0 && low >= 0 && ((high << 4) | low) == nmeaChecksum(line + 1, line + end - 3);
+}
+
+size_t NMEAUdp::timeField(const char** time) const {
+    // "$GPGGA,": talker, type and the first comma
+    if (lineLength < 7 || line[6] != ',') {
+        return 0;
+    }
+    uint8_t field = 0;
+    for (size_t i = 0; i < sizeof(timeFields) / sizeof(timeFields[0]); i++) {
+        if (memcmp(line + 3, timeFields[i].type, 3) == 0) {
+            field = timeFields[i].field;
+            break;
+        }
+    }
+    if (field == 0) {
+        return 0;
+    }
+    
+    const char* start = line;
+    const char* end = line + lineLength;
+    for (uint8_t i = 0; i < field; i++) {
+        start = (const char*)memchr(start, ',', end - start);
+        if (start == nullptr) {
+            return 0;
+        }
+        start++;
+    }
+    const char* stop = start;
+    while (stop < end && *stop != ',' && *stop != '*') {
+        stop++;
+    }
+    size_t length = stop - start;
+    if (length == 0 || length > NMEA_UDP_EPOCH_TIME_SIZE) {
+        return 0;
+    }
+    *time = start;
+    return length;
+}
+
+void NMEAUdp::addSentence() {
+    sentences++;
+    if (mode == SENTENCE) {
+        send((const uint8_t*)line, lineLength);
+        return;
+    }
+    
+    const char* time;
+    size_t timeLength = timeField(&time);
+    if (timeLength > 0 && (timeLength != epochTimeLength || memcmp(time, epochTime, timeLength) != 0)) {
+        // A new epoch: what is left of the last one goes. Expect as many
+        // sentences as the smaller of the last two epochs had, receivers that
+        // add satellite sentences once a second then still send the position
+        // without waiting, the satellites follow in a datagram of their own.
+        flush();
+        if (epochSentences > 0) {
+            expectedSentences = min(epochSentences, lastEpochSentences);
+            lastEpochSentences = epochSentences;
+        }
+        memcpy(epochTime, time, timeLength);
+        epochTimeLength = timeLength;
+        epochSentences = 0;
+    }
+    
+    if (datagramLength + lineLength > sizeof(datagram)) {
+        flush();
+    }
+    if (datagramLength == 0) {
+        datagramStarted = millis();
+    }
+    memcpy(datagram + datagramLength, line, lineLength);
+    datagramLength += lineLength;
+    epochSentences++;
+    
+    // Out as soon as the epoch holds what the last one had, rather than with the next
+    if (epochSentences == expectedSentences) {
+        flush();
+    }
+}
+
+void NMEAUdp::flush() {
+    if (datagramLength > 0) {
+        send(datagram, datagramLength);
+        datagramLength = 0;
+    }
+}
+
+void NMEAUdp::send(const uint8_t* data, size_t length) {
+    if (socketFd < 0) {
+        failed++;
+        return;
+    }
+    sockaddr_in to;
+    memset(&to, 0, sizeof(to));
+    to.sin_family = AF_INET;
+    to.sin_port = htons(port);
+    to.sin_addr.s_addr = destination;
+    
+    // Without waiting: a datagram the stack has no room for is lost either way
+    ssize_t count = sendto(socketFd, data, length, MSG_DONTWAIT, (sockaddr*)&to, sizeof(to));
+    if (count == (ssize_t)length) {
+        packets++;
+        bytes += length;
+    }
+    else {
+        failed++;
+    }
+}
+
+void NMEAUdp::process() {
+    if (datagramLength > 0 && millis() - datagramStarted >= NMEA_UDP_EPOCH_TIMEOUT) {
+        flush();
+    }
+    
+    // Rates over the time since the last update, a second or a little more
+    unsigned long elapsed = millis() - secondStarted;
+    if (elapsed >= 1000) {
+        uint32_t sentPackets = packets;
+        uint32_t sentBytes = bytes;
+        packetsPerSecond = (uint64_t)(sentPackets - secondPackets) * 1000 / elapsed;
+        bytesPerSecond = (uint64_t)(sentBytes - secondBytes) * 1000 / elapsed;
+        secondPackets = sentPackets;
+        secondBytes = sentBytes;
+        secondStarted += elapsed;
+    }
+}
+
+NMEAUdp::Stats NMEAUdp::getStats() const {
+    Stats stats;
+    stats.sentences = sentences;
+    stats.rejected = rejected;
+    stats.packets = packets;
+    stats.bytes = bytes;
+    stats.failed = failed;
+    stats.packetsPerSecond = packetsPerSecond;
+    stats.bytesPerSecond = bytesPerSecond;
+    return stats;
+}
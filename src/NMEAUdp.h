@@ -0,0 +1,105 @@
+#ifndef NMEA_UDP_H
+#define NMEA_UDP_H
+
+#include <Arduino.h>
+#include <atomic>
+
+#define NMEA_UDP_PORT 10110                // The usual port of chartplotters for NMEA 0183 over UDP
+#define NMEA_UDP_DATAGRAM_SIZE 1472        // Largest payload that is not fragmented on Ethernet or WiFi
+#define NMEA_UDP_LINE_SIZE 128             // Longest sentence accepted, NMEA allows 82
+#define NMEA_UDP_EPOCH_TIMEOUT 1000        // ms, an epoch that does not complete goes out after this
+#define NMEA_UDP_EPOCH_TIME_SIZE 12        // Characters of the time field kept to tell epochs apart
+
+// NMEA 0183 over UDP for OpenCPN and other navigation apps on the LAN, to a
+// unicast, broadcast or multicast address.
+//
+// write() takes the raw receiver data, picks out the sentences, checks their
+// checksums and sends the valid ones: each in a datagram of its own, or all
+// sentences of an epoch in one. An epoch ends like the parser's: when the
+// time changes, or as soon as it holds as many sentences as the last ones.
+// Datagrams are built in a fixed buffer and sent without waiting, nothing is
+// allocated per packet.
+//
+// One task: write() and process() are called from the loop.
+class NMEAUdp {
+public:
+    enum Mode {
+        SENTENCE,   // A datagram per sentence
+        EPOCH       // A datagram per epoch, or more if it does not fit one
+    };
+    
+    struct Stats {
+        uint32_t sentences;          // Valid sentences taken
+        uint32_t rejected;           // Bad checksum, cut off or too long
+        uint32_t packets;            // Datagrams sent
+        uint32_t bytes;
+        uint32_t failed;             // Datagrams the network stack did not take
+        uint32_t packetsPerSecond;   // In the last full second
+        uint32_t bytesPerSecond;
+    };
+    
+    NMEAUdp(const String& address, uint16_t port = NMEA_UDP_PORT, Mode mode = EPOCH);
+    ~NMEAUdp();
+    
+    // Open the socket. False if it failed or the address is not valid.
+    bool begin();
+    
+    // Raw receiver data in any pieces, anything between sentences (UBX) is skipped
+    void write(const uint8_t* data, size_t length);
+    
+    // Send an epoch that is overdue and update the per second counters,
+    // call at least once a second
+    void process();
+    
+    // Send the sentences collected so far
+    void flush();
+    
+    bool isMulticast() const { return multicast; }
+    Stats getStats() const;
+
+private:
+    String address;
+    uint16_t port;
+    Mode mode;
+    int socketFd;
+    bool multicast;
+    uint32_t destination;      // IPv4 address, network byte order
+    
+    // The sentence being received
+    char line[NMEA_UDP_LINE_SIZE];
+    size_t lineLength;
+    bool inSentence;
+    
+    // The datagram being collected, EPOCH only
+    uint8_t datagram[NMEA_UDP_DATAGRAM_SIZE];
+    size_t datagramLength;
+    unsigned long datagramStarted;
+    
+    // Epoch tracking: the time field of the current epoch, its sentences,
+    // how many the last one had and how many complete an epoch
+    char epochTime[NMEA_UDP_EPOCH_TIME_SIZE];
+    size_t epochTimeLength;
+    uint16_t epochSentences;
+    uint16_t expectedSentences;
+    uint16_t lastEpochSentences;
+    
+    unsigned long secondStarted;
+    uint32_t secondPackets;
+    uint32_t secondBytes;
+    
+    std::atomic<uint32_t> sentences;
+    std::atomic<uint32_t> rejected;
+    std::atomic<uint32_t> packets;
+    std::atomic<uint32_t> bytes;
+    std::atomic<uint32_t> failed;
+    std::atomic<uint32_t> packetsPerSecond;
+    std::atomic<uint32_t> bytesPerSecond;
+    
+    void endLine();
+    bool validSentence() const;
+    size_t timeField(const char** time) const;
+    void addSentence();
+    void send(const uint8_t* data, size_t length);
+};
+
+#endif // NMEA_UDP_H
@@ -0,0 +1,110 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Fixed-size queue between exactly one producer and one consumer task, without
+// locks: each side only writes its own index. Plain C++11 atomics, so the same
+// code runs between the two ESP32 cores and between host threads.
+//
+// A full ring rejects new items rather than overwriting old ones, the consumer
+// may be reading those. Rejected items are counted, as is the highest fill level.
+template <typename T, uint32_t Capacity>
+class SPSCRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SPSCRing() : head(0), tail(0), dropped(0), highWater(0) {}
+    
+    // Producer side. False, and counted as dropped, if the ring is full.
+    bool push(const T& item) {
+        uint32_t write = head.load(std::memory_order_relaxed);
+        uint32_t read = tail.load(std::memory_order_acquire);
+        if (write - read >= Capacity) {
+            dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        items[write & (Capacity - 1)] = item;
+        head.store(write + 1, std::memory_order_release);
+        updateHighWater(write + 1 - read);
+        return true;
+    }
+    
+    // Producer side, as many items as fit. Returns that count, the rest is dropped.
+    size_t push(const T* data, size_t count) {
+        uint32_t write = head.load(std::memory_order_relaxed);
+        uint32_t read = tail.load(std::memory_order_acquire);
+        size_t room = Capacity - (write - read);
+        size_t accepted = (count < room) ? count : room;
+        for (size_t i = 0; i < accepted; i++) {
+            items[(write + i) & (Capacity - 1)] = data[i];
+        }
+        if (accepted > 0) {
+            head.store(write + (uint32_t)accepted, std::memory_order_release);
+            updateHighWater(write + (uint32_t)accepted - read);
+        }
+        if (accepted < count) {
+            dropped.store(dropped.load(std::memory_order_relaxed) + (uint32_t)(count - accepted),
+                          std::memory_order_relaxed);
+        }
+        return accepted;
+    }
+    
+    // Consumer side. False if the ring is empty.
+    bool pop(T& item) {
+        uint32_t read = tail.load(std::memory_order_relaxed);
+        uint32_t write = head.load(std::memory_order_acquire);
+        if (read == write) {
+            return false;
+        }
+        item = items[read & (Capacity - 1)];
+        tail.store(read + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Consumer side, up to cap items. Returns the count.
+    size_t pop(T* data, size_t cap) {
+        uint32_t read = tail.load(std::memory_order_relaxed);
+        uint32_t write = head.load(std::memory_order_acquire);
+        size_t available = write - read;
+        size_t count = (cap < available) ? cap : available;
+        for (size_t i = 0; i < count; i++) {
+            data[i] = items[(read + i) & (Capacity - 1)];
+        }
+        if (count > 0) {
+            tail.store(read + (uint32_t)count, std::memory_order_release);
+        }
+        return count;
+    }
+    
+    // Either side, a snapshot that may be outdated by the time it is used
+    uint32_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+    static uint32_t capacity() { return Capacity; }
+    
+    // Overflow statistics, written by the producer only
+    uint32_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+    uint32_t getHighWater() const { return highWater.load(std::memory_order_relaxed); }
+
+private:
+    T items[Capacity];
+    
+    // Free running counters, the index is their low bits. head is only
+    // written by the producer, tail only by the consumer.
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+    
+    std::atomic<uint32_t> dropped;
+    std::atomic<uint32_t> highWater;
+    
+    void updateHighWater(uint32_t fill) {
+        if (fill > highWater.load(std::memory_order_relaxed)) {
+            highWater.store(fill, std::memory_order_relaxed);
+        }
+    }
+};
+
+#endif // SPSC_RING_H
@@ -1,5 +1,21 @@
 #include "ScreenManager.h"
 
+const uint16_t ScreenManager::screenFields[SCREEN_COUNT] = {
+  // Values
+  GPSParser::FIELD_TIME | GPSParser::FIELD_DATE | GPSParser::FIELD_POSITION | GPSParser::FIELD_SPEED |
+  GPSParser::FIELD_COURSE | GPSParser::FIELD_ALTITUDE | GPSParser::FIELD_SATELLITES | GPSParser::FIELD_DOP,
+  // Satellites
+  GPSParser::FIELD_SATELLITE_TABLE | GPSParser::FIELD_USED_SATELLITES,
+  // Track, animated with the filter
+  GPSParser::FIELD_POSITION | GPSParser::FIELD_SPEED | GPSParser::FIELD_COURSE | GPSParser::FIELD_DOP,
+  // Waypoints
+  GPSParser::FIELD_POSITION,
+  // Compass, animated with the filter
+  GPSParser::FIELD_POSITION | GPSParser::FIELD_SPEED | GPSParser::FIELD_COURSE | GPSParser::FIELD_DOP,
+  // System
+  GPSParser::FIELD_ALL
+};
+
 // Updated constructor
 ScreenManager::ScreenManager(TFT_eSPI* tft, GPSParser* gpsParser, TCPLogger* logger, String* hostname) {
   this->tft = tft;
@@ -8,6 +24,9 @@ ScreenManager::ScreenManager(TFT_eSPI* tft, GPSParser* gpsParser, TCPLogger* log
   this->hostname = hostname;
   this->currentScreen = SCREEN_VALUES;
   this->systemScrollOffset = 0;
+  
+  // Only decode what the visible screen needs
+  this->fieldSubscription = gpsParser->subscribe(screenFields[currentScreen]);
 }
 
 void ScreenManager::begin() {
@@ -17,8 +36,18 @@ void ScreenManager::begin() {
 }
 
 void ScreenManager::update() {
-  // Update the current screen with new data
-  drawScreen();
+  // Update the current screen with new data. Animated screens only redraw
+  // what moves, the rest stays from when the screen was selected.
+  if (isAnimated()) {
+    animate();
+  } else {
+    drawScreen();
+  }
+  
+  // Age of the fix now on the screen
+  GPSParser::Fix fix;
+  gpsParser->getFix(fix);
+  gpsParser->recordLatency(GPSParser::LATENCY_RENDER, fix);
 }
 
 bool ScreenManager::handleTouch(int x, int y) {
@@ -89,6 +118,7 @@ void ScreenManager::scrollDown() {
 void ScreenManager::setScreen(ScreenID screen) {
   if (screen != currentScreen && screen < SCREEN_COUNT) {
     currentScreen = screen;
+    gpsParser->setSubscription(fieldSubscription, screenFields[screen]);
     
     // Reset scroll position when changing screens
     if (screen == SCREEN_SYSTEM) {
@@ -106,6 +136,35 @@ void ScreenManager::setScreen(ScreenID screen) {
   }
 }
 
+void ScreenManager::setFilter(GPSFilter* filter) {
+  this->filter = filter;
+}
+
+bool ScreenManager::isAnimated() {
+  return filter != nullptr && (currentScreen == SCREEN_COMPASS || currentScreen == SCREEN_TRACK);
+}
+
+void ScreenManager::animate() {
+  GPSFilter::Estimate estimate;
+  if (!isAnimated() || !filter->predictNow(estimate)) {
+    return;
+  }
+  
+  if (currentScreen == SCREEN_COMPASS) {
+    // Move the needle by erasing it at the old course
+    if (needleCourse < 0 || fabsf(estimate.course - needleCourse) >= COMPASS_NEEDLE_STEP) {
+      if (needleCourse >= 0) {
+        drawCompassNeedle(needleCourse, TFT_BLACK);
+      }
+      drawCompassNeedle(estimate.course, TFT_RED);
+      needleCourse = estimate.course;
+    }
+    drawCompassValues(estimate.course, estimate.speed);
+  } else {
+    drawTrackValues(estimate.latitudeE7, estimate.longitudeE7, true, estimate.speed, estimate.course);
+  }
+}
+
 void ScreenManager::drawTabBar() {
   // Draw the tab bar background
   tft->fillRect(0, tft->height() - TAB_BAR_HEIGHT, tft->width(), TAB_BAR_HEIGHT, TFT_DARKGREY);
@@ -185,6 +244,10 @@ void ScreenManager::drawScreen() {
 }
 
 void ScreenManager::drawValuesScreen() {
+  // Take one snapshot so that all values come from the same fix
+  GPSParser::Fix fix;
+  gpsParser->getFix(fix);
+  
   // Clear the data area (excluding tab bar)
   tft->fillRect(0, 0, tft->width(), tft->height() - TAB_BAR_HEIGHT, TFT_BLACK);
   
@@ -199,35 +262,39 @@ void ScreenManager::drawValuesScreen() {
   
   // Position data
   tft->setTextColor(TFT_GREEN);
+  char text[GPS_POSITION_TEXT_SIZE];
+  gpsParser->formatPosition(fix, text, sizeof(text));
   tft->drawString("Position:", 10, startY);
-  tft->drawString(gpsParser->getPositionString(), 80, startY);
+  tft->drawString(text, 80, startY);
   
   tft->drawString("Latitude:", 10, startY + lineHeight);
-  tft->drawString(String(gpsParser->getLatitude(), 6) + "°", 80, startY + lineHeight);
+  tft->drawString(String(fix.latitudeE7 * 1e-7, 7) + "°", 80, startY + lineHeight);
   
   tft->drawString("Longitude:", 10, startY + lineHeight*2);
-  tft->drawString(String(gpsParser->getLongitude(), 6) + "°", 80, startY + lineHeight*2);
+  tft->drawString(String(fix.longitudeE7 * 1e-7, 7) + "°", 80, startY + lineHeight*2);
   
   // Navigation data
   tft->setTextColor(TFT_YELLOW);
   tft->drawString("Speed:", 10, startY + lineHeight*3);
-  tft->drawString(String(gpsParser->getSpeed()) + " knots", 80, startY + lineHeight*3);
+  tft->drawString(String(fix.speed) + " knots", 80, startY + lineHeight*3);
   
   tft->drawString("Course:", 10, startY + lineHeight*4);
-  tft->drawString(String(gpsParser->getCourse()) + "°", 80, startY + lineHeight*4);
+  tft->drawString(String(fix.course) + "°", 80, startY + lineHeight*4);
   
   // Time data
   tft->setTextColor(TFT_CYAN);
   tft->drawString("UTC Time:", 10, startY + lineHeight*5);
-  tft->drawString(gpsParser->getTimeString(), 80, startY + lineHeight*5);
+  gpsParser->formatTime(fix, text, sizeof(text));
+  tft->drawString(text, 80, startY + lineHeight*5);
   
   tft->drawString("Date:", 10, startY + lineHeight*6);
-  tft->drawString(gpsParser->getDateString(), 80, startY + lineHeight*6);
+  gpsParser->formatDate(fix, text, sizeof(text));
+  tft->drawString(text, 80, startY + lineHeight*6);
   
   // Satellite data
   tft->setTextColor(TFT_MAGENTA);
   tft->drawString("Satellites:", 10, startY + lineHeight*7);
-  tft->drawString(String(gpsParser->getSatellites()), 80, startY + lineHeight*7);
+  tft->drawString(String(fix.satellites), 80, startY + lineHeight*7);
   
   // Fix data
   tft->setTextColor(TFT_WHITE);
@@ -235,7 +302,7 @@ void ScreenManager::drawValuesScreen() {
   
   // Display fix quality based on satellites
   String fixQuality;
-  int satellites = gpsParser->getSatellites();
+  int satellites = fix.satellites;
   if (satellites == 0) {
     fixQuality = "No Fix";
     tft->setTextColor(TFT_RED);
@@ -255,8 +322,8 @@ void ScreenManager::drawValuesScreen() {
   tft->setTextColor(TFT_WHITE);
   tft->drawString("Altitude:", 10, startY + lineHeight*9);
   // Assuming GPSParser has getAltitude method, otherwise you'll need to add it
-  if (gpsParser->hasAltitude()) {
-    tft->drawString(String(gpsParser->getAltitude()) + " m", 80, startY + lineHeight*9);
+  if (fix.validAltitude) {
+    tft->drawString(String(fix.altitude) + " m", 80, startY + lineHeight*9);
   } else {
     tft->setTextColor(TFT_DARKGREY);
     tft->drawString("N/A", 80, startY + lineHeight*9);
@@ -266,8 +333,8 @@ void ScreenManager::drawValuesScreen() {
   tft->setTextColor(TFT_WHITE);
   tft->drawString("HDOP:", 10, startY + lineHeight*10);
   // Assuming GPSParser has getHDOP method, otherwise you'll need to add it
-  if (gpsParser->hasHDOP()) {
-    tft->drawString(String(gpsParser->getHDOP()), 80, startY + lineHeight*10);
+  if (fix.validHDOP) {
+    tft->drawString(String(fix.hdop), 80, startY + lineHeight*10);
   } else {
     tft->setTextColor(TFT_DARKGREY);
     tft->drawString("N/A", 80, startY + lineHeight*10);
@@ -283,9 +350,13 @@ void ScreenManager::drawSatellitesScreen() {
   tft->setTextColor(TFT_WHITE);
   tft->drawString("Satellites", 10, 10);
   
+  // Get the satellite table from the parser
+  GPSParser::SatelliteInfo sats[GPS_MAX_SATELLITES];
+  int numSatellites = gpsParser->getSatelliteInfo(sats, GPS_MAX_SATELLITES);
+  
   // Display satellite information
   tft->setTextColor(TFT_MAGENTA);
-  tft->drawString("Satellites in view: " + String(gpsParser->getSatellites()), 10, 30);
+  tft->drawString("Satellites in view: " + String(numSatellites), 10, 30);
   
   // Draw a satellite view diagram
   int centerX = 160;
@@ -310,41 +381,28 @@ void ScreenManager::drawSatellitesScreen() {
   tft->drawLine(centerX - outerRadius, centerY, centerX + outerRadius, centerY, TFT_DARKGREY);
   tft->drawLine(centerX, centerY - outerRadius, centerX, centerY + outerRadius, TFT_DARKGREY);
   
-  // Draw satellites
-  // In a real implementation, you would get actual satellite positions from the GPS
-  // For now, we'll simulate satellites with random positions
-  int numSatellites = gpsParser->getSatellites();
-  
+  // Draw satellites at their reported azimuth and elevation
   for (int i = 0; i < numSatellites; i++) {
-    // In a real implementation, you would get actual azimuth and elevation
-    // For now, we'll use random positions
-    float azimuth = random(0, 360) * PI / 180.0;
-    float elevation = random(0, 90); // 0-90 degrees
+    float azimuth = sats[i].azimuth * PI / 180.0;
+    float elevation = constrain(sats[i].elevation, 0, 90);
     
     // Convert elevation to radius (90° = center, 0° = edge)
     float radius = outerRadius * (1.0 - elevation / 90.0);
     
-    // Calculate x,y position
-    int x = centerX + cos(azimuth) * radius;
-    int y = centerY - sin(azimuth) * radius;
+    // Calculate x,y position (north is up, azimuth runs clockwise)
+    int x = centerX + sin(azimuth) * radius;
+    int y = centerY - cos(azimuth) * radius;
     
-    // Determine color based on simulated signal strength
-    uint16_t color;
-    int signalStrength = random(0, 100);
-    if (signalStrength > 70) {
-      color = TFT_GREEN;
-    } else if (signalStrength > 40) {
-      color = TFT_YELLOW;
+    // Draw the satellite, filled when it is used in the fix
+    if (sats[i].used) {
+      tft->fillCircle(x, y, 4, snrColor(sats[i].snr));
     } else {
-      color = TFT_RED;
+      tft->drawCircle(x, y, 4, snrColor(sats[i].snr));
     }
     
-    // Draw the satellite
-    tft->fillCircle(x, y, 4, color);
-    
     // Draw satellite ID
     tft->setTextColor(TFT_WHITE);
-    tft->drawString(String(i+1), x-3, y-3);
+    tft->drawString(String(sats[i].id), x-3, y-3);
   }
   
   // Add satellite signal strength bars at the bottom
@@ -361,31 +419,37 @@ void ScreenManager::drawSatellitesScreen() {
   
   for (int i = 0; i < maxBars; i++) {
     int x = 10 + i * (barWidth + barSpacing);
-    // In a real implementation, use actual signal strength
-    int strength = random(30, 100);
-    int barHeight = (strength * barMaxHeight) / 100;
-    
-    // Color based on strength
-    uint16_t color;
-    if (strength > 70) {
-      color = TFT_GREEN;
-    } else if (strength > 40) {
-      color = TFT_YELLOW;
-    } else {
-      color = TFT_RED;
-    }
+    // Scale SNR so that 50 dB fills the bar
+    int strength = constrain(sats[i].snr, 0, 50);
+    int barHeight = (strength * barMaxHeight) / 50;
     
     // Draw the bar
-    tft->fillRect(x, barY + (barMaxHeight - barHeight), barWidth, barHeight, color);
+    tft->fillRect(x, barY + (barMaxHeight - barHeight), barWidth, barHeight, snrColor(sats[i].snr));
     tft->drawRect(x, barY, barWidth, barMaxHeight, TFT_DARKGREY);
     
     // Draw the satellite number
     tft->setTextColor(TFT_WHITE);
-    tft->drawString(String(i+1), x + 3, barY + barMaxHeight + 5);
+    tft->drawString(String(sats[i].id), x + 3, barY + barMaxHeight + 5);
   }
 }
 
+uint16_t ScreenManager::snrColor(int snr) {
+  // Color based on signal strength
+  if (snr >= 35) {
+    return TFT_GREEN;
+  } else if (snr >= 25) {
+    return TFT_YELLOW;
+  } else if (snr > 0) {
+    return TFT_RED;
+  }
+  return TFT_DARKGREY;  // Not tracked
+}
+
 void ScreenManager::drawTrackScreen() {
+  // Take one snapshot so that all values come from the same fix
+  GPSParser::Fix fix;
+  gpsParser->getFix(fix);
+  
   // Clear the data area (excluding tab bar)
   tft->fillRect(0, 0, tft->width(), tft->height() - TAB_BAR_HEIGHT, TFT_BLACK);
   
@@ -407,11 +471,13 @@ void ScreenManager::drawTrackScreen() {
   // Draw current position
   tft->fillCircle(160, 100, 5, TFT_RED);
   
-  // Display track information
-  tft->setTextColor(TFT_YELLOW);
-  tft->drawString("Current Position: " + gpsParser->getPositionString(), 10, 170);
-  tft->drawString("Speed: " + String(gpsParser->getSpeed()) + " knots", 10, 185);
-  tft->drawString("Course: " + String(gpsParser->getCourse()) + "°", 160, 185);
+  // Display track information, predicted by the filter when it can
+  GPSFilter::Estimate estimate;
+  if (filter != nullptr && filter->predictNow(estimate)) {
+    drawTrackValues(estimate.latitudeE7, estimate.longitudeE7, true, estimate.speed, estimate.course);
+  } else {
+    drawTrackValues(fix.latitudeE7, fix.longitudeE7, fix.validPosition, fix.speed, fix.course);
+  }
   
   // Add track statistics
   tft->setTextColor(TFT_CYAN);
@@ -419,6 +485,27 @@ void ScreenManager::drawTrackScreen() {
   tft->drawString("Elapsed Time: 00:00:00", 160, 200);
 }
 
+void ScreenManager::drawTrackValues(int32_t latitudeE7, int32_t longitudeE7, bool validPosition, float speed,
+                                    float course) {
+  // Text on a background, so that it can be redrawn in place
+  char text[GPS_POSITION_TEXT_SIZE + 20];
+  size_t length = snprintf(text, sizeof(text), "Current Position: ");
+  if (validPosition) {
+    GPSParser::formatPosition(latitudeE7, longitudeE7, text + length, sizeof(text) - length);
+  } else {
+    snprintf(text + length, sizeof(text) - length, "No Fix");
+  }
+  tft->setTextColor(TFT_YELLOW, TFT_BLACK);
+  tft->setTextPadding(tft->width() - 20);
+  tft->drawString(text, 10, 170);
+  tft->setTextPadding(140);
+  snprintf(text, sizeof(text), "Speed: %.2f knots", speed);
+  tft->drawString(text, 10, 185);
+  snprintf(text, sizeof(text), "Course: %.2f°", course);
+  tft->drawString(text, 160, 185);
+  tft->setTextPadding(0);
+}
+
 void ScreenManager::drawWaypointsScreen() {
   // Clear the data area (excluding tab bar)
   tft->fillRect(0, 0, tft->width(), tft->height() - TAB_BAR_HEIGHT, TFT_BLACK);
@@ -456,6 +543,10 @@ void ScreenManager::drawWaypointsScreen() {
 }
 
 void ScreenManager::drawCompassScreen() {
+  // Take one snapshot so that all values come from the same fix
+  GPSParser::Fix fix;
+  gpsParser->getFix(fix);
+  
   // Clear the data area (excluding tab bar)
   tft->fillRect(0, 0, tft->width(), tft->height() - TAB_BAR_HEIGHT, TFT_BLACK);
   
@@ -466,8 +557,8 @@ void ScreenManager::drawCompassScreen() {
   
   // Draw compass
   int centerX = tft->width() / 2;
-  int centerY = 110;
-  int radius = 80;
+  int centerY = COMPASS_CENTER_Y;
+  int radius = COMPASS_RADIUS;
   
   // Draw compass circle
   tft->drawCircle(centerX, centerY, radius, TFT_WHITE);
@@ -481,25 +572,49 @@ void ScreenManager::drawCompassScreen() {
   tft->drawString("S", centerX - 3, centerY + radius + 5);
   tft->drawString("W", centerX - radius - 15, centerY - 3);
   
-  // Draw heading needle based on course
-  float course = gpsParser->getCourse() * PI / 180.0; // Convert to radians
-  int needleLength = radius - 10;
+  // Draw heading needle based on course, predicted by the filter when it can
+  float course = fix.course;
+  float speed = fix.speed;
+  GPSFilter::Estimate estimate;
+  if (filter != nullptr && filter->predictNow(estimate)) {
+    course = estimate.course;
+    speed = estimate.speed;
+  }
+  drawCompassNeedle(course, TFT_RED);
+  needleCourse = course;
   
-  int needleX = centerX + sin(course) * needleLength;
-  int needleY = centerY - cos(course) * needleLength;
+  // Display course information
+  drawCompassValues(course, speed);
+}
+
+void ScreenManager::drawCompassNeedle(float course, uint16_t color) {
+  int centerX = tft->width() / 2;
+  int centerY = COMPASS_CENTER_Y;
+  float angle = course * PI / 180.0; // Convert to radians
+  int needleLength = COMPASS_RADIUS - 10;
+  
+  int needleX = centerX + sin(angle) * needleLength;
+  int needleY = centerY - cos(angle) * needleLength;
   
-  tft->drawLine(centerX, centerY, needleX, needleY, TFT_RED);
+  tft->drawLine(centerX, centerY, needleX, needleY, color);
   tft->fillTriangle(
     needleX, needleY,
-    centerX + sin(course + 0.2) * (needleLength - 15), centerY - cos(course + 0.2) * (needleLength - 15),
-    centerX + sin(course - 0.2) * (needleLength - 15), centerY - cos(course - 0.2) * (needleLength - 15),
-    TFT_RED
+    centerX + sin(angle + 0.2) * (needleLength - 15), centerY - cos(angle + 0.2) * (needleLength - 15),
+    centerX + sin(angle - 0.2) * (needleLength - 15), centerY - cos(angle - 0.2) * (needleLength - 15),
+    color
   );
-  
-  // Display course information
-  tft->setTextColor(TFT_YELLOW);
-  tft->drawString("Course: " + String(gpsParser->getCourse()) + "°", 10, 180);
-  tft->drawString("Speed: " + String(gpsParser->getSpeed()) + " knots", 160, 180);
+}
+
+void ScreenManager::drawCompassValues(float course, float speed) {
+  // Text on a background, so that it can be redrawn in place
+  char text[32];
+  tft->setTextColor(TFT_YELLOW, TFT_BLACK);
+  tft->setTextPadding(140);
+  snprintf(text, sizeof(text), "Course: %.2f°", course);
+  tft->drawString(text, 10, 180);
+  snprintf(text, sizeof(text), "Speed: %.2f knots", speed);
+  tft->drawString(text, 160, 180);
+  tft->setTextPadding(0);
 }
 
 void ScreenManager::drawSystemScreen() {
@@ -508,7 +623,7 @@ void ScreenManager::drawSystemScreen() {
   
   // Define content parameters
   int lineHeight = 16;
-  int totalLines = 25; // Increased number of lines for more content
+  int totalLines = 37; // Increased number of lines for more content
   int contentHeight = totalLines * lineHeight;
   
   // Calculate max scroll offset
@@ -539,6 +654,10 @@ void ScreenManager::drawSystemScreen() {
     }
   };
   
+  // Take one snapshot so that all values come from the same fix
+  GPSParser::Fix fix;
+  gpsParser->getFix(fix);
+  
   // WiFi Information
   drawInfoLine(0, "WiFi Status:", WiFi.status() == WL_CONNECTED ? "Connected" : "Disconnected", 
                TFT_CYAN, WiFi.status() == WL_CONNECTED ? TFT_GREEN : TFT_RED);
@@ -558,11 +677,14 @@ void ScreenManager::drawSystemScreen() {
   }
   
   // GPS Information
-  drawInfoLine(7, "GPS Status:", gpsParser->getSatellites() > 0 ? "Active" : "No Fix", 
-               TFT_GREEN, gpsParser->getSatellites() > 0 ? TFT_GREEN : TFT_RED);
-  drawInfoLine(8, "Satellites:", String(gpsParser->getSatellites()), TFT_GREEN, TFT_WHITE);
-  drawInfoLine(9, "Position:", gpsParser->getPositionString(), TFT_GREEN, TFT_WHITE);
-  drawInfoLine(10, "Last Update:", gpsParser->getTimeString(), TFT_GREEN, TFT_WHITE);
+  drawInfoLine(7, "GPS Status:", fix.satellites > 0 ? "Active" : "No Fix", 
+               TFT_GREEN, fix.satellites > 0 ? TFT_GREEN : TFT_RED);
+  drawInfoLine(8, "Satellites:", String(fix.satellites), TFT_GREEN, TFT_WHITE);
+  char text[GPS_POSITION_TEXT_SIZE];
+  gpsParser->formatPosition(fix, text, sizeof(text));
+  drawInfoLine(9, "Position:", text, TFT_GREEN, TFT_WHITE);
+  gpsParser->formatTime(fix, text, sizeof(text));
+  drawInfoLine(10, "Last Update:", text, TFT_GREEN, TFT_WHITE);
   
   // Draw horizontal separator
   if (startY + 11 * lineHeight - systemScrollOffset >= 0 && 
@@ -599,13 +721,33 @@ void ScreenManager::drawSystemScreen() {
   }
   
   // GPS Information
-  drawInfoLine(20, "GPS Satellites:", String(gpsParser->getSatellites()), TFT_CYAN, TFT_WHITE);
-  drawInfoLine(21, "GPS Fix:", gpsParser->getFixTypeString(), TFT_CYAN, TFT_WHITE);
-  drawInfoLine(22, "HDOP:", String(gpsParser->getHDOP()), TFT_CYAN, TFT_WHITE);
-  drawInfoLine(23, "VDOP:", String(gpsParser->getVDOP()), TFT_CYAN, TFT_WHITE);
-  drawInfoLine(24, "PDOP:", String(gpsParser->getPDOP()), TFT_CYAN, TFT_WHITE);
-  drawInfoLine(25, "Altitude:", String(gpsParser->getAltitude()) + " m", TFT_CYAN, TFT_WHITE);
-  drawInfoLine(26, "Geoid Separation:", String(gpsParser->getGeoidSeparation()) + " m", TFT_CYAN, TFT_WHITE);
+  drawInfoLine(20, "GPS Satellites:", String(fix.satellites), TFT_CYAN, TFT_WHITE);
+  int fixMode = fix.fixMode;
+  size_t length = GPSParser::formatFixType(fix, text, GPS_FIX_TYPE_TEXT_SIZE);
+  snprintf(text + length, sizeof(text) - length, "%s", fixMode == 3 ? " (3D)" : fixMode == 2 ? " (2D)" : "");
+  drawInfoLine(21, "GPS Fix:", text, TFT_CYAN, TFT_WHITE);
+  drawInfoLine(22, "HDOP:", String(fix.hdop), TFT_CYAN, TFT_WHITE);
+  drawInfoLine(23, "VDOP:", String(fix.vdop), TFT_CYAN, TFT_WHITE);
+  drawInfoLine(24, "PDOP:", String(fix.pdop), TFT_CYAN, TFT_WHITE);
+  drawInfoLine(25, "Altitude:", String(fix.altitude) + " m", TFT_CYAN, TFT_WHITE);
+  drawInfoLine(26, "Geoid Separation:", String(fix.geoidSeparation) + " m", TFT_CYAN, TFT_WHITE);
+  
+  // NMEA link quality
+  GPSParser::Stats stats = gpsParser->getStats();
+  drawInfoLine(28, "NMEA Accepted:", String(stats.accepted), TFT_MAGENTA, TFT_WHITE);
+  drawInfoLine(29, "NMEA Errors:", String(stats.rejected) + " bad, " + String(stats.truncated) + " trunc, " +
+               String(stats.overflowed) + " long", TFT_MAGENTA,
+               (stats.rejected + stats.truncated + stats.overflowed) > 0 ? TFT_ORANGE : TFT_WHITE);
+  drawInfoLine(30, "UBX Frames:", String(stats.ubxAccepted) + " ok, " + String(stats.ubxRejected) + " bad", TFT_MAGENTA,
+               stats.ubxRejected > 0 ? TFT_ORANGE : TFT_WHITE);
+  
+  // Fix age at the end of each stage
+  static const char* latencyLabels[GPSParser::LATENCY_STAGE_COUNT] = { "Arrived:", "Parsed:", "Rendered:", "Uploaded:" };
+  drawInfoLine(32, "Fix Age:", "p50 / p99 / max", TFT_ORANGE, TFT_DARKGREY);
+  for (uint8_t i = 0; i < GPSParser::LATENCY_STAGE_COUNT; i++) {
+    gpsParser->getLatency((GPSParser::LatencyStage)i).format(text, sizeof(text));
+    drawInfoLine(33 + i, latencyLabels[i], text, TFT_ORANGE, TFT_WHITE);
+  }
   
   // Draw scroll bar
   drawScrollBar(systemScrollOffset, systemMaxScrollOffset, contentHeight);
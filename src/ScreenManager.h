@@ -6,6 +6,7 @@
 #include <WiFi.h>
 #include "GPSParser.h"
 #include "TCPLogger.h"
+#include "GPSFilter.h"
 
 // Screen IDs
 enum ScreenID {
@@ -31,6 +32,11 @@ enum ScreenID {
 #define SCROLL_BAR_WIDTH 10
 #define SCROLL_STEP 20
 
+// Compass configuration
+#define COMPASS_CENTER_Y 110
+#define COMPASS_RADIUS 80
+#define COMPASS_NEEDLE_STEP 0.5  // Degrees the course must change before the needle is redrawn
+
 class ScreenManager {
 private:
   TFT_eSPI* tft;
@@ -38,6 +44,9 @@ private:
   TCPLogger* logger;
   String* hostname;
   ScreenID currentScreen;
+  int fieldSubscription;  // Handle of the parser fields the current screen shows
+  GPSFilter* filter = nullptr;
+  float needleCourse = -1;  // Course the compass needle is drawn at, -1 if none
   
   // Scrolling variables
   int systemScrollOffset = 0;
@@ -53,9 +62,13 @@ private:
     "System"  // System tab
   };
   
+  // Parser fields each screen shows
+  static const uint16_t screenFields[SCREEN_COUNT];
+  
   void drawTabBar();
   void drawScreen();
   void drawScrollBar(int offset, int maxOffset, int contentHeight);
+  uint16_t snrColor(int snr);
   
   // Individual screen drawing functions
   void drawValuesScreen();
@@ -65,6 +78,11 @@ private:
   void drawCompassScreen();
   void drawSystemScreen();
   
+  // Parts of the animated screens that move
+  void drawCompassNeedle(float course, uint16_t color);
+  void drawCompassValues(float course, float speed);
+  void drawTrackValues(int32_t latitudeE7, int32_t longitudeE7, bool validPosition, float speed, float course);
+  
 public:
   // Updated constructor to include logger and hostname
   ScreenManager(TFT_eSPI* tft, GPSParser* gpsParser, TCPLogger* logger, String* hostname);
@@ -75,6 +93,12 @@ public:
   void setScreen(ScreenID screen);
   ScreenID getCurrentScreen() { return currentScreen; }
   
+  // The compass and track screens move between fixes with the filter's
+  // prediction. animate() redraws only what moved, call it at the frame rate.
+  void setFilter(GPSFilter* filter);
+  bool isAnimated();
+  void animate();
+  
   // Scroll methods
   void scrollUp();
   void scrollDown();
@@ -1,93 +1,351 @@
 #include "TCPLogger.h"
 
-bool TCPLogger::ensureConnected() {
-    // For HTTP, we just check if WiFi is connected
-    if (WiFi.status() == WL_CONNECTED) {
+bool TCPLogger::ensureConnected(Batch& batch) {
+    if (WiFi.status() != WL_CONNECTED) {
+        connected = false;
+        return false;
+    }
+    if (batch.connection.isConnected()) {
         connected = true;
         return true;
     }
     
-    connected = false;
-    return false;
+    // While the server is unreachable try once per interval only
+    if (lastReconnectAttempt != 0 && millis() - lastReconnectAttempt < RECONNECT_INTERVAL) {
+        return false;
+    }
+    connected = batch.connection.connect();
+    if (!connected) {
+        lastReconnectAttempt = max(millis(), 1UL);
+        return false;
+    }
+    lastReconnectAttempt = 0;
+    
+    // Bodies larger than a segment take two writes, the second must not wait for an ACK
+    batch.client.setNoDelay(true);
+    return true;
+}
+
+TCPLogger::Batch::Batch(const String& server, uint16_t port, const String& path, const char* contentType) :
+    connection(client, server.c_str(), port, path.c_str(), contentType),
+    length(0),
+    records(0),
+    started(0) {
+    fix.sequence = 0;
 }
 
 // Constructor now accepts configuration parameters directly
-TCPLogger::TCPLogger(const String& server, uint16_t port, const String& device) : 
+TCPLogger::TCPLogger(const String& server, uint16_t port, const String& device) :
     serverAddress(server),
     serverPort(port),
     deviceName(device),
-    connected(false), 
-    lastReconnectAttempt(0) {
+    connected(false),
+    clock(nullptr),
+    latencyParser(nullptr),
+    lastReconnectAttempt(0),
+    logBatch(server, port, LOG_ENDPOINT, "application/json"),
+    nmeaBatch(server, port, NMEA_ENDPOINT, "text/plain"),
+    hasPending(false),
+    batchBytes(TCP_LOGGER_BATCH_BYTES),
+    batchRecords(TCP_LOGGER_BATCH_RECORDS),
+    batchInterval(TCP_LOGGER_BATCH_INTERVAL),
+    policy(DROP_OLDEST),
+    coalescePending(0),
+    queued(0),
+    sent(0),
+    failed(0),
+    requests(0),
+    droppedOldest(0),
+    droppedNewest(0),
+    coalesced(0) {
+    coalescedLevel[0] = '\0';
+    coalescedMessage[0] = '\0';
+#ifdef ARDUINO_ARCH_ESP32
+    task = nullptr;
+#endif
 }
 
 TCPLogger::~TCPLogger() {
-    // Nothing to clean up for HTTP client
+#ifdef ARDUINO_ARCH_ESP32
+    if (task != nullptr) {
+        vTaskDelete(task);
+    }
+#endif
 }
 
 bool TCPLogger::begin() {
-    return ensureConnected();
+#ifdef ARDUINO_ARCH_ESP32
+    if (task != nullptr) {
+        return true;
+    }
+    return xTaskCreatePinnedToCore(run, "logger", TCP_LOGGER_TASK_STACK_SIZE, this, TCP_LOGGER_TASK_PRIORITY,
+                                   &task, TCP_LOGGER_TASK_CORE) == pdPASS;
+#else
+    return false;
+#endif
 }
 
-bool TCPLogger::log(const String& message, const String& level) {
-    if (!ensureConnected()) {
+#ifdef ARDUINO_ARCH_ESP32
+void TCPLogger::run(void* logger) {
+    TCPLogger* self = (TCPLogger*)logger;
+    for (;;) {
+        // Woken by every queued record, or when a batch is due
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(self->idleWait()));
+        self->process();
+    }
+}
+#endif
+
+void TCPLogger::setClock(GPSClock* gpsClock) {
+    clock = gpsClock;
+}
+
+void TCPLogger::setLatencyParser(GPSParser* parser) {
+    latencyParser = parser;
+}
+
+void TCPLogger::setBatching(size_t bytes, uint16_t records, uint32_t intervalMs) {
+    batchBytes = constrain(bytes, (size_t)1, (size_t)TCP_LOGGER_BATCH_SIZE);
+    batchRecords = max(records, (uint16_t)1);
+    batchInterval = intervalMs;
+}
+
+bool TCPLogger::formatRecord(Record& record, const char* level, const char* message) {
+    uint64_t timestamp = (clock != nullptr && clock->isSynchronized()) ? clock->now() : millis();
+    size_t length = formatLogRecord(record.data, sizeof(record.data), deviceName.c_str(), timestamp, level, message);
+    record.type = RECORD_LOG;
+    record.length = length;
+    record.fix.sequence = 0;
+    return length > 0;
+}
+
+bool TCPLogger::enqueue(const Record& record, const char* level, const char* message) {
+    bool accepted = queue.push(record);
+    if (!accepted) {
+        switch (policy) {
+        case DROP_OLDEST:
+            // Another task may empty a slot first, either way there is room then
+            if (queue.pop(discarded)) {
+                droppedOldest++;
+            }
+            accepted = queue.push(record);
+            if (!accepted) {
+                droppedNewest++;
+            }
+            break;
+        case COALESCE:
+            if (record.type == RECORD_LOG) {
+                coalescePending++;
+                coalesced++;
+                snprintf(coalescedLevel, sizeof(coalescedLevel), "%s", level);
+                snprintf(coalescedMessage, sizeof(coalescedMessage), "%s", message);
+                return true;
+            }
+            droppedNewest++;
+            break;
+        case DROP_NEWEST:
+            droppedNewest++;
+            break;
+        }
+    }
+    if (!accepted) {
         return false;
     }
     
-    // Create a JSON log message
-    DynamicJsonDocument logDoc(512);
-    logDoc["device"] = deviceName;
-    logDoc["timestamp"] = millis();
-    logDoc["level"] = level;
-    logDoc["message"] = message;
-    
-    String jsonString;
-    serializeJson(logDoc, jsonString);
-    
-    // Create the full URL
-    String url = "http://" + serverAddress + ":" + String(serverPort) + LOG_ENDPOINT;
+    queued++;
+#ifdef ARDUINO_ARCH_ESP32
+    if (task != nullptr) {
+        xTaskNotifyGive(task);
+    }
+#endif
+    return true;
+}
+
+void TCPLogger::flushCoalesced() {
+    // The summary goes first once there is room, so the records stay in order
+    if (coalescePending == 0 || queue.size() >= queue.capacity()) {
+        return;
+    }
+    char message[TCP_LOGGER_COALESCED_MESSAGE + 64];
+    snprintf(message, sizeof(message), "%lu records coalesced while the queue was full, last: %s",
+             (unsigned long)coalescePending, coalescedMessage);
+    if (formatRecord(outgoing, coalescedLevel, message) && queue.push(outgoing)) {
+        coalescePending = 0;
+        queued++;
+    }
+}
+
+bool TCPLogger::log(const String& message, const String& level) {
+    flushCoalesced();
     
-    // Send HTTP POST request
-    HTTPClient http;
-    http.begin(url);
-    http.addHeader("Content-Type", "application/json");
+    // Create a JSON log message
+    if (!formatRecord(outgoing, level.c_str(), message.c_str())) {
+        return false;
+    }
+    return enqueue(outgoing, level.c_str(), message.c_str());
+}
+
+bool TCPLogger::sendRawNMEA(const uint8_t* data, size_t length, const GPSParser::Fix* fix) {
+    flushCoalesced();
     
-    int httpResponseCode = http.POST(jsonString);
+    bool accepted = true;
+    while (length > 0) {
+        size_t count = min(length, sizeof(outgoing.data));
+        outgoing.type = RECORD_NMEA;
+        outgoing.length = count;
+        memcpy(outgoing.data, data, count);
+        outgoing.fix.sequence = 0;
+        if (fix != nullptr && count == length) {
+            outgoing.fix = *fix;
+        }
+        accepted &= enqueue(outgoing, nullptr, nullptr);
+        data += count;
+        length -= count;
+    }
+    return accepted;
+}
+
+bool TCPLogger::sendRawNMEA(const String& nmeaData, const GPSParser::Fix* fix) {
+    return sendRawNMEA((const uint8_t*)nmeaData.c_str(), nmeaData.length(), fix);
+}
+
+void TCPLogger::process() {
+    while (true) {
+        // A record taken from the queue waits here until its batch has room
+        if (!hasPending) {
+            if (!queue.pop(pending)) {
+                break;
+            }
+            hasPending = true;
+        }
+        Batch& batch = (pending.type == RECORD_LOG) ? logBatch : nmeaBatch;
+        if (!append(batch, pending)) {
+            if (!flush(batch)) {
+                return;
+            }
+            continue;
+        }
+        hasPending = false;
+        
+        if ((batch.length >= batchBytes || batch.records >= batchRecords) && !flush(batch)) {
+            return;
+        }
+    }
     
-    if (httpResponseCode > 0) {
-        http.end();
-        return true;
-    } else {
-        Serial.print("Error code: ");
-        Serial.println(httpResponseCode);
-        http.end();
-        return false;
+    // Batches that are old enough go out even when small
+    if (logBatch.records > 0 && millis() - logBatch.started >= batchInterval) {
+        flush(logBatch);
+    }
+    if (nmeaBatch.records > 0 && millis() - nmeaBatch.started >= batchInterval) {
+        flush(nmeaBatch);
     }
 }
 
-bool TCPLogger::sendRawNMEA(const String& nmeaData) {
-    if (!ensureConnected()) {
+bool TCPLogger::append(Batch& batch, const Record& record) {
+    // Log records are elements of a JSON array: "[" or "," before each, "]" at the end
+    bool isLog = record.type == RECORD_LOG;
+    size_t needed = record.length + (isLog ? 2 : 0);
+    if (batch.length + needed > min(batchBytes, sizeof(batch.data)) && batch.records > 0) {
         return false;
     }
+    if (batch.length + needed > sizeof(batch.data)) {
+        // A partial line left over from the last batch that is this long is no NMEA
+        batch.length = 0;
+    }
     
-    // Create the full URL
-    String url = "http://" + serverAddress + ":" + String(serverPort) + NMEA_ENDPOINT;
-    
-    // Send HTTP POST request with raw NMEA data
-    HTTPClient http;
-    http.begin(url);
-    http.addHeader("Content-Type", "text/plain");
+    if (batch.records == 0) {
+        batch.started = millis();
+    }
+    if (isLog) {
+        batch.data[batch.length++] = (batch.records == 0) ? '[' : ',';
+    }
+    memcpy(batch.data + batch.length, record.data, record.length);
+    batch.length += record.length;
+    batch.records++;
+    if (!isLog && record.fix.sequence != 0) {
+        batch.fix = record.fix;
+    }
+    return true;
+}
+
+bool TCPLogger::flush(Batch& batch) {
+    if (batch.records == 0) {
+        return true;
+    }
+    if (!ensureConnected(batch)) {
+        return false;
+    }
     
-    int httpResponseCode = http.POST(nmeaData);
+    // NMEA goes as whole lines, the start of a line waits for the rest
+    bool isLog = &batch == &logBatch;
+    size_t length = batch.length;
+    if (isLog) {
+        batch.data[length++] = ']';
+    }
+    else {
+        while (length > 0 && batch.data[length - 1] != '\n') {
+            length--;
+        }
+        if (length == 0) {
+            // No line end at all, e.g. UBX: all of it
+            length = batch.length;
+        }
+    }
     
-    if (httpResponseCode > 0) {
-        http.end();
-        return true;
-    } else {
-        Serial.print("NMEA Error code: ");
+    int httpResponseCode = batch.connection.post((const uint8_t*)batch.data, length);
+    requests++;
+    if (httpResponseCode <= 0) {
+        // The batch stays and goes again after the reconnect interval, until
+        // then records wait in the queue and the overflow policy decides
+        failed++;
+        connected = false;
+        lastReconnectAttempt = max(millis(), 1UL);
+        Serial.print(isLog ? "Error code: " : "NMEA Error code: ");
         Serial.println(httpResponseCode);
-        http.end();
         return false;
     }
+    sent += batch.records;
+    if (!isLog && batch.fix.sequence != 0 && latencyParser != nullptr) {
+        latencyParser->recordLatency(GPSParser::LATENCY_UPLOAD, batch.fix);
+        batch.fix.sequence = 0;
+    }
+    
+    // The partial line starts the next batch, which is due once a record follows
+    size_t rest = isLog ? 0 : batch.length - length;
+    memmove(batch.data, batch.data + length, rest);
+    batch.length = rest;
+    batch.records = 0;
+    return true;
+}
+
+uint32_t TCPLogger::idleWait() {
+    // Until the older batch is due, or the next reconnection attempt
+    if (!connected) {
+        return TCP_LOGGER_IDLE_WAIT;
+    }
+    uint32_t wait = TCP_LOGGER_IDLE_WAIT;
+    const Batch* batches[] = { &logBatch, &nmeaBatch };
+    for (size_t i = 0; i < 2; i++) {
+        if (batches[i]->records > 0) {
+            uint32_t age = millis() - batches[i]->started;
+            wait = min(wait, age < batchInterval ? batchInterval - age : (uint32_t)0);
+        }
+    }
+    return max(wait, (uint32_t)TCP_LOGGER_MIN_WAIT);
+}
+
+TCPLogger::Stats TCPLogger::getStats() const {
+    Stats stats;
+    stats.queued = queued;
+    stats.sent = sent;
+    stats.failed = failed;
+    stats.requests = requests;
+    stats.droppedOldest = droppedOldest;
+    stats.droppedNewest = droppedNewest;
+    stats.coalesced = coalesced;
+    stats.waiting = queue.size();
+    stats.connects = logBatch.connection.getConnects() + nmeaBatch.connection.getConnects();
+    return stats;
 }
 
 bool TCPLogger::logInfo(const String& message) {
@@ -104,4 +362,4 @@ bool TCPLogger::logError(const String& message) {
 
 bool TCPLogger::logDebug(const String& message) {
     return log(message, "DEBUG");
-}
\ No newline at end of file
+}
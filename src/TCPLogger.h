@@ -3,15 +3,92 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
-#include <HTTPClient.h>
-#include <ArduinoJson.h>
+#include <atomic>
+#include "LogFormat.h"
+#include "GPSClock.h"
+#include "MPMCRing.h"
+#include "HTTPConnection.h"
 
+// Records waiting to be sent, a power of two
+#define TCP_LOGGER_QUEUE_SIZE 16
+#define TCP_LOGGER_RECORD_SIZE LOG_RECORD_MAX_LENGTH
+
+// Sender task, next to the GPS task on core 0 but below it, HTTP may block for seconds
+#define TCP_LOGGER_TASK_CORE 0
+#define TCP_LOGGER_TASK_PRIORITY 1
+#define TCP_LOGGER_TASK_STACK_SIZE 8192
+#define TCP_LOGGER_IDLE_WAIT 1000      // ms, looks at the queue and WiFi at least this often
+
+#define TCP_LOGGER_COALESCED_MESSAGE 160  // Characters kept of the last coalesced message
+
+// Batching: records are collected per endpoint and sent as one request once
+// the batch holds this many bytes or records, or is this old
+#define TCP_LOGGER_BATCH_SIZE 4096        // Buffer per endpoint, the largest possible batch
+#define TCP_LOGGER_BATCH_BYTES 3072
+#define TCP_LOGGER_BATCH_RECORDS 32
+#define TCP_LOGGER_BATCH_INTERVAL 1000    // ms
+#define TCP_LOGGER_MIN_WAIT 10            // ms, shortest sleep of the sender task
+
+// Logs to the HTTP server without blocking the caller: log() and
+// sendRawNMEA() format the record into a lock-free queue and return, a
+// background task collects the records into batches and sends each batch
+// over one keep-alive connection per endpoint. Log records go to /api/log as
+// a JSON array, NMEA to /api/nmea as whole lines. While the server or WiFi is
+// down a batch that could not be sent is kept, records wait in the queue
+// behind it, and once the queue is full the overflow policy decides.
 class TCPLogger {
+public:
+    enum OverflowPolicy {
+        DROP_OLDEST,  // Make room by discarding the oldest queued record
+        DROP_NEWEST,  // Discard the new record
+        COALESCE      // Count new log records and queue one summary once there is room.
+                      // Raw NMEA cannot be summarized and is dropped as the newest.
+    };
+    
+    struct Stats {
+        uint32_t queued;
+        uint32_t sent;
+        uint32_t failed;          // Requests the server did not answer, their batch is sent again
+        uint32_t requests;        // Batches sent, both endpoints
+        uint32_t droppedOldest;
+        uint32_t droppedNewest;
+        uint32_t coalesced;
+        uint32_t waiting;         // Records in the queue right now
+        uint32_t connects;        // Connections opened to the server, both endpoints
+    };
+
 private:
+    enum RecordType : uint8_t {
+        RECORD_LOG,
+        RECORD_NMEA
+    };
+    
+    struct Record {
+        RecordType type;
+        uint16_t length;
+        char data[TCP_LOGGER_RECORD_SIZE];
+        GPSParser::Fix fix;  // NMEA only, the fix the data ends with for the upload latency
+    };
+    
+    // Records collected for one endpoint, and its connection
+    struct Batch {
+        Batch(const String& server, uint16_t port, const String& path, const char* contentType);
+        
+        WiFiClient client;
+        HTTPConnection connection;
+        char data[TCP_LOGGER_BATCH_SIZE];
+        size_t length;
+        uint16_t records;
+        unsigned long started;   // millis() of the first record
+        GPSParser::Fix fix;      // Latest fix in the data, NMEA only
+    };
+    
     String serverAddress;
     uint16_t serverPort;
     String deviceName;
     bool connected;
+    GPSClock* clock;
+    GPSParser* latencyParser;
     unsigned long lastReconnectAttempt;
     const unsigned long RECONNECT_INTERVAL = 5000; // 5 seconds between reconnection attempts
     
@@ -19,22 +96,90 @@ private:
     const String LOG_ENDPOINT = "/api/log";
     const String NMEA_ENDPOINT = "/api/nmea";
     
-    bool ensureConnected();
+    // Sender side: the batches and the record being added
+    Batch logBatch;
+    Batch nmeaBatch;
+    Record pending;
+    bool hasPending;
+    size_t batchBytes;
+    uint16_t batchRecords;
+    uint32_t batchInterval;
+    
+    MPMCRing<Record, TCP_LOGGER_QUEUE_SIZE> queue;
+    OverflowPolicy policy;
+    
+    // Producer side scratch records, kept off the caller's stack
+    Record outgoing;
+    Record discarded;
+    
+    // Log records coalesced since the queue was last full, producer side only
+    uint32_t coalescePending;
+    char coalescedLevel[8];
+    char coalescedMessage[TCP_LOGGER_COALESCED_MESSAGE];
+    
+    std::atomic<uint32_t> queued;
+    std::atomic<uint32_t> sent;
+    std::atomic<uint32_t> failed;
+    std::atomic<uint32_t> requests;
+    std::atomic<uint32_t> droppedOldest;
+    std::atomic<uint32_t> droppedNewest;
+    std::atomic<uint32_t> coalesced;
+
+#ifdef ARDUINO_ARCH_ESP32
+    TaskHandle_t task;
+    static void run(void* logger);
+#endif
+
+    bool ensureConnected(Batch& batch);
+    bool formatRecord(Record& record, const char* level, const char* message);
+    bool enqueue(const Record& record, const char* level, const char* message);
+    void flushCoalesced();
+    bool append(Batch& batch, const Record& record);
+    bool flush(Batch& batch);
+    uint32_t idleWait();
 
 public:
     // Constructor now accepts configuration parameters directly
     TCPLogger(const String& server, uint16_t port, const String& device);
     ~TCPLogger();
-
+    
+    // Start the sender task. False if it could not be started, then call
+    // process() from the loop instead.
     bool begin();
+    
+    // Stamp records with UTC from this clock once it is synchronized, uptime before
+    void setClock(GPSClock* gpsClock);
+    
+    // Record the upload stage of the fix age in this parser when NMEA data
+    // that carries a fix has been sent
+    void setLatencyParser(GPSParser* parser);
+    
+    void setOverflowPolicy(OverflowPolicy overflowPolicy) { policy = overflowPolicy; }
+    OverflowPolicy getOverflowPolicy() const { return policy; }
+    
+    // Send a batch at this many bytes (up to TCP_LOGGER_BATCH_SIZE) or
+    // records, or when its first record is this many ms old. Before begin().
+    void setBatching(size_t bytes, uint16_t records, uint32_t intervalMs);
+    
+    // Queue a record. True if it was queued or coalesced, false if it was
+    // dropped. Call from one task at a time.
     bool log(const String& message, const String& level = "INFO");
     bool logInfo(const String& message);
     bool logWarning(const String& message);
     bool logError(const String& message);
     bool logDebug(const String& message);
     
-    // New method to send raw NMEA data
-    bool sendRawNMEA(const String& nmeaData);
+    // Queue raw NMEA data as it arrives, in records of up to
+    // TCP_LOGGER_RECORD_SIZE. Partial lines are completed by the next call.
+    // The fix, if given, is the latest one in the data.
+    bool sendRawNMEA(const uint8_t* data, size_t length, const GPSParser::Fix* fix = nullptr);
+    bool sendRawNMEA(const String& nmeaData, const GPSParser::Fix* fix = nullptr);
+    
+    // Batch the queued records and send the batches that are due while the
+    // network is up, the sender task's work
+    void process();
+    
+    Stats getStats() const;
 };
 
-#endif // TCP_LOGGER_H
\ No newline at end of file
+#endif // TCP_LOGGER_H
@@ -0,0 +1,209 @@
+#include "UBXParser.h"
+
+// Little endian field access into a payload
+static uint16_t readU16(const uint8_t* p) {
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static uint32_t readU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int32_t readI32(const uint8_t* p) {
+    return (int32_t)readU32(p);
+}
+
+UBXParser::UBXParser() {
+}
+
+UBXParser::Result UBXParser::processByte(uint8_t b) {
+    switch (state) {
+        case STATE_SYNC1:
+            if (b != UBX_SYNC_CHAR_1) {
+                return UBX_IDLE;
+            }
+            state = STATE_SYNC2;
+            return UBX_BUSY;
+        
+        case STATE_SYNC2:
+            if (b != UBX_SYNC_CHAR_2) {
+                // Not a frame after all, let the caller handle the byte
+                state = STATE_SYNC1;
+                return UBX_IDLE;
+            }
+            ckA = 0;
+            ckB = 0;
+            state = STATE_CLASS;
+            return UBX_BUSY;
+        
+        case STATE_CLASS:
+            msgClass = b;
+            addToChecksum(b);
+            state = STATE_ID;
+            return UBX_BUSY;
+        
+        case STATE_ID:
+            msgId = b;
+            addToChecksum(b);
+            state = STATE_LENGTH1;
+            return UBX_BUSY;
+        
+        case STATE_LENGTH1:
+            payloadLength = b;
+            addToChecksum(b);
+            state = STATE_LENGTH2;
+            return UBX_BUSY;
+        
+        case STATE_LENGTH2:
+            payloadLength |= (uint16_t)b << 8;
+            addToChecksum(b);
+            if (payloadLength > UBX_MAX_PAYLOAD) {
+                // Either a message we cannot hold or a corrupted length, resynchronise
+                framesOverflowed++;
+                state = STATE_SYNC1;
+                return UBX_BUSY;
+            }
+            payloadIndex = 0;
+            state = (payloadLength > 0) ? STATE_PAYLOAD : STATE_CK_A;
+            return UBX_BUSY;
+        
+        case STATE_PAYLOAD:
+            payload[payloadIndex++] = b;
+            addToChecksum(b);
+            if (payloadIndex >= payloadLength) {
+                state = STATE_CK_A;
+            }
+            return UBX_BUSY;
+        
+        case STATE_CK_A:
+            receivedCkA = b;
+            state = STATE_CK_B;
+            return UBX_BUSY;
+        
+        case STATE_CK_B:
+            state = STATE_SYNC1;
+            if (receivedCkA != ckA || b != ckB) {
+                framesRejected++;
+                return UBX_BUSY;
+            }
+            framesAccepted++;
+            return UBX_FRAME_READY;
+    }
+    
+    state = STATE_SYNC1;
+    return UBX_IDLE;
+}
+
+bool UBXParser::decodeNavPvt(NavPvt& pvt) const {
+    if (!isMessage(UBX_CLASS_NAV, UBX_NAV_PVT) || payloadLength < 92) {
+        return false;
+    }
+    
+    pvt.iTOW = readU32(&payload[0]);
+    pvt.year = readU16(&payload[4]);
+    pvt.month = payload[6];
+    pvt.day = payload[7];
+    pvt.hour = payload[8];
+    pvt.minute = payload[9];
+    pvt.second = payload[10];
+    pvt.valid = payload[11];
+    pvt.nano = readI32(&payload[16]);
+    pvt.fixType = payload[20];
+    pvt.flags = payload[21];
+    pvt.numSV = payload[23];
+    pvt.lon = readI32(&payload[24]);
+    pvt.lat = readI32(&payload[28]);
+    pvt.height = readI32(&payload[32]);
+    pvt.hMSL = readI32(&payload[36]);
+    pvt.gSpeed = readI32(&payload[60]);
+    pvt.headMot = readI32(&payload[64]);
+    pvt.pDOP = readU16(&payload[76]);
+    return true;
+}
+
+bool UBXParser::decodeNavDop(NavDop& dop) const {
+    if (!isMessage(UBX_CLASS_NAV, UBX_NAV_DOP) || payloadLength < 18) {
+        return false;
+    }
+    
+    dop.iTOW = readU32(&payload[0]);
+    dop.gDOP = readU16(&payload[4]);
+    dop.pDOP = readU16(&payload[6]);
+    dop.tDOP = readU16(&payload[8]);
+    dop.vDOP = readU16(&payload[10]);
+    dop.hDOP = readU16(&payload[12]);
+    return true;
+}
+
+uint32_t UBXParser::getNavSatITOW() const {
+    if (!isMessage(UBX_CLASS_NAV, UBX_NAV_SAT) || payloadLength < 8) {
+        return 0;
+    }
+    return readU32(&payload[0]);
+}
+
+int UBXParser::getNavSatCount() const {
+    // Header of 8 bytes followed by 12 bytes per satellite
+    if (!isMessage(UBX_CLASS_NAV, UBX_NAV_SAT) || payloadLength < 8) {
+        return 0;
+    }
+    int count = payload[5];
+    int fits = (payloadLength - 8) / 12;
+    return (count < fits) ? count : fits;
+}
+
+bool UBXParser::decodeNavSatellite(int index, NavSatellite& sat) const {
+    if (index < 0 || index >= getNavSatCount()) {
+        return false;
+    }
+    
+    const uint8_t* p = &payload[8 + index * 12];
+    sat.gnssId = p[0];
+    sat.svId = p[1];
+    sat.cno = p[2];
+    sat.elevation = (int8_t)p[3];
+    sat.azimuth = (int16_t)readU16(&p[4]);
+    sat.used = (readU32(&p[8]) & 0x08) != 0;
+    return true;
+}
+
+UBXParser::Stats UBXParser::getStats() const {
+    Stats stats;
+    stats.accepted = framesAccepted;
+    stats.rejected = framesRejected;
+    stats.overflowed = framesOverflowed;
+    return stats;
+}
+
+void UBXParser::resetStats() {
+    framesAccepted = 0;
+    framesRejected = 0;
+    framesOverflowed = 0;
+}
+
+size_t UBXParser::buildFrame(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t length,
+                             uint8_t* out, size_t capacity) {
+    if (capacity < (size_t)length + UBX_FRAME_OVERHEAD) {
+        return 0;
+    }
+    
+    out[0] = UBX_SYNC_CHAR_1;
+    out[1] = UBX_SYNC_CHAR_2;
+    out[2] = cls;
+    out[3] = id;
+    out[4] = length & 0xFF;
+    out[5] = length >> 8;
+    if (length > 0) {
+        memcpy(&out[6], payload, length);
+    }
+    
+    // Checksum covers everything after the sync characters
+    uint8_t a = 0, b = 0;
+    for (size_t i = 2; i < (size_t)length + 6; i++) {
+        a += out[i];
+        b += a;
+    }
+    out[length + 6] = a;
+    out[length + 7] = b;
+    return length + UBX_FRAME_OVERHEAD;
+}
@@ -0,0 +1,157 @@
+#ifndef UBX_PARSER_H
+#define UBX_PARSER_H
+
+#include <Arduino.h>
+
+// u-blox UBX binary protocol framing:
+// 0xB5 0x62, class, id, length (little endian), payload, CK_A, CK_B
+#define UBX_SYNC_CHAR_1 0xB5
+#define UBX_SYNC_CHAR_2 0x62
+#define UBX_FRAME_OVERHEAD 8
+#define UBX_MAX_PAYLOAD 3068 // NAV-SAT with 255 satellites, the most its count field holds
+
+// Message classes and IDs
+#define UBX_CLASS_NAV 0x01
+#define UBX_CLASS_ACK 0x05
+#define UBX_CLASS_CFG 0x06
+#define UBX_CLASS_MON 0x0A
+#define UBX_CLASS_NMEA 0xF0  // Standard NMEA sentences in CFG-MSG
+
+#define UBX_NAV_DOP 0x04
+#define UBX_NAV_PVT 0x07
+#define UBX_NAV_SAT 0x35
+#define UBX_ACK_NAK 0x00
+#define UBX_ACK_ACK 0x01
+#define UBX_MON_VER 0x04
+#define UBX_CFG_PRT 0x00
+#define UBX_CFG_MSG 0x01
+#define UBX_CFG_RATE 0x08
+#define UBX_CFG_VALSET 0x8A
+#define UBX_CFG_VALGET 0x8B
+
+class UBXParser {
+public:
+    enum Result : uint8_t {
+        UBX_IDLE = 0,     // Byte is not part of a UBX frame
+        UBX_BUSY,         // Byte consumed, frame not complete yet
+        UBX_FRAME_READY   // Byte completed a frame with a valid checksum
+    };
+    
+    // GNSS identifiers used in NAV-SAT
+    enum GnssId : uint8_t {
+        GNSS_ID_GPS = 0,
+        GNSS_ID_SBAS = 1,
+        GNSS_ID_GALILEO = 2,
+        GNSS_ID_BEIDOU = 3,
+        GNSS_ID_QZSS = 5,
+        GNSS_ID_GLONASS = 6
+    };
+    
+    // Navigation position velocity time solution (NAV-PVT)
+    struct NavPvt {
+        uint32_t iTOW;        // GPS time of week of the navigation epoch (ms)
+        uint16_t year;
+        uint8_t month;
+        uint8_t day;
+        uint8_t hour;
+        uint8_t minute;
+        uint8_t second;
+        uint8_t valid;        // Bit 0: date valid, bit 1: time valid
+        int32_t nano;         // Fraction of second (ns), may be negative
+        uint8_t fixType;      // 0=no fix, 1=dead reckoning, 2=2D, 3=3D, 4=GNSS+DR, 5=time only
+        uint8_t flags;        // Bit 0: gnssFixOK, bit 1: differential corrections applied
+        uint8_t numSV;
+        int32_t lon;          // 1e-7 degree
+        int32_t lat;          // 1e-7 degree
+        int32_t height;       // Height above ellipsoid (mm)
+        int32_t hMSL;         // Height above mean sea level (mm)
+        int32_t gSpeed;       // Ground speed (mm/s)
+        int32_t headMot;      // Heading of motion (1e-5 degree)
+        uint16_t pDOP;        // 0.01
+    };
+    
+    // Dilution of precision (NAV-DOP), all scaled by 0.01
+    struct NavDop {
+        uint32_t iTOW;
+        uint16_t gDOP;
+        uint16_t pDOP;
+        uint16_t tDOP;
+        uint16_t vDOP;
+        uint16_t hDOP;
+    };
+    
+    // One satellite of a NAV-SAT message
+    struct NavSatellite {
+        uint8_t gnssId;
+        uint8_t svId;
+        uint8_t cno;          // Carrier to noise ratio (dBHz)
+        int8_t elevation;     // degrees, -91 when unknown
+        int16_t azimuth;      // degrees
+        bool used;            // Used in the navigation solution
+    };
+    
+    struct Stats {
+        uint32_t accepted;    // Frames with a valid checksum
+        uint32_t rejected;    // Checksum mismatch
+        uint32_t overflowed;  // Announced payload larger than the buffer
+    };
+    
+    UBXParser();
+    
+    Result processByte(uint8_t b);
+    bool isInFrame() const { return state != STATE_SYNC1; }
+    
+    // Last complete frame
+    uint8_t getClass() const { return msgClass; }
+    uint8_t getId() const { return msgId; }
+    uint16_t getLength() const { return payloadLength; }
+    const uint8_t* getPayload() const { return payload; }
+    
+    // Length-checked decoding of the last frame, false if it is not of that type
+    bool decodeNavPvt(NavPvt& pvt) const;
+    bool decodeNavDop(NavDop& dop) const;
+    uint32_t getNavSatITOW() const;
+    int getNavSatCount() const;
+    bool decodeNavSatellite(int index, NavSatellite& sat) const;
+    
+    Stats getStats() const;
+    void resetStats();
+    
+    // Build a complete frame into out, returns its length or 0 if it does not fit
+    static size_t buildFrame(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t length,
+                             uint8_t* out, size_t capacity);
+
+private:
+    enum State : uint8_t {
+        STATE_SYNC1 = 0,
+        STATE_SYNC2,
+        STATE_CLASS,
+        STATE_ID,
+        STATE_LENGTH1,
+        STATE_LENGTH2,
+        STATE_PAYLOAD,
+        STATE_CK_A,
+        STATE_CK_B
+    };
+    
+    State state = STATE_SYNC1;
+    uint8_t msgClass = 0;
+    uint8_t msgId = 0;
+    uint16_t payloadLength = 0;
+    uint16_t payloadIndex = 0;
+    uint8_t payload[UBX_MAX_PAYLOAD];
+    
+    // Fletcher checksum over class, id, length and payload, computed as bytes arrive
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+    uint8_t receivedCkA = 0;
+    
+    uint32_t framesAccepted = 0;
+    uint32_t framesRejected = 0;
+    uint32_t framesOverflowed = 0;
+    
+    void addToChecksum(uint8_t b) { ckA += b; ckB += ckA; }
+    bool isMessage(uint8_t cls, uint8_t id) const { return msgClass == cls && msgId == id; }
+};
+
+#endif // UBX_PARSER_H
@@ -6,6 +6,6 @@
 // Auto-generated config file - DO NOT EDIT
 // Edit config.yaml instead
 
-const char* CONFIG_JSON = "{\"wifi\": {\"ssid\": \"H369A6B77CF\", \"password\": \"Spanning!\", \"hostname\": \"GPS-ESP32\"}, \"logger\": {\"server\": \"192.168.2.7\", \"port\": 5000}}";
+const char* CONFIG_JSON = "{\"wifi\": {\"ssid\": \"H369A6B77CF\", \"password\": \"Spanning!\", \"hostname\": \"GPS-ESP32\"}, \"logger\": {\"server\": \"192.168.2.7\", \"port\": 5000, \"overflow\": \"oldest\", \"nmea\": \"http\"}, \"udp\": {\"address\": \"\", \"port\": 10110, \"mode\": \"epoch\"}, \"gps\": {\"source\": \"uart\", \"protocol\": \"auto\", \"autoconfig\": true, \"baud\": 115200, \"rate\": 5}}";
 
 #endif // CONFIG_H
@@ -16,11 +16,18 @@
 // include the installed the "XPT2046_Touchscreen" library by Paul Stoffregen to use the Touchscreen - https://github.com/PaulStoffregen/XPT2046_Touchscreen
 #include <XPT2046_Touchscreen.h>
 
-// Include our GPS parser
+// Include our GPS parser and receiver setup
 #include "GPSParser.h"
+#include "GPSConfigurator.h"
+#include "GPSSource.h"
+#include "GPSClock.h"
+#include "GPSFilter.h"
+#include "GPSTask.h"
 
 // Include our TCP logger
 #include "TCPLogger.h"
+#include "NMEAStream.h"
+#include "NMEAUdp.h"
 
 // Include auto-generated config
 #include "config.h"
@@ -33,6 +40,21 @@ String hostname;
 // Logger configuration (will be loaded from config)
 String loggerServer;
 uint16_t loggerPort;
+String loggerOverflow = "oldest";
+String loggerNmea = "http";
+uint16_t loggerStreamPort = 0;
+
+// NMEA over UDP for chartplotters (will be loaded from config), off without an address
+String udpAddress = "";
+uint16_t udpPort = NMEA_UDP_PORT;
+String udpMode = "epoch";
+
+// GPS configuration (will be loaded from config)
+String gpsProtocol = "auto";
+String gpsSourceName = "uart";
+uint32_t gpsBaud;
+uint16_t gpsRate;
+bool gpsAutoConfig;
 
 // Create a instance of the TFT_eSPI class
 TFT_eSPI tft = TFT_eSPI();
@@ -40,6 +62,12 @@ TFT_eSPI tft = TFT_eSPI();
 // Create an instance of our TCP logger (will be initialized after loading config)
 TCPLogger* logger = nullptr;
 
+// Raw NMEA over plain TCP instead of HTTP, when configured
+NMEAStream* nmeaStream = nullptr;
+
+// NMEA to the navigation apps on the LAN, when configured
+NMEAUdp* nmeaUdp = nullptr;
+
 // Set the pius of the xpt2046 touchscreen
 #define XPT2046_IRQ 36  // T_IRQ
 #define XPT2046_MOSI 32 // T_DIN
@@ -69,17 +97,45 @@ int centerY;
 // Set the RX and TX pins for the GPS module
 #define RXD2 22
 #define TXD2 27
-// Set the baud rate for the GPS module
+// Default baud rate and navigation rate (Hz) for the GPS module
 #define GPS_BAUD 9600
+#define GPS_RATE 1
 // Create a instance of the HardwareSerial class
 HardwareSerial gpsSerial(2);
+SerialGPSPort gpsPort(gpsSerial, RXD2, TXD2);
+GPSConfigurator::Result gpsSetup;
+
+// Where the parser input comes from: the receiver, or a simulated drive when
+// testing without one
+PortGPSSource uartSource(gpsPort);
+GPSSource* gpsSource = &uartSource;
+#define GPS_SIMULATION_SPEED 15  // m/s
+static const SyntheticGPSSource::Waypoint gpsSimulationRoute[] = {
+  { 520907392, 50728783 }, { 520950000, 50728783 }, { 520950000, 50800000 }, { 520907392, 50800000 }
+};
 
 // Create an instance of our GPS parser
 GPSParser gpsParser;
 
+// UTC clock set from the fixes, for the log time stamps and the system clock
+GPSClock gpsClock;
+
+// Reads and parses the GPS on core 0, the loop takes the fixes from its queues
+GPSTask gpsTask(gpsParser, gpsSource);
+bool gpsTaskRunning = false;
+
+// Without its sender task the logger is drained from the loop
+bool loggerHttp = true;
+bool loggerTaskRunning = false;
+
+// Smoothed position and velocity, predicted between fixes for the animated screens
+GPSFilter gpsFilter;
+
 // Display update timer
 unsigned long lastDisplayUpdate = 0;
 const unsigned long DISPLAY_UPDATE_INTERVAL = 1000; // Update display every second
+unsigned long lastAnimation = 0;
+const unsigned long ANIMATION_INTERVAL = 40; // Move the compass and track screens at 25 Hz
 
 // OTA status flag
 bool otaInProgress = false;
@@ -112,12 +168,36 @@ bool loadConfig() {
     JsonObject loggerConfig = doc["logger"];
     loggerServer = loggerConfig["server"].as<String>();
     loggerPort = loggerConfig["port"].as<uint16_t>();
+    loggerOverflow = loggerConfig["overflow"] | "oldest";
+    loggerNmea = loggerConfig["nmea"] | "http";
+    loggerStreamPort = loggerConfig["stream_port"] | loggerPort;
   } else {
     Serial.println("Logger configuration not found, using defaults");
     loggerServer = "192.168.1.100";
     loggerPort = 8080;
   }
   
+  // Extract GPS settings
+  gpsBaud = GPS_BAUD;
+  gpsRate = GPS_RATE;
+  gpsAutoConfig = false;
+  if (doc.containsKey("gps")) {
+    JsonObject gpsConfig = doc["gps"];
+    gpsProtocol = gpsConfig["protocol"] | "auto";
+    gpsSourceName = gpsConfig["source"] | "uart";
+    gpsBaud = gpsConfig["baud"] | GPS_BAUD;
+    gpsRate = constrain(gpsConfig["rate"] | GPS_RATE, 1, 10);
+    gpsAutoConfig = gpsConfig["autoconfig"] | false;
+  }
+  
+  // Extract UDP output settings
+  if (doc.containsKey("udp")) {
+    JsonObject udpConfig = doc["udp"];
+    udpAddress = udpConfig["address"] | "";
+    udpPort = udpConfig["port"] | NMEA_UDP_PORT;
+    udpMode = udpConfig["mode"] | "epoch";
+  }
+  
   return true;
 }
 
@@ -137,29 +217,39 @@ void logTouchData(int posX, int posY, int pressure)
 
 void updateGPSDisplay()
 {
+  // Take one snapshot so that all values come from the same fix
+  GPSParser::Fix fix;
+  gpsParser.getFix(fix);
+  
   // Clear the data area
   tft.fillRect(0, 60, SCREEN_WIDTH, 130, TFT_BLACK);
   
   // Display GPS data
   tft.setTextColor(TFT_GREEN, TFT_BLACK);
-  tft.drawString("Position: " + gpsParser.getPositionString(), 10, 60);
+  char position[GPS_POSITION_TEXT_SIZE];
+  char text[64];
+  gpsParser.formatPosition(fix, position, sizeof(position));
+  snprintf(text, sizeof(text), "Position: %s", position);
+  tft.drawString(text, 10, 60);
   
   tft.setTextColor(TFT_YELLOW, TFT_BLACK);
-  tft.drawString("Speed: " + String(gpsParser.getSpeed()) + " knots", 10, 80);
-  tft.drawString("Course: " + String(gpsParser.getCourse()) + " deg", 10, 100);
+  tft.drawString("Speed: " + String(fix.speed) + " knots", 10, 80);
+  tft.drawString("Course: " + String(fix.course) + " deg", 10, 100);
   
   tft.setTextColor(TFT_CYAN, TFT_BLACK);
-  tft.drawString("Time: " + gpsParser.getTimeString(), 10, 120);
-  tft.drawString("Date: " + gpsParser.getDateString(), 10, 140);
+  size_t length = snprintf(text, sizeof(text), "Time: ");
+  gpsParser.formatTime(fix, text + length, sizeof(text) - length);
+  tft.drawString(text, 10, 120);
+  length = snprintf(text, sizeof(text), "Date: ");
+  gpsParser.formatDate(fix, text + length, sizeof(text) - length);
+  tft.drawString(text, 10, 140);
   
   tft.setTextColor(TFT_MAGENTA, TFT_BLACK);
-  tft.drawString("Satellites: " + String(gpsParser.getSatellites()), 10, 160);
+  tft.drawString("Satellites: " + String(fix.satellites), 10, 160);
   
   // Log GPS update
-  String logMessage = "GPS Update: Pos=" + gpsParser.getPositionString() + 
-                     ", Speed=" + String(gpsParser.getSpeed()) + 
-                     ", Sats=" + String(gpsParser.getSatellites());
-  logger->logInfo(logMessage);
+  snprintf(text, sizeof(text), "GPS Update: Pos=%s, Speed=%.2f, Sats=%d", position, fix.speed, fix.satellites);
+  logger->logInfo(text);
 }
 
 void setupOTA() {
@@ -297,6 +387,26 @@ void setup()
   
   // Initialize the logger with the loaded configuration
   logger = new TCPLogger(loggerServer, loggerPort, hostname);
+  logger->setClock(&gpsClock);
+  logger->setLatencyParser(&gpsParser);
+  
+  // The clock needs the date whatever the screen shows, a stale one after
+  // midnight would step it back a day
+  gpsParser.subscribe(GPSClock::FIELDS);
+  
+  // What to do with new records while the server is unreachable and the queue is full
+  if (loggerOverflow == "newest") {
+    logger->setOverflowPolicy(TCPLogger::DROP_NEWEST);
+  } else if (loggerOverflow == "coalesce") {
+    logger->setOverflowPolicy(TCPLogger::COALESCE);
+  } else {
+    logger->setOverflowPolicy(TCPLogger::DROP_OLDEST);
+  }
+  
+  // Stream the raw NMEA to the server over plain TCP, every sentence as it arrives
+  if (loggerNmea == "stream") {
+    nmeaStream = new NMEAStream(loggerServer, loggerStreamPort);
+  }
 
   // Start the touchscreen component and init the touchscreen
   touchscreenSPI.begin(XPT2046_CLK, XPT2046_MISO, XPT2046_MOSI, XPT2046_CS);
@@ -305,8 +415,46 @@ void setup()
   // Set the Touchscreen rotation in landscape mode
   touchscreen.setRotation(1);
 
-  // Start the GPS module
-  gpsSerial.begin(GPS_BAUD, SERIAL_8N1, RXD2, TXD2);
+  // Select the protocol the receiver sends: NMEA, UBX or both
+  if (gpsProtocol == "nmea") {
+    gpsParser.setProtocol(GPSParser::PROTOCOL_NMEA);
+  } else if (gpsProtocol == "ubx") {
+    gpsParser.setProtocol(GPSParser::PROTOCOL_UBX);
+  } else {
+    gpsParser.setProtocol(GPSParser::PROTOCOL_AUTO);
+  }
+
+  // Start the GPS module, optionally bringing it to the configured baud rate and navigation rate
+  if (gpsSourceName == "synthetic") {
+    SyntheticGPSSource::Settings settings = SyntheticGPSSource::defaultSettings();
+    settings.route = gpsSimulationRoute;
+    settings.waypoints = sizeof(gpsSimulationRoute) / sizeof(gpsSimulationRoute[0]);
+    settings.speed = GPS_SIMULATION_SPEED;
+    settings.rateHz = gpsRate;
+    gpsSource = new SyntheticGPSSource(settings);
+    Serial.printf("GPS: simulated drive at %u Hz\n", gpsRate);
+  } else if (gpsAutoConfig) {
+    // On the heap, its UBX frame buffer is too large for the loop task stack
+    GPSConfigurator* configurator = new GPSConfigurator(gpsPort);
+    GPSConfigurator::Settings settings;
+    settings.baud = gpsBaud;
+    settings.rateMs = 1000 / gpsRate;
+    settings.protocol = gpsParser.getProtocol();
+    gpsSetup = configurator->configure(settings);
+    delete configurator;
+    Serial.printf("GPS: %s receiver at %lu baud, %u ms, %s\n", GPSConfigurator::getChipsetName(gpsSetup.chipset),
+                  (unsigned long)gpsSetup.baud, gpsSetup.rateMs,
+                  gpsSetup.verified ? "verified" : (gpsSetup.detectedBaud == 0 ? "not found" : "not verified"));
+  } else {
+    gpsPort.setBaud(gpsBaud);
+  }
+
+  // Read the GPS in a task of its own from now on
+  gpsTask.setSource(gpsSource);
+  gpsTaskRunning = gpsTask.begin();
+  if (!gpsTaskRunning) {
+    Serial.println("GPS task not started, reading the GPS from the loop");
+  }
 
   // Start the tft display
   tft.init();
@@ -323,20 +471,86 @@ void setup()
 
   // Initialize the screen manager with all required parameters
   screenManager = new ScreenManager(&tft, &gpsParser, logger, &hostname);
+  screenManager->setFilter(&gpsFilter);
+  
+  // The filter follows every fix, not only while a screen that animates with it is shown
+  gpsParser.subscribe(GPSFilter::FIELDS);
+  
   screenManager->begin();
   
-  // Start the logger
-  logger->begin();
+  // Start the logger, records logged until now are sent once WiFi is up. A
+  // stream to the logger port leaves no HTTP server there to send them to.
+  loggerHttp = nmeaStream == nullptr || loggerStreamPort != loggerPort;
+  loggerTaskRunning = loggerHttp && logger->begin();
   logger->logInfo("System starting up");
+  if (gpsSource == &uartSource && gpsAutoConfig && !gpsSetup.verified) {
+    logger->logWarning("GPS receiver configuration not verified (" + String(GPSConfigurator::getChipsetName(gpsSetup.chipset)) +
+                       ", " + String(gpsSetup.baud) + " baud, " + String(gpsSetup.unwantedSentences) + " unwanted sentences)");
+  }
   
   // Setup OTA after display is initialized
   setupOTA();
+  
+  // Validated sentences over UDP, once the network stack is up
+  if (udpAddress.length() > 0) {
+    nmeaUdp = new NMEAUdp(udpAddress, udpPort, udpMode == "sentence" ? NMEAUdp::SENTENCE : NMEAUdp::EPOCH);
+    if (!nmeaUdp->begin()) {
+      logger->logError("NMEA UDP output not started, address " + udpAddress);
+    }
+  }
 }
 
-String nmeaBuffer = "";
-bool nmeaSentenceComplete = false;
-unsigned long lastNmeaSend = 0;
-const unsigned long NMEA_SEND_INTERVAL = 1000; // Send NMEA data every second
+GPSParser::Fix latestFix;
+
+// Fix latency report
+unsigned long lastLatencyLog = 0;
+const unsigned long LATENCY_LOG_INTERVAL = 60000; // Log the fix age histograms and queue statistics every minute
+
+void logLatency()
+{
+  static const char* stageNames[GPSParser::LATENCY_STAGE_COUNT] = { "arrival", "parse", "render", "upload" };
+  
+  char text[160];
+  size_t length = snprintf(text, sizeof(text), "Fix age p50/p99/max:");
+  for (uint8_t i = 0; i < GPSParser::LATENCY_STAGE_COUNT && length < sizeof(text); i++) {
+    length += snprintf(text + length, sizeof(text) - length, "%s %s ", i > 0 ? "," : "", stageNames[i]);
+    if (length < sizeof(text)) {
+      length += gpsParser.getLatency((GPSParser::LatencyStage)i).format(text + length, sizeof(text) - length);
+    }
+  }
+  logger->logInfo(text);
+  
+  // Anything dropped here was not collected by the loop in time
+  GPSTask::Stats queues = gpsTask.getStats();
+  snprintf(text, sizeof(text), "GPS queues: fixes %lu dropped, max %lu/%u; raw %lu bytes dropped, max %lu/%u",
+           (unsigned long)queues.fixesDropped, (unsigned long)queues.fixesHighWater, GPS_TASK_FIX_QUEUE,
+           (unsigned long)queues.rawDropped, (unsigned long)queues.rawHighWater, GPS_TASK_RAW_QUEUE);
+  logger->logInfo(text);
+  
+  TCPLogger::Stats records = logger->getStats();
+  snprintf(text, sizeof(text), "Logger: %lu queued, %lu sent, %lu failed, dropped %lu oldest/%lu newest, %lu coalesced, "
+           "%lu requests, %lu connections", (unsigned long)records.queued, (unsigned long)records.sent, (unsigned long)records.failed,
+           (unsigned long)records.droppedOldest, (unsigned long)records.droppedNewest, (unsigned long)records.coalesced,
+           (unsigned long)records.requests, (unsigned long)records.connects);
+  logger->logInfo(text);
+  
+  if (nmeaStream != nullptr) {
+    NMEAStream::Stats stream = nmeaStream->getStats();
+    snprintf(text, sizeof(text), "NMEA stream: %lu lines, %lu bytes written, dropped %lu lines/%lu bytes, "
+             "buffer %lu/%lu, %lu connections, %lu lost", (unsigned long)stream.lines, (unsigned long)stream.written,
+             (unsigned long)stream.droppedLines, (unsigned long)stream.droppedBytes, (unsigned long)stream.highWater,
+             (unsigned long)NMEA_STREAM_BUFFER_SIZE, (unsigned long)stream.connects, (unsigned long)stream.disconnects);
+    logger->logInfo(text);
+  }
+  
+  if (nmeaUdp != nullptr) {
+    NMEAUdp::Stats udp = nmeaUdp->getStats();
+    snprintf(text, sizeof(text), "NMEA UDP: %lu packets/s, %lu bytes/s, %lu sentences, %lu rejected, %lu failed",
+             (unsigned long)udp.packetsPerSecond, (unsigned long)udp.bytesPerSecond, (unsigned long)udp.sentences,
+             (unsigned long)udp.rejected, (unsigned long)udp.failed);
+    logger->logInfo(text);
+  }
+}
 
 void loop()
 {
@@ -348,33 +562,43 @@ void loop()
     return;
   }
 
-  // Read GPS data from Serial2 (UART2)
-  while (gpsSerial.available() > 0) {
-    // get the byte data from the GPS
-    char gpsData = gpsSerial.read();
-    
-    // Process the GPS data with our parser
-    gpsParser.processGPSData(gpsData);
-    
-    // Collect NMEA data
-    nmeaBuffer += gpsData;
-    
-    // Check for end of NMEA sentence
-    if (gpsData == '\n') {
-      nmeaSentenceComplete = true;
+  // Without its own task the GPS is read here
+  if (!gpsTaskRunning) {
+    gpsTask.poll();
+  }
+
+  // Take the fixes the GPS task has published since the last pass
+  while (gpsTask.readFix(latestFix)) {
+    gpsClock.update(latestFix);
+    gpsFilter.update(latestFix);
+  }
+
+  // Hand the raw data to the logger as it arrives, a record at a time. It
+  // batches whole sentences and sends them when the batch is full or due.
+  static uint8_t gpsData[TCP_LOGGER_RECORD_SIZE];
+  size_t count;
+  while ((count = gpsTask.readRaw(gpsData, sizeof(gpsData))) > 0) {
+    if (nmeaStream != nullptr) {
+      nmeaStream->write(gpsData, count);
+    } else {
+      logger->sendRawNMEA(gpsData, count, &latestFix);
+    }
+    if (nmeaUdp != nullptr) {
+      nmeaUdp->write(gpsData, count);
     }
     
     // Echo to serial monitor for debugging
-    Serial.print(gpsData);
+    Serial.write(gpsData, count);
   }
 
-  // Send NMEA data if we have a complete sentence and it's time to send
-  if (nmeaSentenceComplete && (millis() - lastNmeaSend > NMEA_SEND_INTERVAL)) {
-    if (logger->sendRawNMEA(nmeaBuffer)) {
-      lastNmeaSend = millis();
-    }
-    nmeaBuffer = "";
-    nmeaSentenceComplete = false;
+  if (nmeaStream != nullptr) {
+    nmeaStream->process();
+  }
+  if (nmeaUdp != nullptr) {
+    nmeaUdp->process();
+  }
+  if (loggerHttp && !loggerTaskRunning) {
+    logger->process();
   }
 
   // Update screen if we have new data and enough time has passed
@@ -382,6 +606,17 @@ void loop()
     screenManager->update();  // Update the current screen with new GPS data
     lastDisplayUpdate = millis();
   }
+  
+  // Animated screens move between fixes
+  if (screenManager->isAnimated() && millis() - lastAnimation >= ANIMATION_INTERVAL) {
+    screenManager->animate();
+    lastAnimation = millis();
+  }
+
+  if (millis() - lastLatencyLog > LATENCY_LOG_INTERVAL) {
+    logLatency();
+    lastLatencyLog = millis();
+  }
 
   // Checks if Touchscreen is touched
   if (touchscreen.tirqTouched() && touchscreen.touched())
@@ -0,0 +1,429 @@
+// Host stress test for SPSCRing and GPSTask (env:stress), with the producer
+// and the consumer on two threads as on the two ESP32 cores.
+//
+//   pio run -e stress && .pio/build/stress/program [seconds]
+//
+// MPMCRing is checked with several producers and consumers, and with the
+// producer making room by taking the oldest item out as TCPLogger does.
+//
+// Every check runs for the given time (default 1 s) and fails the program on
+// a lost, duplicated, reordered or torn item, or on counters that do not add up.
+
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "SPSCRing.h"
+#include "MPMCRing.h"
+#include "GPSSource.h"
+#include "GPSTask.h"
+
+#define STRESS_STRUCT_WORDS 16
+#define STRESS_THREADS 2             // Producers and consumers each for MPMCRing
+#define STRESS_SIMULATION_SPEED 50   // Synthetic receiver pacing, times real time
+#define STRESS_SIMULATION_RATE 10    // Hz
+
+static double seconds = 1.0;
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        printf("  FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+static double elapsedSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Each item carries its sequence number in every word, so a torn copy shows
+struct Record {
+    uint32_t words[STRESS_STRUCT_WORDS];
+};
+
+// Producer waits for room: every item must arrive, in order
+static void lossless() {
+    static SPSCRing<Record, 64> ring;
+    std::atomic<bool> stop(false);
+    std::atomic<uint32_t> produced(0);
+    
+    std::thread producer([&]() {
+        uint32_t sequence = 0;
+        Record record;
+        while (!stop.load(std::memory_order_relaxed)) {
+            for (int i = 0; i < STRESS_STRUCT_WORDS; i++) {
+                record.words[i] = sequence;
+            }
+            if (ring.size() < ring.capacity() && ring.push(record)) {
+                sequence++;
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+        produced = sequence;
+    });
+    
+    uint32_t expected = 0;
+    bool ordered = true;
+    bool whole = true;
+    auto start = std::chrono::steady_clock::now();
+    Record record;
+    while (true) {
+        if (!ring.pop(record)) {
+            if (produced.load() != 0 && expected == produced.load()) {
+                break;
+            }
+            if (!stop && elapsedSince(start) > seconds) {
+                stop = true;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+        ordered &= record.words[0] == expected;
+        for (int i = 1; i < STRESS_STRUCT_WORDS; i++) {
+            whole &= record.words[i] == record.words[0];
+        }
+        expected++;
+    }
+    producer.join();
+    double time = elapsedSince(start);
+    
+    printf("lossless   %10u records of %zu bytes, %6.2f M/s, dropped %u\n", (unsigned)expected, sizeof(Record),
+           expected / time / 1e6, (unsigned)ring.getDropped());
+    check(ordered, "records lost, repeated or out of order");
+    check(whole, "torn record");
+    check(ring.getDropped() == 0, "drops counted without a full ring");
+}
+
+// Producer never waits and the consumer is slow: what arrives is in order,
+// and received plus dropped is everything sent
+static void lossy() {
+    static SPSCRing<uint32_t, 256> ring;
+    std::atomic<bool> stop(false);
+    std::atomic<uint32_t> produced(0);
+    
+    std::thread producer([&]() {
+        uint32_t values[7];
+        uint32_t sequence = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            // Single and bulk pushes, with the bulk one partially accepted when nearly full
+            if (sequence % 3 == 0) {
+                ring.push(sequence++);
+            }
+            else {
+                for (int i = 0; i < 7; i++) {
+                    values[i] = sequence++;
+                }
+                ring.push(values, 7);
+            }
+        }
+        produced = sequence;
+    });
+    
+    uint32_t received = 0;
+    uint32_t last = 0;
+    bool increasing = true;
+    uint32_t values[32];
+    auto start = std::chrono::steady_clock::now();
+    while (true) {
+        size_t count = ring.pop(values, 1 + received % 32);
+        for (size_t i = 0; i < count; i++) {
+            increasing &= received == 0 || values[i] > last;
+            last = values[i];
+            received++;
+        }
+        if (count == 0) {
+            if (stop) {
+                if (produced.load() != 0) {
+                    break;
+                }
+            }
+            else if (elapsedSince(start) > seconds) {
+                stop = true;
+            }
+        }
+        // Fall behind now and then
+        if (received % 4096 == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+    producer.join();
+    while (ring.pop(values[0])) {
+        increasing &= values[0] > last;
+        last = values[0];
+        received++;
+    }
+    
+    printf("lossy      %10u sent, %10u received, %10u dropped, max fill %u/%u\n", (unsigned)produced.load(),
+           (unsigned)received, (unsigned)ring.getDropped(), (unsigned)ring.getHighWater(), (unsigned)ring.capacity());
+    check(increasing, "values out of order or repeated");
+    check(received + ring.getDropped() == produced.load(), "received plus dropped is not what was sent");
+    check(ring.getDropped() > 0, "the slow consumer never caused a drop");
+    check(ring.getHighWater() == ring.capacity(), "high water mark below a full ring");
+}
+
+// Several producers and consumers, the producers waiting for room: each value
+// arrives exactly once and every consumer sees each producer's values in order
+static void multiple() {
+    static MPMCRing<uint32_t, 64> ring;
+    std::atomic<bool> stop(false);
+    std::atomic<int> running(STRESS_THREADS);
+    std::vector<uint32_t> produced(STRESS_THREADS);
+    std::vector<std::vector<uint32_t> > received(STRESS_THREADS);
+    std::vector<std::thread> threads;
+    
+    for (int p = 0; p < STRESS_THREADS; p++) {
+        threads.push_back(std::thread([&, p]() {
+            uint32_t sequence = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (ring.push((uint32_t)p << 28 | sequence)) {
+                    sequence++;
+                }
+                else {
+                    std::this_thread::yield();
+                }
+            }
+            produced[p] = sequence;
+            running--;
+        }));
+    }
+    std::atomic<bool> ordered(true);
+    for (int c = 0; c < STRESS_THREADS; c++) {
+        threads.push_back(std::thread([&, c]() {
+            std::vector<uint32_t> next(STRESS_THREADS);
+            uint32_t value;
+            while (true) {
+                if (ring.pop(value)) {
+                    uint32_t p = value >> 28;
+                    uint32_t sequence = value & 0x0FFFFFFF;
+                    if (p >= STRESS_THREADS || sequence < next[p]) {
+                        ordered = false;
+                        continue;
+                    }
+                    next[p] = sequence + 1;
+                    received[c].push_back(value);
+                }
+                else if (running.load() == 0) {
+                    break;
+                }
+                else {
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    }
+    auto start = std::chrono::steady_clock::now();
+    while (elapsedSince(start) < seconds) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    stop = true;
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    
+    // Every value exactly once
+    std::vector<std::vector<bool> > seen(STRESS_THREADS);
+    uint32_t total = 0;
+    for (int p = 0; p < STRESS_THREADS; p++) {
+        seen[p].assign(produced[p], false);
+        total += produced[p];
+    }
+    bool once = true;
+    uint32_t count = 0;
+    for (int c = 0; c < STRESS_THREADS; c++) {
+        for (size_t i = 0; i < received[c].size(); i++) {
+            uint32_t p = received[c][i] >> 28;
+            uint32_t sequence = received[c][i] & 0x0FFFFFFF;
+            if (p >= STRESS_THREADS || sequence >= produced[p] || seen[p][sequence]) {
+                once = false;
+                continue;
+            }
+            seen[p][sequence] = true;
+            count++;
+        }
+    }
+    
+    printf("multiple   %10u values, %d producers and %d consumers, %u received\n", (unsigned)total, STRESS_THREADS,
+           STRESS_THREADS, (unsigned)count);
+    check(ordered, "a producer's values out of order");
+    check(once, "a value repeated or invented");
+    check(count == total, "values lost");
+}
+
+// The producer never waits but takes the oldest item out when full, while the
+// consumer keeps taking items too: received plus discarded is everything sent
+static void dropOldest() {
+    static MPMCRing<uint32_t, 16> ring;
+    std::atomic<bool> stop(false);
+    std::atomic<uint32_t> produced(0);
+    std::atomic<uint32_t> discarded(0);
+    
+    std::thread producer([&]() {
+        uint32_t sequence = 0;
+        uint32_t oldest;
+        uint32_t count = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (!ring.push(sequence)) {
+                if (ring.pop(oldest)) {
+                    count++;
+                }
+                if (!ring.push(sequence)) {
+                    continue;
+                }
+            }
+            sequence++;
+        }
+        produced = sequence;
+        discarded = count;
+    });
+    
+    uint32_t received = 0;
+    uint32_t last = 0;
+    bool increasing = true;
+    uint32_t value;
+    auto start = std::chrono::steady_clock::now();
+    while (true) {
+        if (ring.pop(value)) {
+            increasing &= received == 0 || value > last;
+            last = value;
+            received++;
+            if (received % 1024 == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+        else if (stop) {
+            if (produced.load() != 0) {
+                break;
+            }
+        }
+        else if (elapsedSince(start) > seconds) {
+            stop = true;
+        }
+    }
+    producer.join();
+    while (ring.pop(value)) {
+        increasing &= value > last;
+        last = value;
+        received++;
+    }
+    
+    printf("dropOldest %10u sent, %10u received, %10u discarded\n", (unsigned)produced.load(), (unsigned)received,
+           (unsigned)discarded.load());
+    check(increasing, "values out of order or repeated");
+    check(received + discarded.load() == produced.load(), "received plus discarded is not what was sent");
+    check(discarded.load() > 0, "the slow consumer never caused a discard");
+}
+
+// The firmware pipeline: the synthetic receiver read and parsed by GPSTask on
+// one thread, fixes and raw bytes taken from its queues and the satellite
+// table read on another
+static void pipeline(bool slowConsumer) {
+    SyntheticGPSSource::Settings settings = SyntheticGPSSource::defaultSettings();
+    settings.rateHz = STRESS_SIMULATION_RATE;
+    SyntheticGPSSource source(settings);
+    source.setSpeed(STRESS_SIMULATION_SPEED);
+    GPSParser parser;
+    GPSTask* task = new GPSTask(parser, &source);
+    std::atomic<bool> stop(false);
+    std::atomic<bool> done(false);
+    
+    std::thread producer([&]() {
+        while (!stop.load(std::memory_order_relaxed)) {
+            task->poll();
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        done = true;
+    });
+    
+    std::vector<uint8_t> raw;
+    uint32_t fixes = 0;
+    uint32_t lastSequence = 0;
+    bool increasing = true;
+    bool consecutive = true;
+    bool wholeTables = true;
+    uint32_t tables = 0;
+    GPSParser::SatelliteInfo satellites[GPS_MAX_SATELLITES];
+    uint8_t block[256];
+    auto start = std::chrono::steady_clock::now();
+    while (true) {
+        bool finished = done.load();
+        GPSParser::Fix fix;
+        while (task->readFix(fix)) {
+            increasing &= fix.sequence > lastSequence;
+            consecutive &= fix.sequence == lastSequence + 1;
+            lastSequence = fix.sequence;
+            fixes++;
+        }
+        size_t count;
+        while ((count = task->readRaw(block, sizeof(block))) > 0) {
+            raw.insert(raw.end(), block, block + count);
+        }
+        // The satellite table as the screen reads it: a torn copy shows as a
+        // satellite listed twice or one out of range
+        int inView = parser.getSatelliteInfo(satellites, GPS_MAX_SATELLITES);
+        for (int i = 0; i < inView; i++) {
+            wholeTables &= satellites[i].elevation >= 0 && satellites[i].elevation <= 90 &&
+                           satellites[i].azimuth >= 0 && satellites[i].azimuth < 360;
+            for (int j = 0; j < i; j++) {
+                wholeTables &= satellites[i].id != satellites[j].id ||
+                               satellites[i].constellation != satellites[j].constellation;
+            }
+        }
+        tables += inView > 0;
+        if (finished) {
+            break;
+        }
+        if (elapsedSince(start) > seconds) {
+            stop = true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(slowConsumer ? 100 : 1));
+    }
+    producer.join();
+    
+    GPSTask::Stats stats = task->getStats();
+    printf("pipeline %s %6u fixes (%u dropped, max %u/%u), %8zu bytes (%u dropped, max %u/%u)\n",
+           slowConsumer ? "slow" : "fast", (unsigned)fixes, (unsigned)stats.fixesDropped,
+           (unsigned)stats.fixesHighWater, GPS_TASK_FIX_QUEUE, raw.size(), (unsigned)stats.rawDropped,
+           (unsigned)stats.rawHighWater, GPS_TASK_RAW_QUEUE);
+    check(increasing, "fixes out of order");
+    check(tables > 0 && wholeTables, "no satellite table read, or a torn one");
+    check(fixes + stats.fixesDropped == parser.getFixSequence(), "received plus dropped fixes is not what was published");
+    
+    if (!slowConsumer) {
+        // Nothing dropped: every published fix and the exact byte stream arrived
+        check(stats.fixesDropped == 0 && stats.rawDropped == 0, "drops with a consumer that keeps up");
+        check(consecutive, "a published fix was skipped");
+        
+        SyntheticGPSSource reference(settings);
+        reference.setSpeed(GPS_SOURCE_SPEED_FAST);
+        std::vector<uint8_t> expected(raw.size());
+        size_t length = 0;
+        while (length < expected.size()) {
+            length += reference.read(expected.data() + length, expected.size() - length);
+        }
+        check(raw == expected, "raw bytes differ from the receiver output");
+    }
+    else {
+        check(stats.rawDropped > 0, "the slow consumer never caused a drop");
+    }
+    delete task;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        seconds = atof(argv[1]);
+    }
+    
+    lossless();
+    lossy();
+    multiple();
+    dropOldest();
+    pipeline(false);
+    pipeline(true);
+    
+    printf(failures == 0 ? "All checks passed\n" : "%d checks FAILED\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,451 @@
+// Configurator against a scripted receiver: baud detection, the u-blox and
+// MediaTek command sequences, refused and unanswered commands, and the
+// verification pass. The receiver runs on simulated time, a millisecond per
+// look at the clock, so the timeouts cost nothing.
+
+#include <string>
+#include "tests.h"
+#include "GPSConfigurator.h"
+#include "NMEANumeric.h"
+
+// NMEA sentences by their message ID in UBX class 0xF0
+static const char* const sentenceTypes[] = { "GGA", "GLL", "GSA", "GSV", "RMC", "VTG" };
+static const uint32_t msgoutKeys[] = { 0x209100BB, 0x209100CA, 0x209100C0, 0x209100C5, 0x209100AC, 0x209100B1 };
+#define SENTENCE_TYPES 6
+#define GLL 1
+
+// PMTK314 field of each of those sentences
+static const uint8_t mtkFields[] = { 3, 0, 4, 5, 1, 2 };
+
+// NAV-PVT, NAV-DOP and NAV-SAT
+static const uint8_t navIds[] = { UBX_NAV_PVT, UBX_NAV_DOP, UBX_NAV_SAT };
+static const uint32_t navKeys[] = { 0x20910007, 0x20910039, 0x20910016 };
+#define NAV_TYPES 3
+
+class FakeReceiver : public GPSPort {
+public:
+    enum Kind {
+        UBLOX,      // Older u-blox, CFG-PRT, CFG-MSG and CFG-RATE
+        UBLOX_M10,  // CFG-VALSET and CFG-VALGET only
+        MTK
+    };
+    
+    Kind kind;
+    const char* protocolVersion;  // MON-VER extension, nullptr for none
+    uint32_t baud;                // Receiver side
+    uint16_t rateMs = 1000;
+    uint8_t nmeaRates[SENTENCE_TYPES] = { 1, 1, 1, 1, 1, 1 };
+    uint8_t navRates[NAV_TYPES] = { 0, 0, 0 };
+    
+    // Failure script: the command (CFG message ID or PMTK number) that is
+    // refused, or with silent set, never answered nor applied
+    int failCommand = -1;
+    bool failSilently = false;
+    bool keepGLL = false;         // Acknowledges turning GLL off but keeps sending it
+    uint32_t refused = 0;         // NAKs sent
+    
+    FakeReceiver(Kind kind, uint32_t baud, const char* protocolVersion = nullptr) :
+        kind(kind), protocolVersion(protocolVersion), baud(baud) {}
+    
+    void setBaud(uint32_t newBaud) override {
+        portBaud = newBaud;
+        output.clear();
+        position = 0;
+    }
+    uint32_t getBaud() const override { return portBaud; }
+    int available() override { return output.size() - position; }
+    int read() override { return position < output.size() ? (uint8_t)output[position++] : -1; }
+    void flush() override {}
+    
+    unsigned long now() override {
+        // A new epoch is due
+        time++;
+        if (time >= nextEpoch) {
+            sendEpoch();
+            nextEpoch = time + rateMs;
+        }
+        return time;
+    }
+    
+    size_t write(const uint8_t* data, size_t length) override {
+        // At the wrong baud rate the receiver hears nothing it can use
+        if (portBaud != baud) {
+            return length;
+        }
+        for (size_t i = 0; i < length; i++) {
+            UBXParser::Result frame = ubx.processByte(data[i]);
+            if (frame == UBXParser::UBX_FRAME_READY) {
+                handleFrame();
+            }
+            else if (frame == UBXParser::UBX_IDLE) {
+                handleChar((char)data[i]);
+            }
+        }
+        return length;
+    }
+
+private:
+    uint32_t portBaud = 0;
+    std::string output;
+    size_t position = 0;
+    unsigned long time = 0;
+    unsigned long nextEpoch = 0;
+    uint32_t epochs = 0;
+    UBXParser ubx;
+    std::string line;
+    
+    void send(const std::string& bytes) {
+        if (portBaud == baud) {
+            output += bytes;
+            return;
+        }
+        // Framing errors, never a '$' or a UBX sync character
+        for (size_t i = 0; i < bytes.size(); i++) {
+            output += (char)(0xE0 | (bytes[i] & 0x1F));
+        }
+    }
+    
+    void sendSentence(const std::string& body) {
+        char sentence[NMEA_SENTENCE_BUFFER_SIZE];
+        snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body.c_str(),
+                 nmeaChecksum(body.c_str(), body.c_str() + body.size()));
+        send(sentence);
+    }
+    
+    void sendFrame(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t length) {
+        uint8_t frame[256];
+        size_t frameLength = UBXParser::buildFrame(cls, id, payload, length, frame, sizeof(frame));
+        send(std::string((const char*)frame, frameLength));
+    }
+    
+    void sendEpoch() {
+        for (uint8_t i = 0; i < SENTENCE_TYPES; i++) {
+            uint8_t rate = (i == GLL && keepGLL) ? 1 : nmeaRates[i];
+            if (rate > 0 && epochs % rate == 0) {
+                sendSentence(std::string("GN") + sentenceTypes[i] + ",120000.00,5205.00000,N,00504.00000,E");
+            }
+        }
+        uint8_t payload[92] = {};
+        for (uint8_t i = 0; i < NAV_TYPES; i++) {
+            if (navRates[i] > 0 && epochs % navRates[i] == 0) {
+                sendFrame(UBX_CLASS_NAV, navIds[i], payload, navIds[i] == UBX_NAV_PVT ? 92 : 18);
+            }
+        }
+        epochs++;
+    }
+    
+    // Whether the script lets the command through, answering a refusal itself
+    bool accept(int command) {
+        if (command != failCommand) {
+            return true;
+        }
+        if (!failSilently) {
+            refused++;
+            if (kind == MTK) {
+                sendSentence("PMTK001," + std::to_string(command) + ",1");
+            }
+            else {
+                uint8_t nak[2] = { UBX_CLASS_CFG, (uint8_t)command };
+                sendFrame(UBX_CLASS_ACK, UBX_ACK_NAK, nak, 2);
+            }
+        }
+        return false;
+    }
+    
+    void acknowledge(bool ok) {
+        if (!ok) {
+            refused++;
+        }
+        uint8_t ack[2] = { ubx.getClass(), ubx.getId() };
+        sendFrame(UBX_CLASS_ACK, ok ? UBX_ACK_ACK : UBX_ACK_NAK, ack, 2);
+    }
+    
+    void handleFrame() {
+        const uint8_t* payload = ubx.getPayload();
+        uint16_t length = ubx.getLength();
+        if (kind == MTK) {
+            return;
+        }
+        if (ubx.getClass() == UBX_CLASS_MON && ubx.getId() == UBX_MON_VER && length == 0) {
+            // Software and hardware version, then the extensions
+            uint8_t version[40 + 2 * 30] = {};
+            strcpy((char*)&version[0], kind == UBLOX_M10 ? "ROM SPG 5.10 (7b202e)" : "ROM CORE 3.01 (107888)");
+            strcpy((char*)&version[30], kind == UBLOX_M10 ? "000A0000" : "00080000");
+            strcpy((char*)&version[40], "FWVER=SPG 3.01");
+            uint16_t versionLength = 70;
+            if (protocolVersion != nullptr) {
+                strcpy((char*)&version[70], protocolVersion);
+                versionLength += 30;
+            }
+            sendFrame(UBX_CLASS_MON, UBX_MON_VER, version, versionLength);
+            return;
+        }
+        // Polls are answered even when the setting is refused
+        if (ubx.getClass() != UBX_CLASS_CFG || (length > 0 && !accept(ubx.getId()))) {
+            return;
+        }
+        
+        bool legacy = ubx.getId() == UBX_CFG_PRT || ubx.getId() == UBX_CFG_MSG || ubx.getId() == UBX_CFG_RATE;
+        if (legacy != (kind == UBLOX)) {
+            acknowledge(false);
+            return;
+        }
+        uint32_t newBaud = baud;
+        switch (ubx.getId()) {
+            case UBX_CFG_PRT:
+                memcpy(&newBaud, &payload[8], 4);
+                break;
+            case UBX_CFG_MSG:
+                for (uint8_t i = 0; i < SENTENCE_TYPES; i++) {
+                    if (payload[0] == UBX_CLASS_NMEA && payload[1] == i) {
+                        nmeaRates[i] = payload[2];
+                    }
+                }
+                for (uint8_t i = 0; i < NAV_TYPES; i++) {
+                    if (payload[0] == UBX_CLASS_NAV && payload[1] == navIds[i]) {
+                        navRates[i] = payload[2];
+                    }
+                }
+                break;
+            case UBX_CFG_RATE:
+                if (length == 0) {
+                    uint8_t rate[6] = { (uint8_t)rateMs, (uint8_t)(rateMs >> 8), 1, 0, 1, 0 };
+                    sendFrame(UBX_CLASS_CFG, UBX_CFG_RATE, rate, 6);
+                    return;
+                }
+                memcpy(&rateMs, &payload[0], 2);
+                break;
+            case UBX_CFG_VALSET:
+                for (uint16_t offset = 4; offset + 4 < length;) {
+                    uint32_t key;
+                    memcpy(&key, &payload[offset], 4);
+                    uint8_t size = (key >> 28) & 0x07;
+                    uint32_t value = 0;
+                    memcpy(&value, &payload[offset + 4], size == 4 ? 4 : size == 3 ? 2 : 1);
+                    offset += 4 + (size == 4 ? 4 : size == 3 ? 2 : 1);
+                    if (key == 0x40520001) {
+                        newBaud = value;
+                    }
+                    else if (key == 0x30210001) {
+                        rateMs = value;
+                    }
+                    for (uint8_t i = 0; i < SENTENCE_TYPES; i++) {
+                        if (key == msgoutKeys[i]) {
+                            nmeaRates[i] = value;
+                        }
+                    }
+                    for (uint8_t i = 0; i < NAV_TYPES; i++) {
+                        if (key == navKeys[i]) {
+                            navRates[i] = value;
+                        }
+                    }
+                }
+                break;
+            case UBX_CFG_VALGET: {
+                // Version 1, the layer and position, then the key and its value
+                uint8_t reply[10] = { 1, payload[1], 0, 0 };
+                memcpy(&reply[4], &payload[4], 4);
+                memcpy(&reply[8], &rateMs, 2);
+                sendFrame(UBX_CLASS_CFG, UBX_CFG_VALGET, reply, sizeof(reply));
+                return;
+            }
+            default:
+                return;
+        }
+        acknowledge(true);
+        baud = newBaud;
+    }
+    
+    void handleChar(char c) {
+        if (c == '$') {
+            line = "$";
+        }
+        else if (c == '\n' && !line.empty()) {
+            handleCommand(line.substr(1, line.find('*') - 1));
+            line.clear();
+        }
+        else if (!line.empty() && c != '\r') {
+            line += c;
+        }
+    }
+    
+    void handleCommand(const std::string& body) {
+        if (kind != MTK || body.compare(0, 4, "PMTK") != 0) {
+            return;
+        }
+        int command = atoi(body.c_str() + 4);
+        const char* value = strchr(body.c_str(), ',');
+        if (!accept(command)) {
+            return;
+        }
+        switch (command) {
+            case 605:
+                sendSentence("PMTK705,AXN_2.31_3339_13101700,5632,PA6H,1.0");
+                return;
+            case 251:
+                baud = atol(value + 1);
+                return;
+            case 400:
+                sendSentence("PMTK500," + std::to_string(rateMs) + ",0,0,0,0");
+                return;
+            case 314: {
+                uint8_t fields[19];
+                for (uint8_t i = 0; i < 19 && value != nullptr; i++) {
+                    fields[i] = atoi(value + 1);
+                    value = strchr(value + 1, ',');
+                }
+                for (uint8_t i = 0; i < SENTENCE_TYPES; i++) {
+                    nmeaRates[i] = fields[mtkFields[i]];
+                }
+                break;
+            }
+            case 220:
+                rateMs = atoi(value + 1);
+                break;
+            default:
+                return;
+        }
+        sendSentence("PMTK001," + std::to_string(command) + ",3");
+    }
+};
+
+static GPSConfigurator::Result configure(FakeReceiver& receiver, uint32_t baud, uint16_t rateMs,
+                                         GPSParser::Protocol protocol = GPSParser::PROTOCOL_NMEA) {
+    GPSConfigurator configurator(receiver);
+    GPSConfigurator::Settings settings = { baud, rateMs, protocol };
+    return configurator.configure(settings);
+}
+
+// The receiver ends up at the settings with only the consumed sentences
+static void checkReceiver(const char* name, const FakeReceiver& receiver, uint32_t baud, uint16_t rateMs,
+                          uint8_t gsvRate) {
+    check(receiver.baud == baud, "%s: receiver at %lu baud, not %lu", name, (unsigned long)receiver.baud,
+          (unsigned long)baud);
+    check(receiver.rateMs == rateMs, "%s: receiver period %u ms, not %u", name, receiver.rateMs, rateMs);
+    const uint8_t expected[SENTENCE_TYPES] = { GPS_ENABLE_GGA, 0, GPS_ENABLE_GSA, gsvRate, GPS_ENABLE_RMC, 0 };
+    for (uint8_t i = 0; i < SENTENCE_TYPES; i++) {
+        check(receiver.nmeaRates[i] == expected[i], "%s: %s at rate %u, not %u", name, sentenceTypes[i],
+              receiver.nmeaRates[i], expected[i]);
+    }
+}
+
+static void checkResult(const char* name, const GPSConfigurator::Result& result, uint32_t detected,
+                        GPSConfigurator::Chipset chipset, bool configured, bool verified) {
+    check(result.detectedBaud == detected, "%s: detected at %lu baud, not %lu", name,
+          (unsigned long)result.detectedBaud, (unsigned long)detected);
+    check(result.chipset == chipset, "%s: chipset %s, not %s", name, GPSConfigurator::getChipsetName(result.chipset),
+          GPSConfigurator::getChipsetName(chipset));
+    check(result.configured == configured, "%s: configured is %d", name, result.configured);
+    check(result.verified == verified, "%s: verified is %d", name, result.verified);
+}
+
+static void testUBlox() {
+    FakeReceiver receiver(FakeReceiver::UBLOX, 9600, "PROTVER=18.00");
+    GPSConfigurator::Result result = configure(receiver, 115200, 200);
+    checkResult("u-blox", result, 9600, GPSConfigurator::CHIPSET_UBLOX, true, true);
+    check(result.protocolVersion == 18, "u-blox: protocol version %u", result.protocolVersion);
+    check(result.baud == 115200 && result.rateMs == 200, "u-blox: left at %lu baud, %u ms",
+          (unsigned long)result.baud, result.rateMs);
+    checkReceiver("u-blox", receiver, 115200, 200, 5);
+    
+    // Warm from the last boot: found at the target rate right away
+    FakeReceiver warm(FakeReceiver::UBLOX, 115200, "PROTVER=18.00");
+    checkResult("at the target baud", configure(warm, 115200, 200), 115200, GPSConfigurator::CHIPSET_UBLOX,
+                true, true);
+    
+    // Found further down the list
+    FakeReceiver other(FakeReceiver::UBLOX, 38400, "PROTVER=18.00");
+    checkResult("at 38400 baud", configure(other, 115200, 100), 38400, GPSConfigurator::CHIPSET_UBLOX, true, true);
+    checkReceiver("at 38400 baud", other, 115200, 100, 10);
+    
+    // UBX output instead of NMEA
+    FakeReceiver binary(FakeReceiver::UBLOX, 9600, "PROTVER=18.00");
+    checkResult("UBX output", configure(binary, 115200, 200, GPSParser::PROTOCOL_UBX), 9600,
+                GPSConfigurator::CHIPSET_UBLOX, true, true);
+    for (uint8_t i = 0; i < SENTENCE_TYPES; i++) {
+        check(binary.nmeaRates[i] == 0, "UBX output: %s still on", sentenceTypes[i]);
+    }
+    check(binary.navRates[0] == 1 && binary.navRates[1] == 1 && binary.navRates[2] == 5,
+          "UBX output: NAV rates %u %u %u", binary.navRates[0], binary.navRates[1], binary.navRates[2]);
+}
+
+static void testUBloxFailures() {
+    FakeReceiver silent(FakeReceiver::UBLOX, 0);
+    GPSConfigurator::Result result = configure(silent, 115200, 200);
+    checkResult("silent receiver", result, 0, GPSConfigurator::CHIPSET_UNKNOWN, false, false);
+    check(result.baud == 115200, "silent receiver: port left at %lu baud", (unsigned long)result.baud);
+    
+    // The rate refused: the poll reads back the old period
+    FakeReceiver refused(FakeReceiver::UBLOX, 9600, "PROTVER=18.00");
+    refused.failCommand = UBX_CFG_RATE;
+    result = configure(refused, 115200, 200);
+    checkResult("CFG-RATE refused", result, 9600, GPSConfigurator::CHIPSET_UBLOX, false, false);
+    check(refused.refused == 1 && result.rateMs == 1000, "CFG-RATE refused: %lu NAKs, rate %u",
+          (unsigned long)refused.refused, result.rateMs);
+    
+    // CFG-MSG never answered: the acknowledgements time out and GLL stays on
+    FakeReceiver unanswered(FakeReceiver::UBLOX, 9600, "PROTVER=18.00");
+    unanswered.failCommand = UBX_CFG_MSG;
+    unanswered.failSilently = true;
+    result = configure(unanswered, 115200, 200);
+    checkResult("CFG-MSG unanswered", result, 9600, GPSConfigurator::CHIPSET_UBLOX, false, false);
+    check(result.unwantedSentences > 0, "CFG-MSG unanswered: no unwanted sentences seen");
+    
+    // Acknowledged everything, yet still sends GLL
+    FakeReceiver stubborn(FakeReceiver::UBLOX, 9600, "PROTVER=18.00");
+    stubborn.keepGLL = true;
+    result = configure(stubborn, 115200, 200);
+    checkResult("GLL kept", result, 9600, GPSConfigurator::CHIPSET_UBLOX, true, false);
+    check(result.unwantedSentences > 0, "GLL kept: no unwanted sentences seen");
+}
+
+static void testUBloxM10() {
+    FakeReceiver receiver(FakeReceiver::UBLOX_M10, 9600, "PROTVER=34.10");
+    GPSConfigurator::Result result = configure(receiver, 115200, 200);
+    checkResult("M10", result, 9600, GPSConfigurator::CHIPSET_UBLOX, true, true);
+    check(result.protocolVersion == 34, "M10: protocol version %u", result.protocolVersion);
+    check(receiver.refused == 0, "M10: %lu commands refused", (unsigned long)receiver.refused);
+    checkReceiver("M10", receiver, 115200, 200, 5);
+    
+    FakeReceiver binary(FakeReceiver::UBLOX_M10, 115200, "PROTVER=34.10");
+    checkResult("M10 UBX output", configure(binary, 115200, 100, GPSParser::PROTOCOL_UBX), 115200,
+                GPSConfigurator::CHIPSET_UBLOX, true, true);
+    check(binary.navRates[0] == 1 && binary.navRates[1] == 1 && binary.navRates[2] == 10,
+          "M10 UBX output: NAV rates %u %u %u", binary.navRates[0], binary.navRates[1], binary.navRates[2]);
+    
+    // Without the protocol version the older messages are tried and refused
+    FakeReceiver unknown(FakeReceiver::UBLOX_M10, 9600);
+    result = configure(unknown, 9600, 200);
+    checkResult("M10 without PROTVER", result, 9600, GPSConfigurator::CHIPSET_UBLOX, false, false);
+    check(unknown.refused > 0 && unknown.rateMs == 1000, "M10 without PROTVER: %lu NAKs, period %u",
+          (unsigned long)unknown.refused, unknown.rateMs);
+}
+
+static void testMTK() {
+    FakeReceiver receiver(FakeReceiver::MTK, 9600);
+    GPSConfigurator::Result result = configure(receiver, 115200, 200);
+    checkResult("MediaTek", result, 9600, GPSConfigurator::CHIPSET_MTK, true, true);
+    check(result.rateMs == 200, "MediaTek: rate read back %u", result.rateMs);
+    checkReceiver("MediaTek", receiver, 115200, 200, 5);
+    
+    FakeReceiver refused(FakeReceiver::MTK, 9600);
+    refused.failCommand = 220;
+    result = configure(refused, 115200, 200);
+    checkResult("PMTK220 refused", result, 9600, GPSConfigurator::CHIPSET_MTK, false, false);
+    check(refused.refused == 1 && result.rateMs == 1000, "PMTK220 refused: %lu refusals, rate %u",
+          (unsigned long)refused.refused, result.rateMs);
+    
+    FakeReceiver unanswered(FakeReceiver::MTK, 9600);
+    unanswered.failCommand = 314;
+    unanswered.failSilently = true;
+    result = configure(unanswered, 115200, 200);
+    checkResult("PMTK314 unanswered", result, 9600, GPSConfigurator::CHIPSET_MTK, false, false);
+    check(result.unwantedSentences > 0, "PMTK314 unanswered: no unwanted sentences seen");
+}
+
+void testConfigurator() {
+    testUBlox();
+    testUBloxFailures();
+    testUBloxM10();
+    testMTK();
+}
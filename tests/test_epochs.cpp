@@ -0,0 +1,90 @@
+// Values carried over between epochs: at 10 Hz receivers send GGA and RMC
+// every epoch but GSA only once a second, the epochs in between must keep
+// the satellites used from the last GSA. A field no screen shows must still
+// be decoded for the consumers that subscribed it, e.g. the clock's date
+// and the filter's position.
+
+#include "tests.h"
+#include "GPSClock.h"
+#include "GPSFilter.h"
+#include "GPSParser.h"
+#include "NMEANumeric.h"
+
+#define EPOCH_COUNT 30
+#define EPOCH_MS 100
+
+static void feedSentence(GPSParser& parser, const char* body) {
+    char sentence[NMEA_SENTENCE_BUFFER_SIZE];
+    int length = snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, nmeaChecksum(body, body + strlen(body)));
+    parser.processGPSData((const uint8_t*)sentence, length);
+}
+
+static void testUsedSatellites() {
+    GPSParser parser;
+    uint32_t lastSequence = 0;
+    int checked = 0;
+    bool gsaSeen = false;
+    
+    for (int epoch = 0; epoch < EPOCH_COUNT; epoch++) {
+        uint32_t ms = epoch * EPOCH_MS;
+        char time[16];
+        snprintf(time, sizeof(time), "1200%02u.%02u", (unsigned)(ms / 1000), (unsigned)(ms % 1000 / 10));
+        char body[96];
+        snprintf(body, sizeof(body), "GNRMC,%s,A,5205.44435,N,00507.28783,E,0.02,,290224,,,A", time);
+        feedSentence(parser, body);
+        snprintf(body, sizeof(body), "GNGGA,%s,5205.44435,N,00507.28783,E,1,12,0.90,10.0,M,46.0,M,,", time);
+        feedSentence(parser, body);
+        
+        // One GSA per system on the whole second, GPS 8 only in the first one
+        if (ms % 1000 == 0) {
+            feedSentence(parser, ms == 0 ? "GNGSA,A,3,01,02,03,04,05,06,07,08,,,,,1.60,0.90,1.30,1"
+                                         : "GNGSA,A,3,01,02,03,04,05,06,07,,,,,,1.60,0.90,1.30,1");
+            feedSentence(parser, "GNGSA,A,3,65,66,67,68,,,,,,,,,1.60,0.90,1.30,2");
+            gsaSeen = true;
+        }
+        
+        uint32_t sequence = parser.getFixSequence();
+        if (gsaSeen && sequence != lastSequence) {
+            GPSParser::Fix fix;
+            parser.getFix(fix);
+            check(GPSParser::isSatelliteUsed(fix, GPSParser::CONSTELLATION_GPS, 1) &&
+                  GPSParser::isSatelliteUsed(fix, GPSParser::CONSTELLATION_GLONASS, 65),
+                  "epoch %d: fix %lu lost the used satellites", epoch, (unsigned long)fix.sequence);
+            checked++;
+        }
+        lastSequence = sequence;
+    }
+    
+    check(checked > EPOCH_COUNT / 2, "only %d fixes checked", checked);
+    check(parser.isSatelliteUsed(GPSParser::CONSTELLATION_GPS, 7) &&
+          !parser.isSatelliteUsed(GPSParser::CONSTELLATION_GPS, 8),
+          "the GSA of the next second did not replace the used satellites");
+}
+
+static void testSubscribers() {
+    // The clock and the filter subscribed, then the screen switches from Values to Satellites
+    GPSParser parser;
+    int screen = parser.subscribe(GPSParser::FIELD_ALL);
+    parser.subscribe(GPSClock::FIELDS);
+    parser.subscribe(GPSFilter::FIELDS);
+    feedSentence(parser, "GNRMC,235959.00,A,5205.44435,N,00507.28783,E,0.02,,290224,,,A");
+    feedSentence(parser, "GNRMC,235959.50,A,5205.44435,N,00507.28783,E,0.02,,290224,,,A");
+    GPSParser::Fix before;
+    parser.getFix(before);
+    parser.setSubscription(screen, GPSParser::FIELD_SATELLITE_TABLE | GPSParser::FIELD_USED_SATELLITES);
+    
+    // Past midnight
+    feedSentence(parser, "GNRMC,000000.00,A,5205.44435,N,00507.28783,E,0.02,,010324,,,A");
+    feedSentence(parser, "GNRMC,000000.50,A,5205.44435,N,00507.28783,E,0.02,,010324,,,A");
+    GPSParser::Fix after;
+    parser.getFix(after);
+    check(before.utcMillis > 0 && after.utcMillis - before.utcMillis == 1000,
+          "fix time went from %lld to %lld across midnight", (long long)before.utcMillis, (long long)after.utcMillis);
+    check((after.fields & GPSFilter::FIELDS) == GPSFilter::FIELDS && after.latitudeE7 == 520907392,
+          "fields %04X decoded for the filter, latitude %ld", after.fields, (long)after.latitudeE7);
+}
+
+void testEpochs() {
+    testUsedSatellites();
+    testSubscribers();
+}
@@ -0,0 +1,31 @@
+// Text formatting of the published fix
+
+#include "tests.h"
+#include "GPSParser.h"
+
+static void checkPosition(int32_t latitudeE7, int32_t longitudeE7, const char* expected) {
+    char text[64];
+    GPSParser::formatPosition(latitudeE7, longitudeE7, text, sizeof(text));
+    check(strcmp(text, expected) == 0, "%ld, %ld: \"%s\", expected \"%s\"",
+          (long)latitudeE7, (long)longitudeE7, text, expected);
+}
+
+void testFormat() {
+    checkPosition(0, 0, "00°00.00'N 000°00.00'E");
+    checkPosition(520833333, 50666667, "52°05.00'N 005°04.00'E");
+    checkPosition(-338568000, -1512153000, "33°51.41'S 151°12.92'W");
+    
+    // Rounding up to the next whole degree carries into the degrees
+    checkPosition(529999999, 1799999999, "53°00.00'N 180°00.00'E");
+    checkPosition(-529999999, -49999999, "53°00.00'S 005°00.00'W");
+    checkPosition(529999166, 0, "52°59.99'N 000°00.00'E");
+    checkPosition(529999167, 0, "53°00.00'N 000°00.00'E");
+    checkPosition(900000000, -1800000000, "90°00.00'N 180°00.00'W");
+    
+    // Every hundredth of a minute across a degree boundary keeps its minutes below 60
+    char text[64];
+    for (int32_t value = 519990000; value <= 520010000; value += 7) {
+        GPSParser::formatPosition(value, value, text, sizeof(text));
+        check(strstr(text, "60.00") == nullptr, "%ld: \"%s\"", (long)value, text);
+    }
+}
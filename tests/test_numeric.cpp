@@ -0,0 +1,247 @@
+// NMEA field parsers against the C library
+
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+#include "tests.h"
+#include "NMEANumeric.h"
+#include "GPSTime.h"
+
+// Deterministic pseudo random numbers, the same on every run
+static uint32_t randomState = 12345;
+
+static uint32_t nextRandom() {
+    randomState = randomState * 1103515245 + 12345;
+    return randomState >> 8;
+}
+
+static void checkStatus(NMEAFieldStatus status, NMEAFieldStatus expected, const char* what, const char* text) {
+    check(status == expected, "%s(\"%s\"): status %d, expected %d", what, text, status, expected);
+}
+
+static void testTime() {
+    // Every second of the day, whole and with two and three fraction digits
+    char text[16];
+    for (uint32_t second = 0; second < 86400; second++) {
+        uint32_t fraction = (second * 7919) % 1000;
+        uint32_t h = second / 3600, m = second / 60 % 60, s = second % 60;
+        uint32_t parsed = UINT32_MAX;
+        
+        snprintf(text, sizeof(text), "%02u%02u%02u", (unsigned)h, (unsigned)m, (unsigned)s);
+        if (nmeaParseTime(text, parsed) != NMEA_FIELD_OK || parsed != second * 1000) {
+            check(false, "nmeaParseTime(\"%s\") = %lu", text, (unsigned long)parsed);
+        }
+        snprintf(text, sizeof(text), "%02u%02u%02u.%03u", (unsigned)h, (unsigned)m, (unsigned)s, (unsigned)fraction);
+        if (nmeaParseTime(text, parsed) != NMEA_FIELD_OK || parsed != second * 1000 + fraction) {
+            check(false, "nmeaParseTime(\"%s\") = %lu", text, (unsigned long)parsed);
+        }
+        snprintf(text, sizeof(text), "%02u%02u%02u.%02u", (unsigned)h, (unsigned)m, (unsigned)s,
+                 (unsigned)fraction / 10);
+        if (nmeaParseTime(text, parsed) != NMEA_FIELD_OK || parsed != second * 1000 + fraction / 10 * 10) {
+            check(false, "nmeaParseTime(\"%s\") = %lu", text, (unsigned long)parsed);
+        }
+    }
+    
+    uint32_t parsed;
+    checkStatus(nmeaParseTime("235960", parsed), NMEA_FIELD_OK, "nmeaParseTime", "235960");
+    check(parsed == 86400000, "leap second parsed as %lu", (unsigned long)parsed);
+    checkStatus(nmeaParseTime("", parsed), NMEA_FIELD_EMPTY, "nmeaParseTime", "");
+    
+    static const char* const invalid[] = {
+        "240000", "126000", "123461", "996000", "12345", "1234567", "12a456", "123456.1x", "123456,", " 23456",
+        "-23456", "1234.56"
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        parsed = 42;
+        checkStatus(nmeaParseTime(invalid[i], parsed), NMEA_FIELD_INVALID, "nmeaParseTime", invalid[i]);
+        check(parsed == 42, "nmeaParseTime(\"%s\") wrote a result", invalid[i]);
+    }
+}
+
+static void testFixed() {
+    // Random decimals: exact when the text has no more fraction digits than
+    // kept, otherwise within half a unit of strtod
+    char text[32];
+    for (int i = 0; i < 200000; i++) {
+        uint8_t decimals = nextRandom() % 8;
+        uint8_t fractionDigits = nextRandom() % 10;
+        uint32_t whole = nextRandom() % 2 ? nextRandom() % 1000 : nextRandom() % 100000;
+        int length = snprintf(text, sizeof(text), "%s%u", nextRandom() % 3 == 0 ? "-" : "", (unsigned)whole);
+        if (fractionDigits > 0) {
+            length += snprintf(text + length, sizeof(text) - length, ".");
+            for (uint8_t d = 0; d < fractionDigits; d++) {
+                text[length++] = '0' + nextRandom() % 10;
+            }
+            text[length] = '\0';
+        }
+        
+        double expected = strtod(text, nullptr) * pow(10.0, decimals);
+        int32_t value;
+        NMEAFieldStatus status = nmeaParseFixed(text, decimals, value);
+        if (fabs(expected) >= 2147483647.0) {
+            if (status != NMEA_FIELD_INVALID) {
+                check(false, "nmeaParseFixed(\"%s\", %u) = %ld, expected overflow", text, decimals, (long)value);
+            }
+            continue;
+        }
+        bool exact = fractionDigits <= decimals;
+        if (status != NMEA_FIELD_OK || (exact ? value != llround(expected) : fabs(value - expected) > 0.5 + 1e-6)) {
+            check(false, "nmeaParseFixed(\"%s\", %u) = %ld, strtod gives %.3f", text, decimals, (long)value,
+                  expected);
+        }
+    }
+    
+    // Rounding half away from zero on the first dropped digit
+    static const struct {
+        const char* text;
+        uint8_t decimals;
+        int32_t value;
+    } cases[] = {
+        { "1.25", 1, 13 }, { "-1.25", 1, -13 }, { "1.249", 1, 12 }, { "+7", 2, 700 }, { "0.5", 0, 1 },
+        { "2147483647", 0, 2147483647 }, { "-2147483647", 0, -2147483647 }, { "21474836.47", 2, 2147483647 },
+        { "2147483647.4", 0, 2147483647 }, { "00012", 0, 12 }, { ".5", 1, 5 }, { "5.", 1, 50 }
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        int32_t value = 0;
+        NMEAFieldStatus status = nmeaParseFixed(cases[i].text, cases[i].decimals, value);
+        check(status == NMEA_FIELD_OK && value == cases[i].value, "nmeaParseFixed(\"%s\", %u) = %ld, expected %ld",
+              cases[i].text, cases[i].decimals, (long)value, (long)cases[i].value);
+    }
+    
+    // Overflow and anything strtod would take that NMEA does not have
+    static const struct {
+        const char* text;
+        uint8_t decimals;
+    } invalid[] = {
+        { "2147483648", 0 }, { "-2147483648", 0 }, { "2147483647.5", 0 }, { "214748364.8", 1 }, { "99999999999", 0 },
+        { "21474836.48", 2 }, { "1e5", 0 }, { " 12", 0 }, { "12 ", 0 }, { "1.2.3", 1 }, { ".", 0 }, { "-", 0 },
+        { "0x1A", 0 }, { "inf", 0 }, { "nan", 0 }, { "1,5", 1 }, { "--1", 0 }
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        int32_t value = 42;
+        checkStatus(nmeaParseFixed(invalid[i].text, invalid[i].decimals, value), NMEA_FIELD_INVALID,
+                    "nmeaParseFixed", invalid[i].text);
+        check(value == 42, "nmeaParseFixed(\"%s\") wrote a result", invalid[i].text);
+    }
+    int32_t value;
+    checkStatus(nmeaParseFixed("", 2, value), NMEA_FIELD_EMPTY, "nmeaParseFixed", "");
+    checkStatus(nmeaParseInt("12.5", value), NMEA_FIELD_OK, "nmeaParseInt", "12.5");
+    check(value == 13, "nmeaParseInt(\"12.5\") = %ld", (long)value);
+}
+
+static void testCoordinate() {
+    // Random coordinates with up to seven decimals of a minute, within half
+    // of 1e-7 degree of strtod
+    char text[32];
+    char minutesText[16];
+    for (int i = 0; i < 200000; i++) {
+        bool latitude = nextRandom() % 2;
+        uint32_t degrees = nextRandom() % (latitude ? 90 : 180);
+        uint8_t minuteDecimals = nextRandom() % 8;
+        int length = snprintf(minutesText, sizeof(minutesText), "%02u", (unsigned)(nextRandom() % 60));
+        if (minuteDecimals > 0) {
+            minutesText[length++] = '.';
+            for (uint8_t d = 0; d < minuteDecimals; d++) {
+                minutesText[length++] = '0' + nextRandom() % 10;
+            }
+            minutesText[length] = '\0';
+        }
+        snprintf(text, sizeof(text), latitude ? "%02u%s" : "%03u%s", (unsigned)degrees, minutesText);
+        static const char hemispheres[] = { 'N', 'S', 'E', 'W' };
+        char hemisphere = hemispheres[(latitude ? 0 : 2) + nextRandom() % 2];
+        
+        double expected = (degrees + strtod(minutesText, nullptr) / 60.0) * 1e7;
+        if (hemisphere == 'S' || hemisphere == 'W') {
+            expected = -expected;
+        }
+        int32_t value;
+        if (nmeaParseCoordinate(text, hemisphere, value) != NMEA_FIELD_OK || fabs(value - expected) > 0.5 + 1e-6) {
+            check(false, "nmeaParseCoordinate(\"%s\", %c) = %ld, strtod gives %.2f", text, hemisphere, (long)value,
+                  expected);
+        }
+    }
+    
+    static const struct {
+        const char* text;
+        char hemisphere;
+        int32_t value;
+    } cases[] = {
+        { "5205.0000", 'N', 520833333 }, { "00504.0000", 'W', -50666667 }, { "9000.0000", 'N', 900000000 },
+        { "18000.0000", 'E', 1800000000 }, { "0000.0000", 'S', 0 }, { "4807.038", 'N', 481173000 },
+        { "5959.9999999", 'N', 600000000 }, { "5205", 'N', 520833333 }
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        int32_t value = 0;
+        NMEAFieldStatus status = nmeaParseCoordinate(cases[i].text, cases[i].hemisphere, value);
+        check(status == NMEA_FIELD_OK && value == cases[i].value, "nmeaParseCoordinate(\"%s\", %c) = %ld, expected %ld",
+              cases[i].text, cases[i].hemisphere, (long)value, (long)cases[i].value);
+    }
+    
+    // Minutes of 60 or more, beyond the poles or the date line, a bad
+    // hemisphere and malformed digits
+    static const struct {
+        const char* text;
+        char hemisphere;
+    } invalid[] = {
+        { "5260.0000", 'N' }, { "5299.0000", 'N' }, { "00560.0000", 'E' }, { "9000.0001", 'N' }, { "9100.0000", 'S' },
+        { "18000.0001", 'E' }, { "18100.0000", 'W' }, { "5205.0000", 'X' }, { "5205.0000", 'n' },
+        { "5205.0000", '\0' }, { "00504.0000", 'E' + 1 }, { "52a5.0000", 'N' }, { "5.0000", 'N' },
+        { "123456.0000", 'E' }, { "5205.00x0", 'N' }, { "-5205.0000", 'N' }, { "5205.0000 ", 'N' }
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        int32_t value = 42;
+        NMEAFieldStatus status = nmeaParseCoordinate(invalid[i].text, invalid[i].hemisphere, value);
+        check(status == NMEA_FIELD_INVALID && value == 42, "nmeaParseCoordinate(\"%s\", '%c'): status %d",
+              invalid[i].text, invalid[i].hemisphere ? invalid[i].hemisphere : '0', status);
+    }
+    int32_t value;
+    checkStatus(nmeaParseCoordinate("", 'N', value), NMEA_FIELD_EMPTY, "nmeaParseCoordinate", "");
+}
+
+static void testDate() {
+    // Every day of the two digit year range, against gmtime and back
+    int32_t first = gpsDaysFromCivil(1980, 1, 1);
+    int32_t last = gpsDaysFromCivil(2079, 12, 31);
+    char text[32];
+    for (int32_t days = first; days <= last; days++) {
+        time_t seconds = (time_t)days * 86400;
+        struct tm civil;
+        gmtime_r(&seconds, &civil);
+        snprintf(text, sizeof(text), "%02d%02d%02d", civil.tm_mday, civil.tm_mon + 1, civil.tm_year % 100);
+        
+        int32_t parsed = 0;
+        if (nmeaParseDate(text, parsed) != NMEA_FIELD_OK || parsed != days) {
+            check(false, "nmeaParseDate(\"%s\") = %ld, expected %ld", text, (long)parsed, (long)days);
+        }
+        int32_t year;
+        uint8_t month, day;
+        gpsCivilFromDays(days, year, month, day);
+        if (year != civil.tm_year + 1900 || month != civil.tm_mon + 1 || day != civil.tm_mday) {
+            check(false, "gpsCivilFromDays(%ld) = %ld-%u-%u, gmtime gives %s", (long)days, (long)year, month, day,
+                  text);
+        }
+    }
+    
+    // 29 February in leap years only, 2000 is one, and other days that do not exist
+    int32_t parsed;
+    checkStatus(nmeaParseDate("290224", parsed), NMEA_FIELD_OK, "nmeaParseDate", "290224");
+    checkStatus(nmeaParseDate("290200", parsed), NMEA_FIELD_OK, "nmeaParseDate", "290200");
+    checkStatus(nmeaParseDate("290280", parsed), NMEA_FIELD_OK, "nmeaParseDate", "290280");
+    static const char* const invalid[] = {
+        "290223", "290225", "290281", "290299", "290201", "300224", "310424", "310624", "310924", "311124", "000124",
+        "320124", "011324", "010024", "0101", "0101245", "01012a", "01-124", ""
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        parsed = 42;
+        NMEAFieldStatus expected = invalid[i][0] == '\0' ? NMEA_FIELD_EMPTY : NMEA_FIELD_INVALID;
+        checkStatus(nmeaParseDate(invalid[i], parsed), expected, "nmeaParseDate", invalid[i]);
+        check(parsed == 42, "nmeaParseDate(\"%s\") wrote a result", invalid[i]);
+    }
+}
+
+void testNumeric() {
+    testTime();
+    testFixed();
+    testCoordinate();
+    testDate();
+}
@@ -0,0 +1,308 @@
+// The same receiver output in NMEA and in UBX: a capture of both, as a u-blox
+// receiver sends them side by side, parsed once with each protocol selected.
+// Both must publish the same fixes and satellite tables.
+
+#include <math.h>
+#include <string>
+#include <vector>
+#include "tests.h"
+#include "GPSParser.h"
+
+#define CAPTURE_EPOCHS 12
+#define CAPTURE_RATE_MS 200
+
+struct Satellite {
+    uint8_t gnssId;
+    uint8_t svId;
+    const char* talker;
+    int nmeaId;
+    int elevation;
+    int azimuth;
+    int cno;
+    bool used;
+};
+
+static const Satellite satellites[] = {
+    { UBXParser::GNSS_ID_GPS, 2, "GP", 2, 45, 123, 41, true },
+    { UBXParser::GNSS_ID_GPS, 5, "GP", 5, 12, 301, 28, true },
+    { UBXParser::GNSS_ID_GPS, 13, "GP", 13, 67, 45, 44, true },
+    { UBXParser::GNSS_ID_GPS, 21, "GP", 21, 3, 200, 19, false },
+    { UBXParser::GNSS_ID_GPS, 29, "GP", 29, 33, 90, 37, true },
+    { UBXParser::GNSS_ID_GLONASS, 4, "GL", 68, 51, 10, 40, true },
+    { UBXParser::GNSS_ID_GLONASS, 17, "GL", 81, 22, 275, 31, false },
+    { UBXParser::GNSS_ID_GALILEO, 7, "GA", 7, 58, 160, 43, true },
+    { UBXParser::GNSS_ID_GALILEO, 30, "GA", 30, 9, 340, 25, true }
+};
+
+static const size_t SATELLITE_COUNT = sizeof(satellites) / sizeof(satellites[0]);
+
+// Values of one epoch in the units UBX carries them
+struct Epoch {
+    uint32_t iTOW;
+    int year, month, day, hour, minute, second, millisecond;
+    int32_t lat, lon;      // 1e-7 degree
+    int32_t height, hMSL;  // mm
+    int32_t gSpeed;        // mm/s
+    int32_t headMot;       // 1e-5 degree
+    uint16_t pDOP, hDOP, vDOP;
+};
+
+static Epoch epochAt(int index) {
+    // Across midnight at the end of 29 February, south and east of the equator
+    Epoch e;
+    uint32_t milliseconds = 86400000 - 1000 + index * CAPTURE_RATE_MS;
+    bool nextDay = milliseconds >= 86400000;
+    milliseconds %= 86400000;
+    e.iTOW = 345600000 + index * CAPTURE_RATE_MS;
+    e.year = 2024;
+    e.month = nextDay ? 3 : 2;
+    e.day = nextDay ? 1 : 29;
+    e.hour = milliseconds / 3600000;
+    e.minute = milliseconds / 60000 % 60;
+    e.second = milliseconds / 1000 % 60;
+    e.millisecond = milliseconds % 1000;
+    e.lat = -338568123 + index * 1234;
+    e.lon = 1512153456 - index * 2345;
+    e.hMSL = 12340 + index * 10;
+    e.height = e.hMSL + 22150;
+    e.gSpeed = 5000 + index * 37;
+    e.headMot = 27500000 + index * 1000;
+    e.pDOP = 185;
+    e.hDOP = 92 + index;
+    e.vDOP = 160;
+    return e;
+}
+
+static void put16(uint8_t* p, uint16_t value) {
+    memcpy(p, &value, 2);
+}
+
+static void put32(uint8_t* p, uint32_t value) {
+    memcpy(p, &value, 4);
+}
+
+static void addFrame(std::vector<uint8_t>& out, uint8_t id, const uint8_t* payload, uint16_t length) {
+    uint8_t frame[512];
+    size_t count = UBXParser::buildFrame(UBX_CLASS_NAV, id, payload, length, frame, sizeof(frame));
+    out.insert(out.end(), frame, frame + count);
+}
+
+static void addSentence(std::vector<uint8_t>& out, const char* body) {
+    char sentence[128];
+    int length = snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, nmeaChecksum(body, body + strlen(body)));
+    out.insert(out.end(), sentence, sentence + length);
+}
+
+// DDMM.MMMMMMM with seven decimals of a minute, exact for 1e-7 degree
+static std::string coordinate(int32_t valueE7, int degreeDigits, char positive, char negative) {
+    uint32_t value = abs(valueE7);
+    uint32_t minutesE7 = value % 10000000 * 60;
+    char text[32];
+    snprintf(text, sizeof(text), "%0*u%02u.%07u,%c", degreeDigits, (unsigned)(value / 10000000),
+             (unsigned)(minutesE7 / 10000000), (unsigned)(minutesE7 % 10000000), valueE7 < 0 ? negative : positive);
+    return text;
+}
+
+static void addEpoch(std::vector<uint8_t>& out, const Epoch& e) {
+    uint8_t pvt[92] = {};
+    put32(&pvt[0], e.iTOW);
+    put16(&pvt[4], e.year);
+    pvt[6] = e.month;
+    pvt[7] = e.day;
+    pvt[8] = e.hour;
+    pvt[9] = e.minute;
+    pvt[10] = e.second;
+    pvt[11] = 0x03;                  // Date and time valid
+    put32(&pvt[16], e.millisecond * 1000000);
+    pvt[20] = 3;                     // 3D
+    pvt[21] = 0x01;                  // gnssFixOK
+    uint8_t used = 0;
+    for (size_t i = 0; i < SATELLITE_COUNT; i++) {
+        used += satellites[i].used;
+    }
+    pvt[23] = used;
+    put32(&pvt[24], e.lon);
+    put32(&pvt[28], e.lat);
+    put32(&pvt[32], e.height);
+    put32(&pvt[36], e.hMSL);
+    put32(&pvt[60], e.gSpeed);
+    put32(&pvt[64], e.headMot);
+    put16(&pvt[76], e.pDOP);
+    addFrame(out, UBX_NAV_PVT, pvt, sizeof(pvt));
+    
+    char time[16];
+    snprintf(time, sizeof(time), "%02d%02d%02d.%02d", e.hour, e.minute, e.second, e.millisecond / 10);
+    std::string lat = coordinate(e.lat, 2, 'N', 'S');
+    std::string lon = coordinate(e.lon, 3, 'E', 'W');
+    char body[128];
+    snprintf(body, sizeof(body), "GNGGA,%s,%s,%s,1,%02u,%.2f,%.2f,M,%.2f,M,,", time, lat.c_str(), lon.c_str(),
+             used, e.hDOP * 0.01, e.hMSL * 0.001, (e.height - e.hMSL) * 0.001);
+    addSentence(out, body);
+    snprintf(body, sizeof(body), "GNRMC,%s,A,%s,%s,%.3f,%.2f,%02d%02d%02d,,,A", time, lat.c_str(), lon.c_str(),
+             e.gSpeed * 0.001 * 1.943844, e.headMot * 1e-5, e.day, e.month, e.year % 100);
+    addSentence(out, body);
+    
+    uint8_t dop[18] = {};
+    put32(&dop[0], e.iTOW);
+    put16(&dop[6], e.pDOP);
+    put16(&dop[10], e.vDOP);
+    put16(&dop[12], e.hDOP);
+    addFrame(out, UBX_NAV_DOP, dop, sizeof(dop));
+    
+    // One GSA per system, NMEA 4.10 system IDs
+    static const struct {
+        const char* talker;
+        int systemId;
+    } systems[] = { { "GP", 1 }, { "GL", 2 }, { "GA", 3 } };
+    for (size_t s = 0; s < 3; s++) {
+        int length = snprintf(body, sizeof(body), "GNGSA,A,3");
+        int ids = 0;
+        for (size_t i = 0; i < SATELLITE_COUNT; i++) {
+            if (satellites[i].used && strcmp(satellites[i].talker, systems[s].talker) == 0) {
+                length += snprintf(body + length, sizeof(body) - length, ",%02d", satellites[i].nmeaId);
+                ids++;
+            }
+        }
+        for (; ids < 12; ids++) {
+            length += snprintf(body + length, sizeof(body) - length, ",");
+        }
+        snprintf(body + length, sizeof(body) - length, ",%.2f,%.2f,%.2f,%d", e.pDOP * 0.01, e.hDOP * 0.01,
+                 e.vDOP * 0.01, systems[s].systemId);
+        addSentence(out, body);
+    }
+    
+    // One GSV cycle per system, four satellites per message
+    for (size_t s = 0; s < 3; s++) {
+        std::vector<const Satellite*> inView;
+        for (size_t i = 0; i < SATELLITE_COUNT; i++) {
+            if (strcmp(satellites[i].talker, systems[s].talker) == 0) {
+                inView.push_back(&satellites[i]);
+            }
+        }
+        int messages = (inView.size() + 3) / 4;
+        for (int m = 0; m < messages; m++) {
+            int length = snprintf(body, sizeof(body), "%sGSV,%d,%d,%02u", systems[s].talker, messages, m + 1,
+                                  (unsigned)inView.size());
+            for (size_t i = m * 4; i < inView.size() && i < (size_t)(m + 1) * 4; i++) {
+                length += snprintf(body + length, sizeof(body) - length, ",%02d,%02d,%03d,%02d", inView[i]->nmeaId,
+                                   inView[i]->elevation, inView[i]->azimuth, inView[i]->cno);
+            }
+            addSentence(out, body);
+        }
+    }
+    
+    uint8_t sat[8 + 12 * SATELLITE_COUNT] = {};
+    put32(&sat[0], e.iTOW);
+    sat[4] = 1;
+    sat[5] = SATELLITE_COUNT;
+    for (size_t i = 0; i < SATELLITE_COUNT; i++) {
+        uint8_t* p = &sat[8 + 12 * i];
+        p[0] = satellites[i].gnssId;
+        p[1] = satellites[i].svId;
+        p[2] = satellites[i].cno;
+        p[3] = satellites[i].elevation;
+        put16(&p[4], satellites[i].azimuth);
+        put32(&p[8], satellites[i].used ? 0x0F : 0x07);
+    }
+    addFrame(out, UBX_NAV_SAT, sat, sizeof(sat));
+}
+
+static bool near(float a, float b, float tolerance) {
+    return fabsf(a - b) <= tolerance;
+}
+
+static void compareFixes(int epoch, const GPSParser::Fix& nmea, const GPSParser::Fix& ubx) {
+    check(nmea.sequence == ubx.sequence, "epoch %d: fix %lu from NMEA, %lu from UBX", epoch,
+          (unsigned long)nmea.sequence, (unsigned long)ubx.sequence);
+    check(nmea.timeOfDay == ubx.timeOfDay && nmea.date == ubx.date && nmea.utcMillis == ubx.utcMillis,
+          "epoch %d: time %lu/%ld from NMEA, %lu/%ld from UBX", epoch, (unsigned long)nmea.timeOfDay,
+          (long)nmea.date, (unsigned long)ubx.timeOfDay, (long)ubx.date);
+    check(nmea.latitudeE7 == ubx.latitudeE7 && nmea.longitudeE7 == ubx.longitudeE7,
+          "epoch %d: position %ld,%ld from NMEA, %ld,%ld from UBX", epoch, (long)nmea.latitudeE7,
+          (long)nmea.longitudeE7, (long)ubx.latitudeE7, (long)ubx.longitudeE7);
+    check(near(nmea.speed, ubx.speed, 0.001f) && near(nmea.course, ubx.course, 0.001f),
+          "epoch %d: speed/course %.4f/%.4f from NMEA, %.4f/%.4f from UBX", epoch, nmea.speed, nmea.course,
+          ubx.speed, ubx.course);
+    check(near(nmea.altitude, ubx.altitude, 0.001f) && near(nmea.geoidSeparation, ubx.geoidSeparation, 0.001f),
+          "epoch %d: altitude/geoid %.3f/%.3f from NMEA, %.3f/%.3f from UBX", epoch, nmea.altitude,
+          nmea.geoidSeparation, ubx.altitude, ubx.geoidSeparation);
+    check(nmea.satellites == ubx.satellites && nmea.fixMode == ubx.fixMode,
+          "epoch %d: %d satellites, mode %u from NMEA, %d, %u from UBX", epoch, nmea.satellites, nmea.fixMode,
+          ubx.satellites, ubx.fixMode);
+    check(near(nmea.hdop, ubx.hdop, 0.0001f) && near(nmea.pdop, ubx.pdop, 0.0001f) &&
+          near(nmea.vdop, ubx.vdop, 0.0001f), "epoch %d: DOP %.2f/%.2f/%.2f from NMEA, %.2f/%.2f/%.2f from UBX",
+          epoch, nmea.hdop, nmea.pdop, nmea.vdop, ubx.hdop, ubx.pdop, ubx.vdop);
+    check(memcmp(nmea.usedSatellites, ubx.usedSatellites, sizeof(nmea.usedSatellites)) == 0,
+          "epoch %d: used satellites differ", epoch);
+    check(nmea.validPosition == ubx.validPosition && nmea.validAltitude == ubx.validAltitude &&
+          nmea.validHDOP == ubx.validHDOP && nmea.validTime == ubx.validTime && nmea.validDate == ubx.validDate,
+          "epoch %d: validity flags differ", epoch);
+}
+
+static void compareTables(int epoch, GPSParser& nmea, GPSParser& ubx) {
+    GPSParser::SatelliteInfo fromNMEA[GPS_MAX_SATELLITES];
+    GPSParser::SatelliteInfo fromUBX[GPS_MAX_SATELLITES];
+    int count = nmea.getSatelliteInfo(fromNMEA, GPS_MAX_SATELLITES);
+    check(count == ubx.getSatelliteInfo(fromUBX, GPS_MAX_SATELLITES), "epoch %d: satellite counts differ", epoch);
+    check(count == (int)SATELLITE_COUNT, "epoch %d: %d satellites in view", epoch, count);
+    for (int i = 0; i < count; i++) {
+        const GPSParser::SatelliteInfo& a = fromNMEA[i];
+        const GPSParser::SatelliteInfo& b = fromUBX[i];
+        check(a.id == b.id && a.constellation == b.constellation && a.elevation == b.elevation &&
+              a.azimuth == b.azimuth && a.snr == b.snr && a.used == b.used,
+              "epoch %d: satellite %d/%d from NMEA, %d/%d from UBX", epoch, a.constellation, a.id,
+              b.constellation, b.id);
+        // The used flags come from the fix, published from the second epoch on
+        check(epoch == 0 || a.used == satellites[i].used, "epoch %d: satellite %d/%d used flag", epoch,
+              a.constellation, a.id);
+    }
+}
+
+void testProtocols() {
+    std::vector<uint8_t> capture;
+    std::vector<size_t> epochEnds;
+    for (int i = 0; i < CAPTURE_EPOCHS; i++) {
+        addEpoch(capture, epochAt(i));
+        epochEnds.push_back(capture.size());
+    }
+    
+    GPSParser nmea;
+    GPSParser ubx;
+    nmea.setProtocol(GPSParser::PROTOCOL_NMEA);
+    ubx.setProtocol(GPSParser::PROTOCOL_UBX);
+    size_t start = 0;
+    for (int i = 0; i < CAPTURE_EPOCHS; i++) {
+        nmea.processGPSData(capture.data() + start, epochEnds[i] - start);
+        ubx.processGPSData(capture.data() + start, epochEnds[i] - start);
+        start = epochEnds[i];
+        
+        GPSParser::Fix fromNMEA, fromUBX;
+        nmea.getFix(fromNMEA);
+        ubx.getFix(fromUBX);
+        compareFixes(i, fromNMEA, fromUBX);
+        compareTables(i, nmea, ubx);
+    }
+    
+    // Each parser saw only its own protocol, and every epoch was published:
+    // the first when the second began, the others as soon as they were complete
+    GPSParser::Stats nmeaStats = nmea.getStats();
+    GPSParser::Stats ubxStats = ubx.getStats();
+    check(nmeaStats.accepted > 0 && nmeaStats.rejected == 0 && nmeaStats.ubxAccepted == 0,
+          "NMEA parser: %lu sentences, %lu rejected, %lu UBX frames", (unsigned long)nmeaStats.accepted,
+          (unsigned long)nmeaStats.rejected, (unsigned long)nmeaStats.ubxAccepted);
+    check(ubxStats.ubxAccepted == 3 * CAPTURE_EPOCHS && ubxStats.accepted == 0,
+          "UBX parser: %lu frames, %lu sentences", (unsigned long)ubxStats.ubxAccepted,
+          (unsigned long)ubxStats.accepted);
+    check(nmea.getFixSequence() == CAPTURE_EPOCHS, "%lu fixes published, expected %d",
+          (unsigned long)nmea.getFixSequence(), CAPTURE_EPOCHS);
+    
+    // The last fix is the last epoch, on 1 March
+    Epoch last = epochAt(CAPTURE_EPOCHS - 1);
+    GPSParser::Fix fix;
+    ubx.getFix(fix);
+    check(fix.latitudeE7 == last.lat && fix.longitudeE7 == last.lon, "last position %ld,%ld",
+          (long)fix.latitudeE7, (long)fix.longitudeE7);
+    check(fix.date == gpsDaysFromCivil(2024, 3, 1) && fix.timeOfDay == (uint32_t)last.millisecond +
+          1000 * (last.second + 60 * (last.minute + 60 * last.hour)), "last time %lu on day %ld",
+          (unsigned long)fix.timeOfDay, (long)fix.date);
+}
@@ -0,0 +1,80 @@
+// UBX input: frame sizes and the satellite table from NAV-SAT
+
+#include "tests.h"
+#include "GPSParser.h"
+
+// Largest NAV-SAT, its satellite count is one byte
+#define NAV_SAT_MAX_PAYLOAD (8 + 12 * 255)
+
+static uint8_t frame[NAV_SAT_MAX_PAYLOAD + UBX_FRAME_OVERHEAD];
+
+// NAV-SAT frame with count satellites of one system, numbered from 1
+static size_t buildNavSat(uint32_t iTOW, uint8_t gnssId, int count) {
+    static uint8_t payload[NAV_SAT_MAX_PAYLOAD];
+    uint16_t length = 8 + 12 * count;
+    memset(payload, 0, length);
+    memcpy(&payload[0], &iTOW, 4);
+    payload[4] = 1;                        // Version
+    payload[5] = count;
+    for (int i = 0; i < count; i++) {
+        uint8_t* p = &payload[8 + 12 * i];
+        p[0] = gnssId;
+        p[1] = i + 1;
+        p[2] = 20 + i % 30;                // cno
+        p[3] = i % 90;                     // Elevation
+        int16_t azimuth = (i * 7) % 360;
+        memcpy(&p[4], &azimuth, 2);
+        p[8] = (i % 2) ? 0x08 : 0x00;      // svUsed on every other one
+    }
+    return UBXParser::buildFrame(UBX_CLASS_NAV, UBX_NAV_SAT, payload, length, frame, sizeof(frame));
+}
+
+static void navSatSize(int count, int expectedInView) {
+    size_t length = buildNavSat(1000, UBXParser::GNSS_ID_BEIDOU, count);
+    check(length == (size_t)(8 + 12 * count + UBX_FRAME_OVERHEAD), "%d satellites: frame not built", count);
+    
+    UBXParser ubx;
+    UBXParser::Result result = UBXParser::UBX_IDLE;
+    for (size_t i = 0; i < length; i++) {
+        result = ubx.processByte(frame[i]);
+    }
+    check(result == UBXParser::UBX_FRAME_READY && ubx.getStats().overflowed == 0,
+          "%d satellites: NAV-SAT frame not accepted", count);
+    check(ubx.getNavSatCount() == count, "%d satellites: decoded %d", count, ubx.getNavSatCount());
+    UBXParser::NavSatellite last;
+    check(ubx.decodeNavSatellite(count - 1, last) && last.svId == count && last.cno == 20 + (count - 1) % 30,
+          "%d satellites: last one decoded wrong", count);
+    
+    GPSParser parser;
+    parser.setProtocol(GPSParser::PROTOCOL_UBX);
+    parser.processGPSData(frame, length);
+    GPSParser::SatelliteInfo satellites[GPS_MAX_SATELLITES];
+    int inView = parser.getSatelliteInfo(satellites, GPS_MAX_SATELLITES);
+    check(inView == expectedInView && parser.getSatellitesInView() == expectedInView,
+          "%d satellites: %d in view, expected %d", count, inView, expectedInView);
+    check(inView > 0 && satellites[inView - 1].id == inView && satellites[inView - 1].constellation ==
+          GPSParser::CONSTELLATION_BEIDOU, "%d satellites: table out of order", count);
+}
+
+void testUBX() {
+    // More than fit the old 512 byte payload, up to the most NAV-SAT can count
+    navSatSize(12, 12);
+    navSatSize(42, 42);
+    navSatSize(43, 43);
+    navSatSize(GPS_MAX_SATELLITES, GPS_MAX_SATELLITES);
+    navSatSize(120, GPS_MAX_SATELLITES);
+    navSatSize(255, GPS_MAX_SATELLITES);
+    
+    // A length beyond that is still refused
+    static uint8_t payload[UBX_MAX_PAYLOAD + 1];
+    uint8_t header[] = { UBX_SYNC_CHAR_1, UBX_SYNC_CHAR_2, UBX_CLASS_NAV, UBX_NAV_SAT,
+                         (UBX_MAX_PAYLOAD + 1) & 0xFF, (UBX_MAX_PAYLOAD + 1) >> 8 };
+    UBXParser ubx;
+    for (size_t i = 0; i < sizeof(header); i++) {
+        ubx.processByte(header[i]);
+    }
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        ubx.processByte(payload[i]);
+    }
+    check(ubx.getStats().overflowed == 1, "oversized frame not counted as overflowed");
+}
@@ -0,0 +1,43 @@
+// Host tests of the hardware independent sources (env:tests):
+//
+//   pio run -e tests && .pio/build/tests/program
+//
+// Runs every area and exits nonzero if any check failed.
+
+#include <stdarg.h>
+#include "tests.h"
+
+static int failures = 0;
+
+void check(bool condition, const char* format, ...) {
+    if (condition) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    printf("  FAILED: ");
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+    failures++;
+}
+
+static void run(const char* name, void (*test)()) {
+    int before = failures;
+    printf("%s\n", name);
+    test();
+    if (failures == before) {
+        printf("  ok\n");
+    }
+}
+
+int main() {
+    run("NMEA field parsers", testNumeric);
+    run("position formatting", testFormat);
+    run("UBX input", testUBX);
+    run("NMEA and UBX of the same receiver", testProtocols);
+    run("values carried over between epochs", testEpochs);
+    run("receiver configuration", testConfigurator);
+    printf("%d failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,17 @@
+#ifndef TESTS_H
+#define TESTS_H
+
+#include <Arduino.h>
+
+// Host tests (env:tests), one function per area. check() counts a failure
+// and prints what went wrong, printf style.
+void check(bool condition, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+void testNumeric();
+void testFormat();
+void testUBX();
+void testProtocols();
+void testEpochs();
+void testConfigurator();
+
+#endif // TESTS_H